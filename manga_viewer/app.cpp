@@ -630,8 +630,8 @@ void manga_viewer::draw_gui() {
       if (toolkit::open_file_dialog("选择一个 .pdf 或者 .epub 文件导入",
                                     {"*.PDF", "*.EPUB", "*.pdf", "*.epub"},
                                     "*.pdf, *.epub", filepath)) {
-        std::thread t(&manga_viewer::on_load_file, this, filepath);
-        t.detach();
+        toolkit::job_system::instance().run(
+            [this, filepath]() { on_load_file(filepath); }, &loadingJobs);
       }
     }
     ImGui::SetItemTooltip("从 .pdf 或者 .epub 文件导入电子书");
@@ -813,6 +813,7 @@ manga_viewer::manga_viewer() {
   }
 }
 manga_viewer::~manga_viewer() {
+  toolkit::job_system::instance().wait(loadingJobs);
   toolkit::opengl::g_instance.shutdown();
 
   if (doc)
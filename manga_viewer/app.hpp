@@ -9,8 +9,6 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
-#include <queue>
-#include <thread>
 
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -18,52 +16,6 @@
 
 #include <mupdf/fitz.h>
 
-class thread_pool {
-  std::vector<std::thread> workers;
-  std::queue<std::function<void()>> tasks;
-  std::mutex queue_mutex;
-  std::condition_variable condition;
-  bool stop = false;
-
-public:
-  thread_pool(size_t threads = 8) {
-    for (size_t i = 0; i < threads; ++i) {
-      workers.emplace_back([this] {
-        while (true) {
-          std::function<void()> task;
-          {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            condition.wait(lock, [this] { return stop || !tasks.empty(); });
-            if (stop && tasks.empty())
-              return;
-            task = std::move(tasks.front());
-            tasks.pop();
-          }
-          task();
-        }
-      });
-    }
-  }
-
-  template <class F> void enqueue(F &&f) {
-    {
-      std::lock_guard<std::mutex> lock(queue_mutex);
-      tasks.emplace(std::forward<F>(f));
-    }
-    condition.notify_one();
-  }
-
-  ~thread_pool() {
-    {
-      std::lock_guard<std::mutex> lock(queue_mutex);
-      stop = true;
-    }
-    condition.notify_all();
-    for (auto &worker : workers)
-      worker.join();
-  }
-};
-
 template <typename T> class thread_safe_vector {
 public:
   thread_safe_vector() {}
@@ -139,7 +91,8 @@ private:
   const toolkit::opengl::texture &getTextureFromPool(int pageIdx);
   thread_safe_vector<std::pair<int, toolkit::assets::image>> highResImageQueue;
   std::mutex docLoadingLock;
-  thread_pool tpool;
+  // page and book loading jobs, waited for before dropping the document
+  toolkit::job_counter loadingJobs;
   void loadHighResPage(int pageIdx);
   void applyHighResQueue();
 
@@ -1,7 +1,6 @@
 #include "app.hpp"
 #include "toolkit/loaders/image.hpp"
 #include <filesystem>
-#include <thread>
 
 std::string uint32_to_binary_str(std::uint32_t n) {
   std::string result = "";
@@ -185,8 +184,8 @@ const toolkit::opengl::texture &manga_viewer::getTextureFromPool(int pageIdx) {
   texturePoolPageIdxData.on(
       [&](std::vector<int> &tppid) { tppid[texturePoolIdx] = pageIdx; });
   // start loading the high res image after everything's setup
-  std::thread t(&manga_viewer::loadHighResPage, this, pageIdx);
-  t.detach();
+  toolkit::job_system::instance().run(
+      [this, pageIdx]() { loadHighResPage(pageIdx); }, &loadingJobs);
 
   return texturePoolData.get(texturePoolIdx);
 }
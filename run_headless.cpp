@@ -0,0 +1,191 @@
+#include "scripts/mesh_modify.hpp"
+#include "scripts/mixamo_manipulate.hpp"
+#include "scripts/spring_damper.hpp"
+#include "scripts/vis_frustom_bbs.hpp"
+#include "scripts/vis_point_sequence.hpp"
+#include "toolkit/headless.hpp"
+#include "toolkit/loaders/image.hpp"
+#include "toolkit/loaders/motion.hpp"
+#include <CLI11.hpp>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+using namespace toolkit;
+
+// time update_transform on a generated hierarchy before and after sorting the
+// transform storage
+void benchmark_hierarchy(int num_nodes, int iterations) {
+  headless_app app;
+  auto &registry = app.registry;
+  auto transform_sys = app.get_sys<transform_system>();
+  std::mt19937 rng(42);
+
+  // the transforms are emplaced in random order, like a scene after many edits
+  std::vector<entt::entity> nodes(num_nodes);
+  registry.create(nodes.begin(), nodes.end());
+  std::vector<int> order(num_nodes);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+  for (auto i : order)
+    registry.emplace<transform>(nodes[i]);
+  // a root every 1000 nodes, the others hang below one of the 32 nodes
+  // before them
+  std::vector<entt::entity> roots;
+  for (int i = 0; i < num_nodes; i++) {
+    if (i % 1000 == 0) {
+      roots.push_back(nodes[i]);
+      continue;
+    }
+    int first = std::max(i - 32, i - i % 1000);
+    int parent = std::uniform_int_distribution<int>(first, i - 1)(rng);
+    registry.get<transform>(nodes[parent]).add_child(nodes[i], false);
+  }
+
+  auto measure = [&]() {
+    double total_ms = 0.0;
+    for (int i = 0; i < iterations; i++) {
+      // dirty roots refresh their whole hierarchy
+      for (auto root : roots) {
+        auto &trans = registry.get<transform>(root);
+        trans.set_local_pos(trans.local_position());
+      }
+      stopwatch timer;
+      transform_sys->update_transform(registry);
+      total_ms += timer.elapse_ms();
+    }
+    return total_ms / iterations;
+  };
+  transform_sys->sort_storage = false;
+  transform_sys->update_transform(registry);
+  double unsorted_ms = measure();
+  stopwatch sort_timer;
+  transform_sys->sort_hierarchy(registry);
+  double sort_ms = sort_timer.elapse_ms();
+  transform_sys->sort_storage = true;
+  double sorted_ms = measure();
+  spdlog::info("update_transform over {0} nodes: {1:.3f} ms unsorted, {2:.3f} "
+               "ms sorted ({3:.2f}x), sorting took {4:.3f} ms",
+               num_nodes, unsorted_ms, sorted_ms,
+               sorted_ms > 0.0 ? unsorted_ms / sorted_ms : 0.0, sort_ms);
+}
+
+// time the json and the binary round trip of a generated image and motion of
+// about `megabytes` each
+void benchmark_archive(int megabytes, int iterations) {
+  std::mt19937 rng(42);
+  assets::image img;
+  img.resize(1024, megabytes * 256, 4);
+  for (auto &byte : img.data)
+    byte = rng() & 0xff;
+  assets::motion mot;
+  mot.fps = 30;
+  mot.skeleton.as_empty(64);
+  mot.poses.resize(megabytes * 1024 * 1024 / (64 * sizeof(math::quat)));
+  for (auto &pose : mot.poses) {
+    pose.root_local_pos = math::vector3::Random();
+    pose.joint_local_rot.resize(64);
+    for (auto &rot : pose.joint_local_rot)
+      rot = math::quat(math::vector4::Random().normalized());
+  }
+
+  auto measure = [&](const char *name, const auto &asset) {
+    using asset_type = std::decay_t<decltype(asset)>;
+    double json_ms = 0.0, binary_ms = 0.0;
+    std::size_t json_size = 0, binary_size = 0;
+    for (int i = 0; i < iterations; i++) {
+      asset_type from_json, from_blob;
+      stopwatch json_timer;
+      auto text = nlohmann::json(asset).dump();
+      from_json = nlohmann::json::parse(text).template get<asset_type>();
+      json_ms += json_timer.elapse_ms();
+      stopwatch binary_timer;
+      auto blob = to_binary(asset);
+      from_binary(blob, from_blob);
+      binary_ms += binary_timer.elapse_ms();
+      json_size = text.size();
+      binary_size = blob.size();
+    }
+    json_ms /= iterations;
+    binary_ms /= iterations;
+    spdlog::info("{0} round trip: json {1:.3f} ms ({2:.2f} MB), binary {3:.3f} "
+                 "ms ({4:.2f} MB), {5:.1f}x",
+                 name, json_ms, json_size / 1048576.0, binary_ms,
+                 binary_size / 1048576.0,
+                 binary_ms > 0.0 ? json_ms / binary_ms : 0.0);
+  };
+  measure("image", img);
+  measure("motion", mot);
+}
+
+int main(int argc, char **argv) {
+  CLI::App cli{"Step a scene without window, useful for batch processing."};
+  std::string scene_path, output_path, trace_path;
+  int num_frames = -1, benchmark_nodes = 0, benchmark_megabytes = 0;
+  float duration = 0.0f, dt = 1.0f / 60.0f;
+  auto hierarchy_benchmark =
+      cli.add_option("--hierarchy-benchmark", benchmark_nodes,
+                     "Time the transform update of a generated hierarchy "
+                     "with this many nodes before and after sorting it, "
+                     "averaged over --frames runs (20 by default)");
+  auto archive_benchmark = cli.add_option(
+      "--archive-benchmark", benchmark_megabytes,
+      "Time the json and binary round trip of a generated image and motion "
+      "of this many megabytes, averaged over --frames runs (5 by default)");
+  cli.add_option("-s,--scene", scene_path, "Scene file to simulate")
+      ->excludes(hierarchy_benchmark)
+      ->excludes(archive_benchmark)
+      ->check(CLI::ExistingFile);
+  cli.add_option("-n,--frames", num_frames,
+                 "Number of frames to step, runs until a script stops the "
+                 "application if neither frames nor duration is given");
+  cli.add_option("-d,--duration", duration, "Simulated time in seconds");
+  cli.add_option("--dt", dt, "Fixed time step in seconds");
+  cli.add_option("-o,--output", output_path,
+                 "Save the scene after stepping, .json for json scenes");
+  cli.add_option("--trace", trace_path, "Export a chrome trace of the run");
+  CLI11_PARSE(cli, argc, argv);
+
+  if (benchmark_nodes > 0) {
+    benchmark_hierarchy(benchmark_nodes, num_frames > 0 ? num_frames : 20);
+    return 0;
+  }
+  if (benchmark_megabytes > 0) {
+    benchmark_archive(benchmark_megabytes, num_frames > 0 ? num_frames : 5);
+    return 0;
+  }
+  if (scene_path.empty()) {
+    spdlog::error("A scene is required, see --help");
+    return 1;
+  }
+
+  if (dt <= 0.0f) {
+    spdlog::error("Time step must be positive");
+    return 1;
+  }
+  if (num_frames < 0 && duration > 0.0f)
+    num_frames = std::ceil(duration / dt);
+
+  headless_app app;
+  if (!app.load(scene_path))
+    return 1;
+  spdlog::info("Loaded scene {0} with {1} entities", scene_path,
+               app.registry.view<entt::entity>().size());
+
+  stopwatch timer;
+  int stepped = app.run(dt, num_frames);
+  double elapsed = timer.elapse_s();
+  spdlog::info("Stepped {0} frames ({1:.3f}s simulated) in {2:.3f}s, {3:.1f} "
+               "frames per second",
+               stepped, app.time, elapsed,
+               elapsed > 0.0 ? stepped / elapsed : 0.0);
+
+  if (!output_path.empty()) {
+    if (!app.save(output_path))
+      return 1;
+    spdlog::info("Save scene to {0}", output_path);
+  }
+  if (!trace_path.empty())
+    profiler::export_chrome_trace(trace_path);
+  return 0;
+}
@@ -10,16 +10,18 @@ public:
   void start() override {
     if (auto actor_comp = registry->try_get<toolkit::anim::actor>(entity)) {
       if (target == entt::null || pole == entt::null || root == entt::null) {
-        for (auto &p : actor_comp->name_to_entity) {
-          if (toolkit::has_substr(p.first, "LeftFoot") &&
-              target == entt::null) {
-            target = p.second;
+        // scan the joints in skeleton order, the first match is the same on
+        // every run
+        for (auto joint : actor_comp->ordered_entities) {
+          auto &name = registry->get<toolkit::transform>(joint).name.str();
+          if (toolkit::has_substr(name, "LeftFoot") && target == entt::null) {
+            target = joint;
           }
-          if (toolkit::has_substr(p.first, "LeftLeg") && pole == entt::null) {
-            pole = p.second;
+          if (toolkit::has_substr(name, "LeftLeg") && pole == entt::null) {
+            pole = joint;
           }
-          if (toolkit::has_substr(p.first, "LeftUpLeg"))
-            root = p.second;
+          if (toolkit::has_substr(name, "LeftUpLeg"))
+            root = joint;
         }
       }
       if (left_foot_target == entt::null) {
@@ -129,5 +131,13 @@ public:
   entt::entity target = entt::null, pole = entt::null, root = entt::null;
   entt::entity left_foot_target = entt::null, left_foot_pole = entt::null;
 };
+inline void remap_entities(mixamo_manipulate &script,
+                           const toolkit::entity_remap &remap) {
+  script.target = remap(script.target);
+  script.pole = remap(script.pole);
+  script.root = remap(script.root);
+  script.left_foot_target = remap(script.left_foot_target);
+  script.left_foot_pole = remap(script.left_foot_pole);
+}
 DECLARE_SCRIPT(mixamo_manipulate, animation, left_foot_target, left_foot_pole,
                target, pole, root)
@@ -28,7 +28,7 @@ public:
       target = registry->create();
       auto &trans = registry->emplace<toolkit::transform>(target);
       auto &self_trans = registry->get<toolkit::transform>(entity);
-      trans.name = self_trans.name + " spring damper target";
+      trans.name = self_trans.name.str() + " spring damper target";
       trans.set_world_pos(self_trans.position());
       trans.set_world_rot(self_trans.rotation());
     }
@@ -88,4 +88,8 @@ public:
   float damper_half_life = 0.5f;
   entt::entity target = entt::null;
 };
+inline void remap_entities(spring_damper &script,
+                           const toolkit::entity_remap &remap) {
+  script.target = remap(script.target);
+}
 DECLARE_SCRIPT(spring_damper, animation, target, damper_half_life)
@@ -137,4 +137,8 @@ struct vis_point_sequence : public toolkit::scriptable {
 
   toolkit::assets::motion motion_data;
 };
+inline void remap_entities(vis_point_sequence &script,
+                           const toolkit::entity_remap &remap) {
+  remap(script.entities);
+}
 DECLARE_SCRIPT(vis_point_sequence, debug)
@@ -135,7 +135,7 @@ void draw_skeleton_gui(entt::registry &registry, entt::entity entity) {
 }
 
 void apply_pose(entt::registry &registry, actor &actor_comp,
-                assets::pose pose_data, assets::skeleton &pose_skel) {
+                const assets::pose &pose_data, assets::skeleton &pose_skel) {
   int pose_joint_num = pose_skel.get_num_joints();
   auto root = actor_comp.name_to_entity.find(pose_skel.joint_names[0]);
   if (root == actor_comp.name_to_entity.end()) {
@@ -144,14 +144,14 @@ void apply_pose(entt::registry &registry, actor &actor_comp,
     return;
   }
   int missing_joints_num = 0;
-  std::vector<std::string> missing_joint_names;
+  std::vector<interned_string> missing_joint_names;
   // apply root translation
   registry.get<transform>(root->second)
       .set_local_pos(pose_data.root_local_pos);
   // apply joint rotations for joints defined in the pose
   for (int pose_joint_ind = 0; pose_joint_ind < pose_joint_num;
        ++pose_joint_ind) {
-    auto boneName = pose_skel.joint_names[pose_joint_ind];
+    auto &boneName = pose_skel.joint_names[pose_joint_ind];
     auto joint_entity = actor_comp.name_to_entity.find(boneName);
     if (joint_entity == actor_comp.name_to_entity.end()) {
       missing_joints_num++;
@@ -165,7 +165,7 @@ void apply_pose(entt::registry &registry, actor &actor_comp,
   if (missing_joints_num > 0) {
     std::string concat_name_str = "";
     for (auto &name : missing_joint_names)
-      concat_name_str = concat_name_str + ", " + name;
+      concat_name_str = concat_name_str + ", " + name.str();
     spdlog::warn("{0} joints missing from entity skeleton, names: {1}",
                  missing_joints_num, concat_name_str);
   }
@@ -10,6 +10,8 @@ public:
   anim_system() {}
   ~anim_system() {}
 
+  void declare_access(system_access &access) override { access.none(); }
+
   void draw_gui(entt::registry &registry, entt::entity entity) override;
 };
 DECLARE_SYSTEM(anim_system)
@@ -19,7 +21,11 @@ void export_proxy_skeleton(entt::registry &registry, actor &actor_comp,
 
 void draw_skeleton_gui(entt::registry &registry, entt::entity entity);
 
+/**
+ * Joints are matched by name, the names of the pose skeleton and the actor
+ * are interned so the lookup per joint is an integer hash.
+ */
 void apply_pose(entt::registry &registry, actor &actor_comp,
-                assets::pose pose_data, assets::skeleton &pose_skel);
+                const assets::pose &pose_data, assets::skeleton &pose_skel);
 
 }; // namespace toolkit::anim
\ No newline at end of file
@@ -6,7 +6,8 @@ namespace toolkit::anim {
 entt::entity
 instantiate_skeleton_data(entt::registry &registry, assets::skeleton &skel,
                           std::vector<entt::entity> &ordered_entities,
-                          std::map<std::string, entt::entity> &name_to_entity) {
+                          std::unordered_map<interned_string, entt::entity>
+                              &name_to_entity) {
   name_to_entity.clear();
   ordered_entities.clear();
   // create entities
@@ -9,16 +9,22 @@ namespace toolkit::anim {
 struct actor : public icomponent {
   std::vector<bool> joint_active;
   std::vector<entt::entity> ordered_entities;
-  std::map<std::string, entt::entity> name_to_entity;
+  std::unordered_map<interned_string, entt::entity> name_to_entity;
 };
+inline void remap_entities(actor &comp, const entity_remap &remap) {
+  remap(comp.ordered_entities);
+  for (auto &p : comp.name_to_entity)
+    p.second = remap(p.second);
+}
 DECLARE_COMPONENT(actor, animation, joint_active, ordered_entities,
                   name_to_entity)
 
 struct bone_node : public icomponent {
-  std::string name;
+  interned_string name;
   math::matrix4 offset_matrix;
 };
 DECLARE_COMPONENT(bone_node, data, name, offset_matrix)
+SORT_WITH_HIERARCHY(bone_node)
 
 void create_actor_with_skeleton(entt::registry &registry,
                                 entt::entity container, assets::skeleton &skel);
@@ -41,7 +47,8 @@ estimate_actor_bone_hierarchy(entt::registry &registry, actor &actor_comp,
 entt::entity
 instantiate_skeleton_data(entt::registry &registry, assets::skeleton &skel,
                           std::vector<entt::entity> &ordered_entities,
-                          std::map<std::string, entt::entity> &name_to_entity);
+                          std::unordered_map<interned_string, entt::entity>
+                              &name_to_entity);
 
 entt::entity create_bvh_actor(entt::registry &registry, std::string filepath);
 
@@ -78,30 +78,41 @@ void vis_skeleton::draw_gui(iapp *app) {
 }
 
 void vis_skeleton::collect_skeleton_draw_queue(actor &actor_comp) {
-  draw_queue.clear();
-  active_joint_entities.clear();
-  for (int i = 0; i < actor_comp.joint_active.size(); i++)
-    if (actor_comp.joint_active[i])
-      active_joint_entities.insert(actor_comp.ordered_entities[i]);
-  auto [parent, children, roots] =
-      estimate_actor_bone_hierarchy(*registry, actor_comp, true);
-  for (auto root : roots) {
-    std::queue<int> q;
-    q.push(root);
-    while (!q.empty()) {
-      auto current = q.front();
-      auto &current_trans =
-          registry->get<transform>(actor_comp.ordered_entities[current]);
-      q.pop();
-      for (auto c : children[current]) {
-        auto &child_trans =
-            registry->get<transform>(actor_comp.ordered_entities[c]);
-        draw_queue.emplace_back(
-            std::make_pair(current_trans.position(), child_trans.position()));
-        q.push(c);
+  auto current_actor_version = component_version<actor>(*registry);
+  auto current_hierarchy_version =
+      component_version<transform_hierarchy>(*registry);
+  if (!hierarchy_cached || current_actor_version != actor_version ||
+      current_hierarchy_version != hierarchy_version) {
+    actor_version = current_actor_version;
+    hierarchy_version = current_hierarchy_version;
+    hierarchy_cached = true;
+    bones.clear();
+    active_joint_entities.clear();
+    for (int i = 0; i < actor_comp.joint_active.size(); i++)
+      if (actor_comp.joint_active[i])
+        active_joint_entities.insert(actor_comp.ordered_entities[i]);
+    auto [parent, children, roots] =
+        estimate_actor_bone_hierarchy(*registry, actor_comp, true);
+    for (auto root : roots) {
+      std::queue<int> q;
+      q.push(root);
+      while (!q.empty()) {
+        auto current = q.front();
+        q.pop();
+        for (auto c : children[current]) {
+          bones.emplace_back(actor_comp.ordered_entities[current],
+                             actor_comp.ordered_entities[c]);
+          q.push(c);
+        }
       }
     }
   }
+  draw_queue.clear();
+  draw_queue.reserve(bones.size());
+  for (auto &[parent, child] : bones)
+    draw_queue.emplace_back(
+        std::make_pair(registry->get<transform>(parent).position(),
+                       registry->get<transform>(child).position()));
 }
 
 }; // namespace toolkit::anim
\ No newline at end of file
@@ -22,6 +22,12 @@ public:
   void collect_skeleton_draw_queue(actor &actor_comp);
 
 private:
+  // the bone hierarchy is only estimated again when the actor components or
+  // the transform hierarchy changed
+  std::uint64_t actor_version = 0, hierarchy_version = 0;
+  bool hierarchy_cached = false;
+  std::vector<std::pair<entt::entity, entt::entity>> bones;
+
   std::set<entt::entity> active_joint_entities;
   std::vector<math::vector3> joint_positions;
   std::vector<std::pair<math::vector3, math::vector3>> draw_queue, x_dir, y_dir,
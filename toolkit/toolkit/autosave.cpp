@@ -0,0 +1,399 @@
+#include "toolkit/autosave.hpp"
+#include "toolkit/binary_scene.hpp"
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+constexpr char journal_magic[4] = {'T', 'K', 'J', 'L'};
+constexpr std::uint32_t journal_version = 1;
+constexpr std::uint64_t journal_header_size = 8;
+
+/**
+ * A journal record has the layout
+ *   {"created": [entity], "destroyed": [entity],
+ *    "removed": {component: [entity]},
+ *    "changed": {component: {"entities": [entity], "data": [component]}},
+ *    "meta": {systems and late_serialize data, only if they changed}}
+ * and is applied in this order: created, removed, changed, destroyed.
+ */
+void autosave_state::apply(const nlohmann::json &record) {
+  if (record.contains("created"))
+    for (auto &e : record["created"])
+      entities.insert(e.get<std::uint32_t>());
+  if (record.contains("removed"))
+    for (auto &[name, ids] : record["removed"].items()) {
+      auto &column = components[name];
+      for (auto &e : ids)
+        column.erase(e.get<std::uint32_t>());
+    }
+  if (record.contains("changed"))
+    for (auto &[name, section] : record["changed"].items()) {
+      auto &column = components[name];
+      auto &ids = section["entities"];
+      auto &data = section["data"];
+      for (std::size_t i = 0; i < ids.size() && i < data.size(); i++)
+        column[ids[i].get<std::uint32_t>()] = data[i];
+    }
+  if (record.contains("destroyed"))
+    for (auto &e : record["destroyed"]) {
+      auto id = e.get<std::uint32_t>();
+      entities.erase(id);
+      for (auto &[name, column] : components)
+        column.erase(id);
+    }
+  if (record.contains("meta"))
+    meta = record["meta"];
+}
+
+bool autosave_state::load_snapshot(const std::string &filepath) {
+  scene_reader reader;
+  if (!std::filesystem::exists(filepath) || !reader.open(filepath) ||
+      !reader.is_scene())
+    return false;
+  entities.clear();
+  components.clear();
+  for (auto e : reader.entities())
+    entities.insert(entt::to_integral(e));
+  for (auto &section : reader.sections()) {
+    auto data = reader.section_data(section);
+    if (section.name == std::string(scene_meta_section)) {
+      meta = std::move(data);
+      continue;
+    }
+    auto ids = reader.section_entities(section);
+    auto &column = components[section.name];
+    for (std::size_t i = 0; i < ids.size() && i < data.size(); i++)
+      column[entt::to_integral(ids[i])] = std::move(data[i]);
+  }
+  return true;
+}
+
+bool autosave_state::load_journal(const std::string &filepath) {
+  std::ifstream input(filepath, std::ios::binary);
+  char magic[4];
+  std::uint32_t version;
+  if (!input.is_open() || !input.read(magic, 4) ||
+      std::memcmp(magic, journal_magic, 4) != 0 ||
+      !input.read(reinterpret_cast<char *>(&version), sizeof(version)) ||
+      version > journal_version)
+    return false;
+  std::uint32_t size;
+  std::vector<std::uint8_t> bytes;
+  while (input.read(reinterpret_cast<char *>(&size), sizeof(size))) {
+    bytes.resize(size);
+    // the last record can be incomplete if the application crashed
+    if (!input.read(reinterpret_cast<char *>(bytes.data()), size))
+      break;
+    auto record = nlohmann::json::from_cbor(bytes, true, false);
+    if (record.is_discarded())
+      break;
+    apply(record);
+  }
+  return true;
+}
+
+bool autosave_state::write_snapshot(const std::string &filepath) const {
+  scene_writer writer;
+  std::vector<entt::entity> entity_table;
+  for (auto id : entities)
+    entity_table.push_back(entt::entity{id});
+  writer.set_entities(entity_table);
+  for (auto &[name, column] : components) {
+    if (column.empty())
+      continue;
+    std::vector<entt::entity> ids;
+    nlohmann::json data = nlohmann::json::array();
+    for (auto &[id, comp] : column) {
+      ids.push_back(entt::entity{id});
+      data.push_back(comp);
+    }
+    writer.add_section(name, ids, nlohmann::json::to_cbor(data));
+  }
+  writer.add_section(scene_meta_section, {}, nlohmann::json::to_cbor(meta));
+  // write to a temporary file first so a crash never leaves a broken snapshot
+  auto tmp_path = filepath + ".tmp";
+  if (!writer.write(tmp_path, scene_magic))
+    return false;
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, filepath, ec);
+  if (ec) {
+    spdlog::error("Failed to replace autosave snapshot {0}: {1}", filepath,
+                  ec.message());
+    return false;
+  }
+  return true;
+}
+
+autosave_system::~autosave_system() {
+  if (registry != nullptr)
+    disconnect_component_listener(*registry, *this);
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv.notify_all();
+  if (worker.joinable())
+    worker.join();
+}
+
+void autosave_system::init0(entt::registry &registry) {
+  this->registry = &registry;
+  types.clear();
+  for (auto &[name, p] : iapp::__comp_listen_callbacks__) {
+    auto it = iapp::__comp_column_callbacks__.find(name);
+    if (it == iapp::__comp_column_callbacks__.end())
+      continue;
+    types[p.first] = type_changes{name, it->second.first, {}, {}};
+  }
+  connect_component_listener(registry, *this);
+  // entities existing before this system gets added are saved as well
+  for (auto entity : registry.view<entt::entity>()) {
+    created.push_back(entity);
+    mark_components_changed(registry, entity);
+  }
+  if (!worker.joinable())
+    worker = std::thread([this]() { worker_loop(); });
+}
+
+void autosave_system::on_entity_created(entt::registry &registry,
+                                        entt::entity entity) {
+  created.push_back(entity);
+}
+void autosave_system::on_entity_destroyed(entt::registry &registry,
+                                          entt::entity entity) {
+  destroyed.push_back(entity);
+}
+void autosave_system::on_component_changed(entt::id_type type,
+                                           entt::registry &registry,
+                                           entt::entity entity) {
+  auto it = types.find(type);
+  if (it != types.end())
+    it->second.changed.insert(entity);
+}
+void autosave_system::on_component_removed(entt::id_type type,
+                                           entt::registry &registry,
+                                           entt::entity entity) {
+  auto it = types.find(type);
+  if (it != types.end())
+    it->second.removed.push_back(entity);
+}
+
+bool autosave_system::has_pending() const {
+  if (!created.empty() || !destroyed.empty())
+    return true;
+  for (auto &[type, changes] : types)
+    if (!changes.changed.empty() || !changes.removed.empty())
+      return true;
+  return false;
+}
+
+nlohmann::json autosave_system::make_record(int budget, bool with_meta) {
+  bool limited = budget > 0;
+  auto app = registry->ctx().get<iapp *>();
+  // streamed entities are stored in their own files
+  auto &transient = app->transient_entities;
+  if (!transient.empty())
+    std::erase_if(created,
+                  [&](entt::entity e) { return transient.count(e) > 0; });
+  nlohmann::json record;
+  if (!created.empty())
+    record["created"] = created;
+  if (!destroyed.empty())
+    record["destroyed"] = destroyed;
+  created.clear();
+  destroyed.clear();
+  for (auto &[type, changes] : types) {
+    if (!changes.removed.empty()) {
+      record["removed"][changes.name] = changes.removed;
+      changes.removed.clear();
+    }
+    if (changes.changed.empty() || (limited && budget <= 0))
+      continue;
+    std::vector<entt::entity> subset;
+    auto it = changes.changed.begin();
+    while (it != changes.changed.end() && (!limited || budget > 0)) {
+      if (registry->valid(*it) && transient.count(*it) == 0) {
+        subset.push_back(*it);
+        budget--;
+      }
+      it = changes.changed.erase(it);
+    }
+    std::vector<entt::entity> entities;
+    nlohmann::json data = nlohmann::json::array();
+    changes.writer(*registry, &subset, entities, data);
+    if (!entities.empty()) {
+      record["changed"][changes.name]["entities"] = entities;
+      record["changed"][changes.name]["data"] = std::move(data);
+    }
+  }
+  if (with_meta) {
+    nlohmann::json meta, sys;
+    for (auto &p0 : iapp::__sys_serializer_callbacks__)
+      p0.second.first(app, sys);
+    meta["systems"] = sys;
+    app->late_serialize(meta);
+    if (meta != last_meta) {
+      record["meta"] = meta;
+      last_meta = std::move(meta);
+    }
+  }
+  return record;
+}
+
+void autosave_system::push_record(nlohmann::json &&record) {
+  if (record.is_null())
+    return;
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    records.emplace_back(std::move(record));
+  }
+  cv.notify_one();
+}
+
+void autosave_system::lateupdate(entt::registry &registry, float dt) {
+  time_since_flush += dt;
+  if (time_since_flush >= flush_interval) {
+    time_since_flush = 0.0f;
+    push_record(make_record(frame_budget, true));
+    draining = has_pending();
+  } else if (draining) {
+    // the backlog left by the frame budget is written on the following frames
+    push_record(make_record(frame_budget, false));
+    draining = has_pending();
+  }
+}
+
+void autosave_system::flush() {
+  push_record(make_record(0, true));
+  draining = false;
+  std::unique_lock<std::mutex> lock(mtx);
+  idle_cv.wait(lock, [this]() { return records.empty() && !busy; });
+}
+
+void autosave_system::draw_menu_gui() {
+  ImGui::DragFloat("Flush Interval", &flush_interval, 0.1f, 0.1f, 60.0f);
+  ImGui::InputInt("Frame Budget", &frame_budget);
+  if (ImGui::MenuItem("Save Now"))
+    flush();
+}
+
+std::string autosave_system::snapshot_path(const std::string &directory) {
+  return join_path(directory, "autosave.scene");
+}
+std::string autosave_system::journal_path(const std::string &directory) {
+  return join_path(directory, "autosave.journal");
+}
+std::string
+autosave_system::previous_snapshot_path(const std::string &directory) {
+  return join_path(directory, "autosave.previous.scene");
+}
+std::string
+autosave_system::previous_journal_path(const std::string &directory) {
+  return join_path(directory, "autosave.previous.journal");
+}
+
+void autosave_system::rotate_previous_session(const std::string &directory) {
+  // only the files left by another process are rotated, a scene reset starts
+  // a new autosave_system but not a new session
+  static std::mutex rotate_mtx;
+  static std::set<std::string> rotated;
+  std::unique_lock<std::mutex> lock(rotate_mtx);
+  if (!rotated.insert(directory).second)
+    return;
+  std::error_code ec;
+  if (!std::filesystem::exists(snapshot_path(directory), ec) &&
+      !std::filesystem::exists(journal_path(directory), ec))
+    return;
+  std::filesystem::remove(previous_snapshot_path(directory), ec);
+  std::filesystem::remove(previous_journal_path(directory), ec);
+  std::filesystem::rename(snapshot_path(directory),
+                          previous_snapshot_path(directory), ec);
+  std::filesystem::rename(journal_path(directory),
+                          previous_journal_path(directory), ec);
+}
+
+void autosave_system::reset_files() {
+  journal.close();
+  journal.open(journal_path(directory), std::ios::binary | std::ios::trunc);
+  if (!journal.is_open()) {
+    spdlog::error("Failed to open autosave journal {0}",
+                  journal_path(directory));
+    return;
+  }
+  journal.write(journal_magic, 4);
+  journal.write(reinterpret_cast<const char *>(&journal_version),
+                sizeof(journal_version));
+  journal.flush();
+  journal_bytes = journal_header_size;
+}
+
+void autosave_system::write_record(const nlohmann::json &record) {
+  if (!files_ready) {
+    // a new session starts from an empty state, the previous session is kept
+    // aside so it can still be recovered
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    rotate_previous_session(directory);
+    std::filesystem::remove(snapshot_path(directory), ec);
+    reset_files();
+    files_ready = true;
+  }
+  state.apply(record);
+  if (!journal.is_open())
+    return;
+  auto bytes = nlohmann::json::to_cbor(record);
+  std::uint32_t size = bytes.size();
+  journal.write(reinterpret_cast<const char *>(&size), sizeof(size));
+  journal.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  journal.flush();
+  journal_bytes += sizeof(size) + bytes.size();
+  if (journal_bytes > compact_threshold) {
+    if (state.write_snapshot(snapshot_path(directory)))
+      reset_files();
+  }
+}
+
+void autosave_system::worker_loop() {
+  while (true) {
+    nlohmann::json record;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [this]() { return stop || !records.empty(); });
+      if (records.empty()) {
+        if (stop)
+          return;
+        continue;
+      }
+      record = std::move(records.front());
+      records.pop_front();
+      busy = true;
+    }
+    write_record(record);
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      busy = false;
+    }
+    idle_cv.notify_all();
+  }
+}
+
+bool autosave_system::recover(iapp *app, const std::string &directory) {
+  rotate_previous_session(directory);
+  autosave_state recovered;
+  bool has_snapshot =
+      recovered.load_snapshot(previous_snapshot_path(directory));
+  bool has_journal = recovered.load_journal(previous_journal_path(directory));
+  if (!has_snapshot && !has_journal) {
+    spdlog::error("No autosave found in {0}", directory);
+    return false;
+  }
+  // merge snapshot and journal into one file so the regular loader can be used
+  auto recovered_path = join_path(directory, "recovered.scene");
+  if (!recovered.write_snapshot(recovered_path))
+    return false;
+  return app->deserialize_binary(recovered_path);
+}
+
+}; // namespace toolkit
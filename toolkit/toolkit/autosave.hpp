@@ -0,0 +1,124 @@
+#pragma once
+
+#include "toolkit/system.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace toolkit {
+
+/**
+ * The scene state reconstructed from the autosave snapshot and journal,
+ * component data is kept in its json form.
+ */
+struct autosave_state {
+  std::set<std::uint32_t> entities;
+  std::map<std::string, std::map<std::uint32_t, nlohmann::json>> components;
+  nlohmann::json meta;
+
+  void apply(const nlohmann::json &record);
+  bool load_snapshot(const std::string &filepath);
+  bool load_journal(const std::string &filepath);
+  bool write_snapshot(const std::string &filepath) const;
+};
+
+/**
+ * Incremental autosave. Changed entities and components are collected through
+ * a `component_listener`, only the changed components are encoded on the main
+ * thread. A worker thread appends the encoded changes to a journal and keeps
+ * an `autosave_state` up to date, once the journal grows larger than
+ * `compact_threshold` bytes the state is written as a binary scene snapshot
+ * and the journal gets truncated.
+ *
+ * Components modified without going through the registry won't be noticed,
+ * call `registry.patch` or `mark_components_changed` after such modification.
+ */
+class autosave_system : public isystem, public component_listener {
+public:
+  autosave_system() {}
+  ~autosave_system();
+
+  void init0(entt::registry &registry) override;
+  void lateupdate(entt::registry &registry, float dt) override;
+  void draw_menu_gui() override;
+  std::string get_name() override { return "Autosave"; }
+
+  void on_entity_created(entt::registry &registry,
+                         entt::entity entity) override;
+  void on_entity_destroyed(entt::registry &registry,
+                           entt::entity entity) override;
+  void on_component_changed(entt::id_type type, entt::registry &registry,
+                            entt::entity entity) override;
+  void on_component_removed(entt::id_type type, entt::registry &registry,
+                            entt::entity entity) override;
+
+  /**
+   * Encode all pending changes regardless of the frame budget and wait until
+   * the worker has written them.
+   */
+  void flush();
+
+  /**
+   * Rebuild the scene autosaved by the previous session from `directory` and
+   * load it into `app`. Returns false if there's nothing to recover.
+   */
+  static bool recover(iapp *app, const std::string &directory);
+  static std::string snapshot_path(const std::string &directory);
+  static std::string journal_path(const std::string &directory);
+  static std::string previous_snapshot_path(const std::string &directory);
+  static std::string previous_journal_path(const std::string &directory);
+
+  /**
+   * Move the files of the previous session to the `previous_` paths before
+   * this session writes its own, done once per process and directory. The
+   * moved files are kept until the next session starts.
+   */
+  static void rotate_previous_session(const std::string &directory);
+
+  std::string directory = "autosave";
+  float flush_interval = 2.0f;
+  // maximum number of components encoded in one frame, 0 for no limit
+  int frame_budget = 4096;
+  std::uint64_t compact_threshold = 64ull << 20;
+
+private:
+  struct type_changes {
+    std::string name;
+    iapp::column_writer writer;
+    std::unordered_set<entt::entity> changed;
+    std::vector<entt::entity> removed;
+  };
+
+  bool has_pending() const;
+  nlohmann::json make_record(int budget, bool with_meta);
+  void push_record(nlohmann::json &&record);
+  void worker_loop();
+  void write_record(const nlohmann::json &record);
+  void reset_files();
+
+  entt::registry *registry = nullptr;
+  std::map<entt::id_type, type_changes> types;
+  std::vector<entt::entity> created, destroyed;
+  nlohmann::json last_meta;
+  float time_since_flush = 0.0f;
+  bool draining = false;
+
+  // only accessed by the worker thread
+  autosave_state state;
+  std::ofstream journal;
+  std::uint64_t journal_bytes = 0;
+  bool files_ready = false;
+
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cv, idle_cv;
+  std::deque<nlohmann::json> records;
+  bool busy = false, stop = false;
+};
+DECLARE_SYSTEM(autosave_system, directory, flush_interval, frame_budget,
+               compact_threshold)
+
+}; // namespace toolkit
@@ -0,0 +1,309 @@
+#include "toolkit/binary_scene.hpp"
+#include "toolkit/jobs.hpp"
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace toolkit {
+
+bool mapped_file::open(const std::string &filepath) {
+  close();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+  void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (ptr == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const std::uint8_t *>(ptr);
+  m_size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (ptr == MAP_FAILED)
+    return false;
+  m_data = static_cast<const std::uint8_t *>(ptr);
+  m_size = static_cast<std::size_t>(st.st_size);
+#endif
+  return true;
+}
+
+void mapped_file::close() {
+  if (m_data == nullptr)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+  CloseHandle(m_file);
+  m_mapping = m_file = nullptr;
+#else
+  munmap(const_cast<std::uint8_t *>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+void scene_writer::set_entities(const std::vector<entt::entity> &entities) {
+  m_entities = entities;
+}
+
+void scene_writer::add_section(const std::string &name,
+                               const std::vector<entt::entity> &entities,
+                               const std::vector<std::uint8_t> &payload) {
+  if (name.size() >= sizeof(scene_section_entry::name)) {
+    spdlog::error("Section name {0} is too long, skip this section", name);
+    return;
+  }
+  m_sections.push_back(pending_section{name, entities, payload});
+}
+
+template <typename T> static void write_raw(std::ofstream &out, const T &v) {
+  out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+static void write_entity_ids(std::ofstream &out,
+                             const std::vector<entt::entity> &entities) {
+  std::vector<std::uint32_t> ids(entities.size());
+  for (std::size_t i = 0; i < entities.size(); i++)
+    ids[i] = static_cast<std::uint32_t>(entt::to_integral(entities[i]));
+  out.write(reinterpret_cast<const char *>(ids.data()),
+            ids.size() * sizeof(std::uint32_t));
+}
+
+bool scene_writer::write(const std::string &filepath, const char magic[4]) {
+  std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    spdlog::error("Failed to open {0} for writing", filepath);
+    return false;
+  }
+  scene_file_header header{};
+  std::memcpy(header.magic, magic, 4);
+  header.version = scene_format_version;
+  header.entity_count = m_entities.size();
+  header.entity_table_offset = sizeof(scene_file_header);
+  header.section_count = m_sections.size();
+  // the header is rewritten once the section index offset is known
+  write_raw(out, header);
+  write_entity_ids(out, m_entities);
+
+  std::vector<scene_section_entry> index;
+  for (auto &section : m_sections) {
+    scene_section_entry entry{};
+    std::memcpy(entry.name, section.name.c_str(), section.name.size());
+    entry.offset = static_cast<std::uint64_t>(out.tellp());
+    entry.count = section.entities.size();
+    write_entity_ids(out, section.entities);
+    out.write(reinterpret_cast<const char *>(section.payload.data()),
+              section.payload.size());
+    entry.size = static_cast<std::uint64_t>(out.tellp()) - entry.offset;
+    index.push_back(entry);
+  }
+  header.section_index_offset = static_cast<std::uint64_t>(out.tellp());
+  out.write(reinterpret_cast<const char *>(index.data()),
+            index.size() * sizeof(scene_section_entry));
+  out.seekp(0);
+  write_raw(out, header);
+  out.close();
+  if (!out) {
+    spdlog::error("Failed to write {0}", filepath);
+    return false;
+  }
+  return true;
+}
+
+bool scene_reader::open(const std::string &filepath) {
+  m_sections.clear();
+  if (!m_file.open(filepath)) {
+    spdlog::error("Failed to map file {0}", filepath);
+    return false;
+  }
+  auto size = m_file.size();
+  if (size < sizeof(scene_file_header)) {
+    spdlog::error("File {0} is too small to be a binary scene", filepath);
+    return false;
+  }
+  std::memcpy(&m_header, m_file.data(), sizeof(scene_file_header));
+  if (!is_scene() && !is_prefab()) {
+    spdlog::error("File {0} is not a binary scene or prefab", filepath);
+    return false;
+  }
+  if (m_header.version > scene_format_version) {
+    spdlog::error("File {0} has version {1}, only versions up to {2} are "
+                  "supported",
+                  filepath, m_header.version, scene_format_version);
+    return false;
+  }
+  auto in_range = [&](std::uint64_t offset, std::uint64_t bytes) {
+    return offset <= size && bytes <= size - offset;
+  };
+  if (!in_range(m_header.entity_table_offset,
+                m_header.entity_count * sizeof(std::uint32_t)) ||
+      !in_range(m_header.section_index_offset,
+                m_header.section_count * sizeof(scene_section_entry))) {
+    spdlog::error("File {0} is truncated", filepath);
+    return false;
+  }
+  m_sections.resize(m_header.section_count);
+  std::memcpy(m_sections.data(), m_file.data() + m_header.section_index_offset,
+              m_sections.size() * sizeof(scene_section_entry));
+  for (auto &section : m_sections) {
+    section.name[sizeof(section.name) - 1] = '\0';
+    if (!in_range(section.offset, section.size) ||
+        section.count * sizeof(std::uint32_t) > section.size) {
+      spdlog::error("Section {0} of file {1} is corrupted", section.name,
+                    filepath);
+      m_sections.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool scene_reader::is_scene() const {
+  return std::memcmp(m_header.magic, scene_magic, 4) == 0;
+}
+bool scene_reader::is_prefab() const {
+  return std::memcmp(m_header.magic, prefab_magic, 4) == 0;
+}
+
+static std::vector<entt::entity> read_entity_ids(const std::uint8_t *ptr,
+                                                 std::size_t count) {
+  std::vector<std::uint32_t> ids(count);
+  std::memcpy(ids.data(), ptr, count * sizeof(std::uint32_t));
+  std::vector<entt::entity> entities(count);
+  for (std::size_t i = 0; i < count; i++)
+    entities[i] = entt::entity{ids[i]};
+  return entities;
+}
+
+std::vector<entt::entity> scene_reader::entities() const {
+  return read_entity_ids(m_file.data() + m_header.entity_table_offset,
+                         m_header.entity_count);
+}
+
+const scene_section_entry *
+scene_reader::find_section(const std::string &name) const {
+  for (auto &section : m_sections)
+    if (name == section.name)
+      return &section;
+  return nullptr;
+}
+
+std::vector<entt::entity>
+scene_reader::section_entities(const scene_section_entry &section) const {
+  return read_entity_ids(m_file.data() + section.offset, section.count);
+}
+
+nlohmann::json
+scene_reader::section_data(const scene_section_entry &section) const {
+  auto begin =
+      m_file.data() + section.offset + section.count * sizeof(std::uint32_t);
+  auto end = m_file.data() + section.offset + section.size;
+  return nlohmann::json::from_cbor(begin, end);
+}
+
+bool is_binary_scene_file(const std::string &filepath) {
+  std::ifstream input(filepath, std::ios::binary);
+  char magic[4];
+  if (!input.is_open() || !input.read(magic, 4))
+    return false;
+  return std::memcmp(magic, scene_magic, 4) == 0 ||
+         std::memcmp(magic, prefab_magic, 4) == 0;
+}
+
+void write_component_sections(scene_writer &writer, entt::registry &registry,
+                              const std::vector<entt::entity> *subset) {
+  for (auto &[name, ops] : iapp::__comp_column_callbacks__) {
+    std::vector<entt::entity> entities;
+    nlohmann::json data = nlohmann::json::array();
+    ops.first(registry, subset, entities, data);
+    if (entities.empty())
+      continue;
+    writer.add_section(name, entities, nlohmann::json::to_cbor(data));
+  }
+}
+
+std::vector<std::function<void(entt::registry &)>>
+decode_component_sections(const scene_reader &reader,
+                          const std::map<entt::entity, entt::entity> *remap) {
+  auto &jobs = job_system::instance();
+  job_counter counter;
+  std::vector<std::function<void(entt::registry &)>> commits(
+      reader.sections().size());
+  auto commit = commits.begin();
+  for (auto &section : reader.sections()) {
+    auto &result = *commit++;
+    auto it = iapp::__comp_column_callbacks__.find(section.name);
+    if (it == iapp::__comp_column_callbacks__.end()) {
+      if (section.name != std::string(scene_meta_section))
+        spdlog::warn("Component type {0} is not registered, skip its section",
+                     section.name);
+      continue;
+    }
+    auto &decode = it->second.second;
+    jobs.run(
+        [&reader, &section, &decode, &result, remap]() {
+          // entity references inside the components are remapped with
+          // `remap` as well, the workers are shared so they must not keep the
+          // mapping
+          entity_mapping_scope scope(remap);
+          try {
+            auto entities = reader.section_entities(section);
+            if (remap != nullptr)
+              for (auto &e : entities)
+                e = remap->at(e);
+            auto data = reader.section_data(section);
+            if (data.size() != entities.size()) {
+              spdlog::error("Section {0} has {1} entities but {2} components",
+                            section.name, entities.size(), data.size());
+              return;
+            }
+            result = decode(std::move(entities), data);
+          } catch (std::exception &e) {
+            spdlog::error("Failed to decode component section: {0}", e.what());
+          }
+        },
+        &counter);
+  }
+  jobs.wait(counter);
+  std::erase_if(commits, [](auto &commit) { return !commit; });
+  return commits;
+}
+
+}; // namespace toolkit
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "toolkit/system.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace toolkit {
+
+/**
+ * Binary container used for `.scene` and `.prefab` files. The layout is
+ *
+ *   header | entity table | component sections ... | section index
+ *
+ * The entity table stores the original entity ids as uint32. Each component
+ * section stores the ids of the owning entities followed by a CBOR array with
+ * one element per entity. The section index is a flat array of
+ * `scene_section_entry` so a reader can locate any component type without
+ * touching the other sections, this is what allows lazy and parallel decoding
+ * of mmapped files.
+ */
+constexpr std::uint32_t scene_format_version = 1;
+constexpr char scene_magic[4] = {'T', 'K', 'S', 'C'};
+constexpr char prefab_magic[4] = {'T', 'K', 'P', 'F'};
+// section holding systems and late_serialize data, only present in scenes
+constexpr const char *scene_meta_section = "__meta__";
+
+#pragma pack(push, 1)
+struct scene_file_header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t entity_count;
+  std::uint64_t entity_table_offset;
+  std::uint64_t section_count;
+  std::uint64_t section_index_offset;
+};
+struct scene_section_entry {
+  char name[64];
+  std::uint64_t offset;
+  std::uint64_t size;
+  // number of entities stored in this section
+  std::uint64_t count;
+};
+#pragma pack(pop)
+
+/**
+ * Read-only memory mapping of a whole file, the mapping is released in the
+ * destructor.
+ */
+class mapped_file {
+public:
+  mapped_file() {}
+  ~mapped_file() { close(); }
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  bool open(const std::string &filepath);
+  void close();
+
+  const std::uint8_t *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  bool is_open() const { return m_data != nullptr; }
+
+private:
+  const std::uint8_t *m_data = nullptr;
+  std::size_t m_size = 0;
+#ifdef _WIN32
+  void *m_file = nullptr, *m_mapping = nullptr;
+#endif
+};
+
+class scene_writer {
+public:
+  void set_entities(const std::vector<entt::entity> &entities);
+  void add_section(const std::string &name,
+                   const std::vector<entt::entity> &entities,
+                   const std::vector<std::uint8_t> &payload);
+  /**
+   * Write all sections to `filepath`, `magic` should be `scene_magic` or
+   * `prefab_magic`. Returns false if the file can't be written.
+   */
+  bool write(const std::string &filepath, const char magic[4]);
+
+private:
+  struct pending_section {
+    std::string name;
+    std::vector<entt::entity> entities;
+    std::vector<std::uint8_t> payload;
+  };
+  std::vector<entt::entity> m_entities;
+  std::vector<pending_section> m_sections;
+};
+
+class scene_reader {
+public:
+  /**
+   * Map the file and validate its header and section index, nothing gets
+   * decoded at this stage.
+   */
+  bool open(const std::string &filepath);
+
+  bool is_scene() const;
+  bool is_prefab() const;
+  const scene_file_header &header() const { return m_header; }
+
+  std::vector<entt::entity> entities() const;
+  const std::vector<scene_section_entry> &sections() const {
+    return m_sections;
+  }
+  const scene_section_entry *find_section(const std::string &name) const;
+  std::vector<entt::entity>
+  section_entities(const scene_section_entry &section) const;
+  /**
+   * Decode the CBOR payload of a section, safe to call from multiple threads
+   * as long as the reader stays alive.
+   */
+  nlohmann::json section_data(const scene_section_entry &section) const;
+
+private:
+  mapped_file m_file;
+  scene_file_header m_header{};
+  std::vector<scene_section_entry> m_sections;
+};
+
+/**
+ * Check the magic bytes of a file, used to tell binary scenes and prefabs
+ * apart from the legacy json ones.
+ */
+bool is_binary_scene_file(const std::string &filepath);
+
+/**
+ * Encode one section per registered component type. If `subset` is not
+ * nullptr only the entities inside it are written.
+ */
+void write_component_sections(scene_writer &writer, entt::registry &registry,
+                              const std::vector<entt::entity> *subset);
+
+/**
+ * Decode all component sections in parallel, entity ids are remapped with
+ * `remap` if it's not nullptr. The returned functions add the decoded
+ * components to the registry and must be executed on the thread owning the
+ * registry.
+ */
+std::vector<std::function<void(entt::registry &)>>
+decode_component_sections(const scene_reader &reader,
+                          const std::map<entt::entity, entt::entity> *remap);
+
+}; // namespace toolkit
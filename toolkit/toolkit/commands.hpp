@@ -0,0 +1,109 @@
+#pragma once
+
+#include "toolkit/transform.hpp"
+
+namespace toolkit {
+
+/**
+ * Structural changes recorded while the registry can't be modified, e.g. by
+ * scripts updating on worker threads, and applied later on the main thread
+ * with `replay`. Commands run in the order they were recorded, the ones
+ * referring to entities destroyed in the meantime are skipped.
+ */
+class command_buffer {
+public:
+  /**
+   * Create an entity on replay, `init` receives it to add components or
+   * record it somewhere.
+   */
+  void create(std::function<void(entt::registry &, entt::entity)> init = {}) {
+    push([init = std::move(init)](entt::registry &registry) {
+      auto entity = registry.create();
+      if (init)
+        init(registry, entity);
+    });
+  }
+  // emplace or replace the component
+  template <typename T, typename... Args>
+  void emplace(entt::entity entity, Args &&...args) {
+    push([entity, value = T(std::forward<Args>(args)...)](
+             entt::registry &registry) mutable {
+      if (registry.valid(entity))
+        registry.emplace_or_replace<T>(entity, std::move(value));
+    });
+  }
+  template <typename T> void remove(entt::entity entity) {
+    push([entity](entt::registry &registry) {
+      if (registry.valid(entity))
+        registry.remove<T>(entity);
+    });
+  }
+  // notify the observers of `T` that the component changed
+  template <typename T> void patch(entt::entity entity) {
+    push([entity](entt::registry &registry) {
+      if (registry.valid(entity) && registry.all_of<T>(entity))
+        registry.patch<T>(entity);
+    });
+  }
+  // entities with a transform are destroyed with their children
+  void destroy(entt::entity entity) {
+    push([entity](entt::registry &registry) {
+      if (!registry.valid(entity))
+        return;
+      if (registry.all_of<transform>(entity))
+        destroy_hierarchy(registry, entity);
+      else
+        registry.destroy(entity);
+    });
+  }
+  void set_parent(entt::entity child, entt::entity parent,
+                  bool keep_transform = true) {
+    push([=](entt::registry &registry) {
+      if (registry.valid(child) && registry.valid(parent))
+        registry.get<transform>(child).set_parent(parent, keep_transform);
+    });
+  }
+  void push(std::function<void(entt::registry &)> &&command) {
+    commands.push_back(std::move(command));
+  }
+
+  void replay(entt::registry &registry) {
+    // commands may record new commands into this buffer
+    for (std::size_t i = 0; i < commands.size(); i++) {
+      auto command = std::move(commands[i]);
+      command(registry);
+    }
+    commands.clear();
+  }
+  bool empty() const { return commands.empty(); }
+  std::size_t size() const { return commands.size(); }
+
+  /**
+   * The buffer structural changes on this thread should go to, it's set by
+   * `command_scope`, nullptr outside of one.
+   */
+  static command_buffer *current() { return current_buffer; }
+
+private:
+  friend class command_scope;
+  static inline thread_local command_buffer *current_buffer = nullptr;
+  std::vector<std::function<void(entt::registry &)>> commands;
+};
+
+/**
+ * Makes `buffer` the current command buffer of this thread while it's alive.
+ */
+class command_scope {
+public:
+  explicit command_scope(command_buffer &buffer)
+      : previous(command_buffer::current_buffer) {
+    command_buffer::current_buffer = &buffer;
+  }
+  command_scope(const command_scope &) = delete;
+  ~command_scope() { command_buffer::current_buffer = previous; }
+
+private:
+  command_buffer *previous;
+};
+
+}; // namespace toolkit
@@ -0,0 +1,61 @@
+#include "toolkit/frame_arena.hpp"
+#include <algorithm>
+
+namespace toolkit {
+
+frame_arena::frame_arena(std::size_t block_size) : block_size(block_size) {}
+
+frame_arena &frame_arena::instance() {
+  static frame_arena arena;
+  return arena;
+}
+
+void frame_arena::reset() {
+  // the frame outgrew the first block, merge the blocks so the next frame
+  // fits into one
+  if (blocks.size() > 1) {
+    std::size_t total = capacity();
+    blocks.clear();
+    blocks.push_back(
+        {std::unique_ptr<std::byte[]>(new std::byte[total]), total});
+  }
+  current = 0;
+  offset = 0;
+  used_by_full_blocks = 0;
+}
+
+std::size_t frame_arena::used() const {
+  return used_by_full_blocks + offset;
+}
+
+std::size_t frame_arena::capacity() const {
+  std::size_t total = 0;
+  for (auto &b : blocks)
+    total += b.size;
+  return total;
+}
+
+void *frame_arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  while (current < blocks.size()) {
+    auto &b = blocks[current];
+    std::size_t space = b.size - offset;
+    void *ptr = b.data.get() + offset;
+    if (std::align(alignment, bytes, ptr, space)) {
+      offset = static_cast<std::byte *>(ptr) - b.data.get() + bytes;
+      return ptr;
+    }
+    // the rest of the block is wasted until the next reset
+    used_by_full_blocks += b.size;
+    current++;
+    offset = 0;
+  }
+  std::size_t size = std::max(block_size, bytes + alignment);
+  blocks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+  current = blocks.size() - 1;
+  void *ptr = blocks[current].data.get();
+  std::align(alignment, bytes, ptr, size);
+  offset = static_cast<std::byte *>(ptr) - blocks[current].data.get() + bytes;
+  return ptr;
+}
+
+}; // namespace toolkit
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace toolkit {
+
+/**
+ * Linear allocator for the containers living no longer than one frame. It
+ * hands out memory by bumping an offset into large blocks, deallocation does
+ * nothing, and `reset` makes all blocks available again once the frame is
+ * over. Pass it to the `std::pmr` containers:
+ *
+ *   std::pmr::vector<math::vector3> points(&frame_arena::instance());
+ *
+ * The instance belongs to the main thread and is reset at the end of every
+ * frame by the main loop, don't keep its allocations across frames or hand
+ * it to other threads.
+ */
+class frame_arena : public std::pmr::memory_resource {
+public:
+  explicit frame_arena(std::size_t block_size = 1 << 20);
+  frame_arena(const frame_arena &) = delete;
+
+  static frame_arena &instance();
+
+  // release all allocations, the blocks are kept for the next frame
+  void reset();
+
+  // bytes allocated since the last reset
+  std::size_t used() const;
+  std::size_t capacity() const;
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *ptr, std::size_t bytes,
+                     std::size_t alignment) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  struct block {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+  std::size_t block_size;
+  std::vector<block> blocks;
+  // block being filled and its first free byte
+  std::size_t current = 0, offset = 0;
+  std::size_t used_by_full_blocks = 0;
+};
+
+}; // namespace toolkit
@@ -0,0 +1,99 @@
+#include "toolkit/headless.hpp"
+#include "toolkit/binary_scene.hpp"
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+headless_app::headless_app() {
+  transform_sys = add_sys<transform_system>();
+  script_sys = add_sys<script_system>();
+}
+
+bool headless_app::load(const std::string &filepath) {
+  bool loaded = is_binary_scene_file(filepath)
+                    ? deserialize_binary(filepath)
+                    : deserialize_json_file(filepath);
+  if (!loaded) {
+    spdlog::error("Failed to load scene {0}", filepath);
+    return false;
+  }
+  frame = 0;
+  time = 0.0f;
+  return true;
+}
+
+bool headless_app::save(const std::string &filepath) {
+  if (!endswith(lower_case(filepath), ".json"))
+    return serialize_binary(filepath);
+  std::ofstream output(filepath);
+  if (!output.is_open()) {
+    spdlog::error("Failed to save scene to {0}", filepath);
+    return false;
+  }
+  output << serialize().dump(2) << std::endl;
+  return true;
+}
+
+bool headless_app::accept_system(const std::string &name,
+                                 bool requires_context) {
+  return !requires_context && excluded_systems.count(name) == 0;
+}
+
+void headless_app::late_serialize(nlohmann::json &j) {
+  for (auto &[key, value] : scene_meta.items()) {
+    if (key == "systems") {
+      // write back the settings of the systems skipped when loading
+      for (auto &[name, sys] : value.items())
+        if (!j["systems"].contains(name))
+          j["systems"][name] = sys;
+    } else if (!j.contains(key)) {
+      j[key] = value;
+    }
+  }
+}
+
+void headless_app::late_deserialize(nlohmann::json &j) {
+  scene_meta = j;
+  // scenes saved by the editor always have these two systems
+  transform_sys = get_sys<transform_system>();
+  if (transform_sys == nullptr)
+    transform_sys = add_sys<transform_system>();
+  script_sys = get_sys<script_system>();
+  if (script_sys == nullptr)
+    script_sys = add_sys<script_system>();
+}
+
+void headless_app::step(float dt) {
+  PROFILE_SCOPE("headless_app::step");
+  job_system::instance().process_main_thread();
+  transform_sys->update_transform(registry);
+  update_phase(system_phase::preupdate, dt);
+  if (script_sys->active)
+    script_sys->preupdate(this, dt);
+  update_phase(system_phase::update, dt);
+  if (script_sys->active)
+    script_sys->update(this, dt);
+  update_phase(system_phase::lateupdate, dt);
+  if (script_sys->active)
+    script_sys->lateupdate(this, dt);
+  frame_arena::instance().reset();
+  memory_tracker::check_budgets();
+  frame++;
+  time += dt;
+}
+
+int headless_app::run(float dt, int num_frames) {
+  profiler::set_thread_name("main");
+  running = true;
+  int count = 0;
+  while (running && (num_frames < 0 || count < num_frames)) {
+    profiler::new_frame();
+    step(dt);
+    count++;
+  }
+  running = false;
+  return count;
+}
+
+}; // namespace toolkit
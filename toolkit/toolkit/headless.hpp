@@ -0,0 +1,59 @@
+#pragma once
+
+#include "toolkit/scriptable.hpp"
+#include "toolkit/system.hpp"
+#include "toolkit/transform.hpp"
+
+namespace toolkit {
+
+/**
+ * Application without window, imgui or opengl context. It loads a scene and
+ * steps the transform hierarchy, the update phases of all systems and the
+ * scripts at a fixed time step as fast as possible, nothing gets rendered.
+ *
+ * Systems requiring an opengl context and the systems listed in
+ * `excluded_systems` are not created when loading a scene, their settings are
+ * kept and written back by `save` so the scene still opens in the editor.
+ * Scripts can end `run` early with
+ * `app->view_as<headless_app>([](headless_app *h) { h->stop(); })`.
+ */
+class headless_app : public iapp {
+public:
+  headless_app();
+
+  /**
+   * Replace the current scene with a binary or json scene file.
+   */
+  bool load(const std::string &filepath);
+  /**
+   * Save the current scene, files ending with `.json` are written as json
+   * scenes, everything else uses the binary format.
+   */
+  bool save(const std::string &filepath);
+
+  void step(float dt);
+  /**
+   * Step with a fixed `dt` for `num_frames` frames, or until `stop` gets
+   * called if `num_frames` is negative. Returns the number of frames stepped.
+   */
+  int run(float dt, int num_frames = -1);
+  void stop() { running = false; }
+
+  bool accept_system(const std::string &name, bool requires_context) override;
+  void late_serialize(nlohmann::json &j) override;
+  void late_deserialize(nlohmann::json &j) override;
+
+  std::set<std::string> excluded_systems{"autosave_system"};
+
+  int frame = 0;
+  float time = 0.0f;
+
+private:
+  transform_system *transform_sys = nullptr;
+  script_system *script_sys = nullptr;
+  bool running = false;
+  // systems and application data of the loaded scene
+  nlohmann::json scene_meta;
+};
+
+}; // namespace toolkit
@@ -0,0 +1,294 @@
+#include "toolkit/history.hpp"
+#include "toolkit/transform.hpp"
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+static void capture_components(entt::registry &registry, entt::entity entity,
+                               const std::vector<std::string> &types,
+                               nlohmann::json &components) {
+  for (auto &[name, ops] : iapp::__comp_serializer_callbacks__) {
+    if (!types.empty() &&
+        std::find(types.begin(), types.end(), name) == types.end())
+      continue;
+    ops.first(registry, entity, components);
+  }
+}
+
+static std::vector<std::uint8_t> encode(const nlohmann::json &j) {
+  return j.is_null() ? std::vector<std::uint8_t>() : nlohmann::json::to_cbor(j);
+}
+static nlohmann::json decode(const std::vector<std::uint8_t> &bytes) {
+  return bytes.empty() ? nlohmann::json() : nlohmann::json::from_cbor(bytes);
+}
+
+// keep the fields that differ if the component exists on both sides
+static void drop_equal_fields(nlohmann::json &before, nlohmann::json &after) {
+  if (!before.is_object() || !after.is_object())
+    return;
+  std::vector<std::string> equal;
+  for (auto &[key, value] : before.items())
+    if (after.contains(key) && after[key] == value)
+      equal.push_back(key);
+  for (auto &key : equal) {
+    before.erase(key);
+    after.erase(key);
+  }
+}
+
+edit_snapshot
+edit_history::capture(entt::registry &registry,
+                      const std::vector<entt::entity> &entities,
+                      const std::vector<std::string> &types) const {
+  edit_snapshot snapshot;
+  snapshot.types = types;
+  for (auto entity : entities) {
+    if (entity == entt::null ||
+        std::any_of(snapshot.entities.begin(), snapshot.entities.end(),
+                    [&](auto &state) { return state.entity == entity; }))
+      continue;
+    auto &state = snapshot.entities.emplace_back(edit_snapshot::entity_state{
+        entity, registry.valid(entity), nlohmann::json::object()});
+    if (state.alive)
+      capture_components(registry, entity, types, state.components);
+  }
+  return snapshot;
+}
+
+bool edit_history::commit(entt::registry &registry, const std::string &label,
+                          edit_snapshot &&before, std::uint64_t merge_key) {
+  PROFILE_SCOPE("edit_history::commit");
+  entry e;
+  e.label = label;
+  e.merge_key = merge_key;
+  for (auto &state : before.entities) {
+    entity_diff diff{state.entity, state.alive, registry.valid(state.entity),
+                     {}};
+    nlohmann::json after = nlohmann::json::object();
+    if (diff.alive_after)
+      capture_components(registry, state.entity, before.types, after);
+    for (auto &[name, value] : state.components.items()) {
+      nlohmann::json b = value, a;
+      if (after.contains(name)) {
+        a = std::move(after[name]);
+        drop_equal_fields(b, a);
+        if (b == a)
+          continue;
+      }
+      diff.components.push_back({name, encode(b), encode(a)});
+    }
+    // components added by the edit
+    for (auto &[name, value] : after.items())
+      if (!value.is_null() && !state.components.contains(name))
+        diff.components.push_back({name, {}, encode(value)});
+    if (diff.alive_before != diff.alive_after || !diff.components.empty())
+      e.entities.push_back(std::move(diff));
+  }
+  if (e.entities.empty())
+    return false;
+
+  for (auto &u : undone)
+    total_bytes -= u.bytes;
+  undone.clear();
+  if (merge_key != 0 && !done.empty() && !done.back().sealed &&
+      done.back().merge_key == merge_key) {
+    auto &top = done.back();
+    total_bytes -= top.bytes;
+    merge(top, std::move(e));
+    if (top.entities.empty()) {
+      // the edits cancelled each other
+      done.pop_back();
+    } else {
+      top.bytes = count_bytes(top);
+      total_bytes += top.bytes;
+    }
+  } else {
+    e.bytes = count_bytes(e);
+    total_bytes += e.bytes;
+    done.push_back(std::move(e));
+  }
+  trim();
+  return true;
+}
+
+void edit_history::merge(entry &into, entry &&next) {
+  for (auto &n : next.entities) {
+    auto d = std::find_if(into.entities.begin(), into.entities.end(),
+                          [&](auto &d) { return d.entity == n.entity; });
+    if (d == into.entities.end()) {
+      into.entities.push_back(std::move(n));
+      continue;
+    }
+    d->alive_after = n.alive_after;
+    for (auto &c : n.components) {
+      auto dc = std::find_if(d->components.begin(), d->components.end(),
+                             [&](auto &dc) { return dc.type == c.type; });
+      if (dc == d->components.end()) {
+        d->components.push_back(std::move(c));
+        continue;
+      }
+      // the older before and the newer after win
+      nlohmann::json before, after;
+      if (!dc->before.empty()) {
+        before = c.before.empty() ? nlohmann::json::object() : decode(c.before);
+        before.update(decode(dc->before));
+      }
+      if (!c.after.empty()) {
+        after =
+            dc->after.empty() ? nlohmann::json::object() : decode(dc->after);
+        after.update(decode(c.after));
+      }
+      drop_equal_fields(before, after);
+      dc->before = encode(before);
+      dc->after = encode(after);
+    }
+    std::erase_if(d->components, [](const component_diff &c) {
+      return !c.before.empty() && c.before == c.after;
+    });
+  }
+  std::erase_if(into.entities, [](const entity_diff &d) {
+    return d.alive_before == d.alive_after && d.components.empty();
+  });
+}
+
+bool edit_history::apply(entt::registry &registry, const entry &e,
+                         bool forward) {
+  PROFILE_SCOPE("edit_history::apply");
+  // the stored entity references are the real ids, don't let the mapping of
+  // the last loaded prefab redirect them
+  entity_mapping_scope scope;
+
+  // recreate the destroyed entities with their old ids first, so nothing is
+  // touched if one of the ids is taken
+  std::vector<entt::entity> recreated;
+  for (auto &d : e.entities) {
+    bool alive = forward ? d.alive_after : d.alive_before;
+    if (!alive || registry.valid(d.entity))
+      continue;
+    auto entity = registry.create(d.entity);
+    recreated.push_back(entity);
+    if (entity != d.entity) {
+      spdlog::error("Can't restore entity {0} for \"{1}\", its id is in use",
+                    entt::to_integral(d.entity), e.label);
+      registry.destroy(recreated.begin(), recreated.end());
+      return false;
+    }
+  }
+
+  std::vector<std::pair<entt::entity, std::string>> added;
+  for (auto &d : e.entities) {
+    bool alive = forward ? d.alive_after : d.alive_before;
+    if (!alive || !registry.valid(d.entity))
+      continue;
+    for (auto &c : d.components) {
+      auto &name = c.type.str();
+      auto ops = iapp::__comp_history_callbacks__.find(name);
+      auto listen = iapp::__comp_listen_callbacks__.find(name);
+      if (ops == iapp::__comp_history_callbacks__.end() ||
+          listen == iapp::__comp_listen_callbacks__.end()) {
+        spdlog::error("Component {0} is not declared, skip it in \"{1}\"", name,
+                      e.label);
+        continue;
+      }
+      auto storage = registry.storage(listen->second.first);
+      bool present = storage != nullptr && storage->contains(d.entity);
+      auto &bytes = forward ? c.after : c.before;
+      if (bytes.empty()) {
+        if (present)
+          ops->second.second(registry, d.entity);
+      } else if (present) {
+        ops->second.first(registry, d.entity, decode(bytes));
+      } else {
+        nlohmann::json j;
+        j[name] = decode(bytes);
+        iapp::__comp_serializer_callbacks__[name].second(registry, d.entity, j);
+        added.emplace_back(d.entity, name);
+      }
+    }
+  }
+  // components are initialized once all of them are restored, like loading a
+  // prefab
+  for (auto &[entity, name] : added)
+    iapp::__comp_init1_funcs__[name](registry, entity);
+
+  // hierarchies are captured root first, destroy the children before their
+  // parents like `destroy_hierarchy`
+  for (auto d = e.entities.rbegin(); d != e.entities.rend(); d++) {
+    bool alive = forward ? d->alive_after : d->alive_before;
+    if (!alive && registry.valid(d->entity))
+      registry.destroy(d->entity);
+    else if (auto trans = registry.try_get<transform>(d->entity))
+      trans->dirty = true;
+  }
+  return true;
+}
+
+bool edit_history::undo(entt::registry &registry) {
+  if (done.empty())
+    return false;
+  auto e = std::move(done.back());
+  done.pop_back();
+  if (!apply(registry, e, false)) {
+    done.push_back(std::move(e));
+    return false;
+  }
+  spdlog::info("Undo {0}", e.label);
+  e.sealed = true;
+  undone.push_back(std::move(e));
+  return true;
+}
+
+bool edit_history::redo(entt::registry &registry) {
+  if (undone.empty())
+    return false;
+  auto e = std::move(undone.back());
+  undone.pop_back();
+  if (!apply(registry, e, true)) {
+    undone.push_back(std::move(e));
+    return false;
+  }
+  spdlog::info("Redo {0}", e.label);
+  done.push_back(std::move(e));
+  return true;
+}
+
+void edit_history::seal() {
+  if (!done.empty())
+    done.back().sealed = true;
+}
+
+const std::string &edit_history::undo_label() const {
+  static const std::string none;
+  return done.empty() ? none : done.back().label;
+}
+
+const std::string &edit_history::redo_label() const {
+  static const std::string none;
+  return undone.empty() ? none : undone.back().label;
+}
+
+void edit_history::clear() {
+  done.clear();
+  undone.clear();
+  total_bytes = 0;
+}
+
+std::size_t edit_history::count_bytes(const entry &e) {
+  std::size_t bytes = sizeof(entry) + e.label.size();
+  for (auto &d : e.entities) {
+    bytes += sizeof(entity_diff);
+    for (auto &c : d.components)
+      bytes += sizeof(component_diff) + c.before.size() + c.after.size();
+  }
+  return bytes;
+}
+
+void edit_history::trim() {
+  // the newest entry is kept even if it's over budget on its own
+  while (total_bytes > memory_budget && done.size() > 1) {
+    total_bytes -= done.front().bytes;
+    done.pop_front();
+  }
+}
+
+}; // namespace toolkit
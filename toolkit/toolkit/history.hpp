@@ -0,0 +1,122 @@
+#pragma once
+
+#include "toolkit/intern.hpp"
+#include "toolkit/system.hpp"
+#include <deque>
+
+namespace toolkit {
+
+/**
+ * Components of some entities captured by `edit_history::capture`, each
+ * component is stored as the json of its reflected fields.
+ */
+struct edit_snapshot {
+  struct entity_state {
+    entt::entity entity;
+    bool alive;
+    // component name -> reflected fields
+    nlohmann::json components;
+  };
+  std::vector<entity_state> entities;
+  // only these component types are captured if it's not empty
+  std::vector<std::string> types;
+};
+
+/**
+ * Undo and redo stack of editor operations. Instead of snapshotting the scene,
+ * every entry only keeps the reflected fields that changed between the
+ * captured state before an edit and the state after it, encoded with cbor.
+ * Added and removed components are stored as a whole, so are created and
+ * destroyed entities. Entries are dropped from the oldest once the history
+ * takes more than `memory_budget` bytes.
+ *
+ * Continuous edits (e.g. dragging a slider) commit with the same `merge_key`
+ * every frame, they are folded into the newest entry until `seal` gets called.
+ *
+ * Connect the history with `connect_component_listener` to have the entities
+ * created inside `record` added to the entry.
+ */
+class edit_history : public component_listener {
+public:
+  edit_snapshot capture(entt::registry &registry,
+                        const std::vector<entt::entity> &entities,
+                        const std::vector<std::string> &types = {}) const;
+  /**
+   * Diff the current state of the entities in `before` against it and push
+   * the changes as a new entry. Returns false if nothing changed.
+   */
+  bool commit(entt::registry &registry, const std::string &label,
+              edit_snapshot &&before, std::uint64_t merge_key = 0);
+  /**
+   * Capture `entities`, run `func` and commit the changes, the entities
+   * created by `func` are part of the entry. Destroyed entities must be
+   * listed in `entities` to be restored by undo.
+   */
+  template <typename Func>
+  bool record(entt::registry &registry, const std::string &label,
+              const std::vector<entt::entity> &entities, Func &&func) {
+    auto before = capture(registry, entities);
+    created.clear();
+    tracking = true;
+    func();
+    tracking = false;
+    for (auto entity : created)
+      before.entities.push_back({entity, false, nlohmann::json::object()});
+    created.clear();
+    return commit(registry, label, std::move(before));
+  }
+  // stop merging commits into the newest entry
+  void seal();
+
+  bool undo(entt::registry &registry);
+  bool redo(entt::registry &registry);
+  bool can_undo() const { return !done.empty(); }
+  bool can_redo() const { return !undone.empty(); }
+  const std::string &undo_label() const;
+  const std::string &redo_label() const;
+
+  void clear();
+  std::size_t memory_usage() const { return total_bytes; }
+  std::size_t size() const { return done.size() + undone.size(); }
+
+  void on_entity_created(entt::registry &registry,
+                         entt::entity entity) override {
+    if (tracking)
+      created.push_back(entity);
+  }
+
+  std::size_t memory_budget = 16ull << 20;
+
+private:
+  // an empty buffer means the component doesn't exist on that side
+  struct component_diff {
+    interned_string type;
+    std::vector<std::uint8_t> before, after;
+  };
+  struct entity_diff {
+    entt::entity entity;
+    bool alive_before, alive_after;
+    std::vector<component_diff> components;
+  };
+  struct entry {
+    std::string label;
+    std::uint64_t merge_key = 0;
+    bool sealed = false;
+    std::vector<entity_diff> entities;
+    std::size_t bytes = 0;
+  };
+
+  static std::size_t count_bytes(const entry &e);
+  static void merge(entry &into, entry &&next);
+  bool apply(entt::registry &registry, const entry &e, bool forward);
+  void trim();
+
+  std::deque<entry> done;
+  std::vector<entry> undone;
+  std::size_t total_bytes = 0;
+
+  bool tracking = false;
+  std::vector<entt::entity> created;
+};
+
+}; // namespace toolkit
@@ -0,0 +1,89 @@
+#include "toolkit/intern.hpp"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+
+namespace toolkit {
+
+namespace {
+
+// the strings are stored in fixed size chunks that never move, so lookups
+// only need the chunk pointer published by `intern`
+constexpr std::uint32_t chunk_bits = 12, chunk_size = 1u << chunk_bits;
+constexpr std::uint32_t max_chunks = 1u << 12;
+
+struct interner_table {
+  interner_table() {
+    chunks[0].store(new std::string[chunk_size], std::memory_order_release);
+    ids.emplace(std::string_view(chunks[0].load()[0]), 0);
+    count = 1;
+  }
+
+  std::shared_mutex mtx;
+  std::unordered_map<std::string_view, std::uint32_t> ids;
+  std::array<std::atomic<std::string *>, max_chunks> chunks{};
+  std::uint32_t count = 0;
+};
+
+interner_table &table() {
+  static interner_table instance;
+  return instance;
+}
+
+} // namespace
+
+std::uint32_t string_interner::intern(std::string_view str) {
+  if (str.empty())
+    return 0;
+  auto &t = table();
+  {
+    std::shared_lock<std::shared_mutex> lock(t.mtx);
+    auto it = t.ids.find(str);
+    if (it != t.ids.end())
+      return it->second;
+  }
+  std::unique_lock<std::shared_mutex> lock(t.mtx);
+  auto it = t.ids.find(str);
+  if (it != t.ids.end())
+    return it->second;
+  if (t.count == chunk_size * max_chunks) {
+    spdlog::error("String interner is full, {0} is interned as empty string",
+                  str);
+    return 0;
+  }
+  auto handle = t.count++;
+  auto chunk = t.chunks[handle >> chunk_bits].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    chunk = new std::string[chunk_size];
+    t.chunks[handle >> chunk_bits].store(chunk, std::memory_order_release);
+  }
+  auto &stored = chunk[handle & (chunk_size - 1)];
+  stored = str;
+  t.ids.emplace(std::string_view(stored), handle);
+  return handle;
+}
+
+std::uint32_t string_interner::find(std::string_view str) {
+  auto &t = table();
+  std::shared_lock<std::shared_mutex> lock(t.mtx);
+  auto it = t.ids.find(str);
+  return it == t.ids.end() ? 0 : it->second;
+}
+
+const std::string &string_interner::lookup(std::uint32_t handle) {
+  auto &t = table();
+  return t.chunks[handle >> chunk_bits].load(
+      std::memory_order_acquire)[handle & (chunk_size - 1)];
+}
+
+std::size_t string_interner::size() {
+  auto &t = table();
+  std::shared_lock<std::shared_mutex> lock(t.mtx);
+  return t.count;
+}
+
+}; // namespace toolkit
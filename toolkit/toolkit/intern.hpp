@@ -0,0 +1,99 @@
+#pragma once
+
+#include "toolkit/reflect.hpp"
+#include <cstdint>
+#include <functional>
+#include <json.hpp>
+#include <string>
+#include <string_view>
+
+namespace toolkit {
+
+/**
+ * Global table of unique strings, each string gets a 32-bit handle that stays
+ * valid until the program exits. Handle 0 is the empty string. Interning takes
+ * a lock, looking up the string of a handle doesn't.
+ */
+class string_interner {
+public:
+  static std::uint32_t intern(std::string_view str);
+  // returns 0 if `str` was never interned
+  static std::uint32_t find(std::string_view str);
+  static const std::string &lookup(std::uint32_t handle);
+  static std::size_t size();
+};
+
+/**
+ * Handle to an interned string, copying and comparing two handles costs as
+ * much as an integer. It converts from and to `std::string` implicitly, json
+ * and fmt write it as the plain string.
+ */
+class interned_string {
+public:
+  interned_string() {}
+  interned_string(std::string_view str)
+      : handle(string_interner::intern(str)) {}
+  interned_string(const std::string &str)
+      : handle(string_interner::intern(str)) {}
+  interned_string(const char *str) : handle(string_interner::intern(str)) {}
+
+  const std::string &str() const { return string_interner::lookup(handle); }
+  const char *c_str() const { return str().c_str(); }
+  std::size_t size() const { return str().size(); }
+  bool empty() const { return handle == 0; }
+  std::uint32_t id() const { return handle; }
+
+  operator const std::string &() const { return str(); }
+
+  friend bool operator==(interned_string a, interned_string b) {
+    return a.handle == b.handle;
+  }
+  friend bool operator==(interned_string a, const std::string &b) {
+    return a.str() == b;
+  }
+  friend bool operator==(interned_string a, const char *b) {
+    return a.str() == b;
+  }
+  // orders by handle, not alphabetically
+  friend bool operator<(interned_string a, interned_string b) {
+    return a.handle < b.handle;
+  }
+
+private:
+  std::uint32_t handle = 0;
+};
+
+inline void to_json(nlohmann::json &j, const interned_string &str) {
+  j = str.str();
+}
+inline void from_json(const nlohmann::json &j, interned_string &str) {
+  str = interned_string(j.get_ref<const std::string &>());
+}
+inline std::string_view format_as(const interned_string &str) {
+  return str.str();
+}
+// the handles are only valid in this process, store the strings
+template <> struct binary_serializer<interned_string> {
+  static constexpr bool bulk = false;
+  static void write(binary_writer &writer, const interned_string &str) {
+    writer.write(str.str());
+  }
+  static bool read(binary_reader &reader, interned_string &str) {
+    std::string value;
+    if (!reader.read(value))
+      return false;
+    str = interned_string(value);
+    return true;
+  }
+  static constexpr std::uint64_t schema() {
+    return binary_schema<std::string>();
+  }
+};
+
+}; // namespace toolkit
+
+template <> struct std::hash<toolkit::interned_string> {
+  std::size_t operator()(const toolkit::interned_string &str) const {
+    return std::hash<std::uint32_t>{}(str.id());
+  }
+};
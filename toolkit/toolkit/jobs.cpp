@@ -0,0 +1,216 @@
+#include "toolkit/jobs.hpp"
+#include "toolkit/profiler.hpp"
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+// the job system and worker index of the current thread
+static thread_local job_system *current_system = nullptr;
+static thread_local int current_worker = -1;
+
+job_system::job_system(unsigned int num_workers)
+    : main_thread(std::this_thread::get_id()) {
+  for (unsigned int i = 0; i < num_workers; i++)
+    workers.push_back(std::make_unique<worker>());
+  // start the threads once all deques exist, they steal from each other
+  for (unsigned int i = 0; i < num_workers; i++)
+    workers[i]->thread = std::thread([this, i]() { worker_loop(i); });
+}
+
+job_system::~job_system() {
+  {
+    std::unique_lock<std::mutex> lock(sleep_mtx);
+    stop = true;
+  }
+  sleep_cv.notify_all();
+  for (auto &w : workers)
+    w->thread.join();
+}
+
+job_system &job_system::instance() {
+  static job_system system([]() {
+    unsigned int hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+  }());
+  return system;
+}
+
+void job_system::run(std::function<void()> &&func, job_counter *counter) {
+  if (counter)
+    counter->pending++;
+  push(job{std::move(func), counter});
+}
+
+void job_system::run_after(job_counter &dependency,
+                           std::function<void()> &&func,
+                           job_counter *counter) {
+  if (counter)
+    counter->pending++;
+  {
+    std::unique_lock<std::mutex> lock(dependency.mtx);
+    // the counter only drops to zero under the lock, the job is either seen
+    // by `finish` or queued here
+    if (!dependency.done()) {
+      dependency.continuations.push_back(
+          [this, func = std::move(func), counter]() mutable {
+            push(job{std::move(func), counter});
+          });
+      return;
+    }
+  }
+  push(job{std::move(func), counter});
+}
+
+void job_system::run_on_main_thread(std::function<void()> &&func,
+                                    job_counter *counter) {
+  if (counter)
+    counter->pending++;
+  std::unique_lock<std::mutex> lock(main_mtx);
+  main_jobs.push_back(job{std::move(func), counter});
+}
+
+void job_system::process_main_thread() {
+  std::vector<job> jobs;
+  {
+    std::unique_lock<std::mutex> lock(main_mtx);
+    jobs.swap(main_jobs);
+  }
+  for (auto &j : jobs)
+    execute(j);
+}
+
+void job_system::wait(job_counter &counter) {
+  wait_until([&]() { return counter.done(); });
+  std::unique_lock<std::mutex> lock(counter.mtx);
+}
+
+void job_system::wait_until(const std::function<bool()> &done) {
+  int index = current_system == this ? current_worker : -1;
+  // the main thread jobs may touch the registry, they only run at the top of
+  // the frame and never while the caller waits in the middle of its work
+  while (!done()) {
+    job j;
+    if (try_pop(index, j))
+      execute(j);
+    else
+      std::this_thread::yield();
+  }
+}
+
+void job_system::parallel_for(
+    std::size_t begin, std::size_t end, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)> &body) {
+  if (begin >= end)
+    return;
+  std::size_t count = end - begin;
+  grain = std::max<std::size_t>(grain, 1);
+  // a few ranges per thread balance the load without much overhead
+  std::size_t num_ranges =
+      std::min<std::size_t>((count + grain - 1) / grain, (size() + 1) * 4);
+  if (num_ranges <= 1) {
+    body(begin, end);
+    return;
+  }
+  job_counter counter;
+  for (std::size_t r = 1; r < num_ranges; r++)
+    run(
+        [&body, begin, count, num_ranges, r]() {
+          body(begin + r * count / num_ranges,
+               begin + (r + 1) * count / num_ranges);
+        },
+        &counter);
+  body(begin, begin + count / num_ranges);
+  wait(counter);
+}
+
+void job_system::push(job &&j) {
+  if (workers.empty()) {
+    execute(j);
+    return;
+  }
+  // a worker keeps the jobs it queues, others are spread round robin
+  unsigned int index = current_system == this && current_worker >= 0
+                           ? current_worker
+                           : next_worker++ % workers.size();
+  {
+    std::unique_lock<std::mutex> lock(workers[index]->mtx);
+    workers[index]->jobs.push_back(std::move(j));
+  }
+  num_queued++;
+  {
+    // a worker checking `num_queued` holds the lock, it can't miss this
+    std::unique_lock<std::mutex> lock(sleep_mtx);
+  }
+  sleep_cv.notify_one();
+}
+
+bool job_system::try_pop(int index, job &result) {
+  if (workers.empty())
+    return false;
+  if (index >= 0) {
+    auto &own = *workers[index];
+    std::unique_lock<std::mutex> lock(own.mtx);
+    if (!own.jobs.empty()) {
+      result = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      num_queued--;
+      return true;
+    }
+  }
+  unsigned int start = index >= 0 ? index : next_worker.load();
+  for (unsigned int i = 1; i <= workers.size(); i++) {
+    auto &victim = *workers[(start + i) % workers.size()];
+    std::unique_lock<std::mutex> lock(victim.mtx);
+    if (!victim.jobs.empty()) {
+      result = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      num_queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void job_system::execute(job &j) {
+  try {
+    j.func();
+  } catch (std::exception &e) {
+    spdlog::error("Uncaught exception in job: {0}", e.what());
+  }
+  finish(j.counter);
+}
+
+void job_system::finish(job_counter *counter) {
+  if (counter == nullptr)
+    return;
+  std::vector<std::function<void()>> continuations;
+  {
+    // `wait` takes the lock before returning, the counter stays alive until
+    // it's released
+    std::unique_lock<std::mutex> lock(counter->mtx);
+    if (--counter->pending > 0)
+      return;
+    continuations.swap(counter->continuations);
+  }
+  for (auto &queue : continuations)
+    queue();
+}
+
+void job_system::worker_loop(int index) {
+  current_system = this;
+  current_worker = index;
+  profiler::set_thread_name("worker " + std::to_string(index));
+  while (true) {
+    job j;
+    if (try_pop(index, j)) {
+      execute(j);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mtx);
+    sleep_cv.wait(lock, [this]() { return stop || num_queued > 0; });
+    if (stop && num_queued == 0)
+      return;
+  }
+}
+
+}; // namespace toolkit
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace toolkit {
+
+/**
+ * Number of unfinished jobs referring to it. Jobs queued with `run_after`
+ * start once the counter drops to zero, `job_system::wait` helps running other
+ * jobs until it does. Wait on a counter before destroying it, `done` alone
+ * doesn't mean the last job let go of it.
+ */
+class job_counter {
+public:
+  job_counter() {}
+  job_counter(const job_counter &) = delete;
+
+  bool done() const { return pending == 0; }
+
+private:
+  friend class job_system;
+  std::atomic<int> pending{0};
+  std::mutex mtx;
+  std::vector<std::function<void()>> continuations;
+};
+
+/**
+ * Work stealing job system shared by the whole engine, get it with
+ * `job_system::instance()`. Each worker owns a deque of jobs, it pushes and
+ * pops its own jobs at the back and steals from the front of the others when
+ * it runs dry. Jobs queued from other threads are spread over the workers.
+ *
+ * The thread creating the job system is the main thread, jobs that must run
+ * there (opengl calls for example) are queued with `run_on_main_thread` and
+ * executed by `process_main_thread`, which the main loop calls every frame.
+ * Without workers, jobs run immediately on the calling thread.
+ */
+class job_system {
+public:
+  explicit job_system(unsigned int num_workers);
+  ~job_system();
+  job_system(const job_system &) = delete;
+
+  // one worker per hardware thread besides the main thread
+  static job_system &instance();
+
+  unsigned int size() const { return workers.size(); }
+  bool is_main_thread() const {
+    return std::this_thread::get_id() == main_thread;
+  }
+
+  void run(std::function<void()> &&job, job_counter *counter = nullptr);
+  // queue `job` once all jobs counted by `dependency` finished
+  void run_after(job_counter &dependency, std::function<void()> &&job,
+                 job_counter *counter = nullptr);
+  void run_on_main_thread(std::function<void()> &&job,
+                          job_counter *counter = nullptr);
+  // execute the jobs queued for the main thread so far
+  void process_main_thread();
+
+  /**
+   * Run queued jobs on the calling thread until `counter` reaches zero. Jobs
+   * queued with `run_on_main_thread` are left to `process_main_thread`.
+   */
+  void wait(job_counter &counter);
+  // run queued jobs like `wait` until `done` returns true
+  void wait_until(const std::function<bool()> &done);
+
+  template <typename Func> auto async(Func &&func) {
+    using result_type = std::invoke_result_t<std::decay_t<Func>>;
+    auto task = std::make_shared<std::packaged_task<result_type()>>(
+        std::forward<Func>(func));
+    auto future = task->get_future();
+    run([task]() { (*task)(); });
+    return future;
+  }
+
+  /**
+   * Split [begin, end) into ranges of at least `grain` indices and call
+   * `body(range_begin, range_end)` for each of them on the workers and the
+   * calling thread, returns once all ranges are done.
+   */
+  void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+                    const std::function<void(std::size_t, std::size_t)> &body);
+
+  /**
+   * Call `func(entity)` for every entity of an entt view in parallel. The
+   * entities are collected up front, `func` may modify the components of its
+   * own entity but must not add or remove components.
+   */
+  template <typename View, typename Func>
+  void parallel_for_each(const View &view, Func &&func,
+                         std::size_t grain = 64) {
+    std::vector<typename View::entity_type> entities(view.begin(), view.end());
+    parallel_for(0, entities.size(), grain,
+                 [&](std::size_t first, std::size_t last) {
+                   for (std::size_t i = first; i < last; i++)
+                     func(entities[i]);
+                 });
+  }
+
+private:
+  struct job {
+    std::function<void()> func;
+    job_counter *counter = nullptr;
+  };
+  struct worker {
+    std::deque<job> jobs;
+    std::mutex mtx;
+    std::thread thread;
+  };
+
+  void push(job &&j);
+  // pop a job of worker `index` or steal one, -1 steals from any worker
+  bool try_pop(int index, job &result);
+  void execute(job &j);
+  void finish(job_counter *counter);
+  void worker_loop(int index);
+
+  std::vector<std::unique_ptr<worker>> workers;
+  std::thread::id main_thread;
+  std::atomic<unsigned int> next_worker{0};
+  // queued jobs not taken by any thread yet, workers sleep while it's zero
+  std::atomic<int> num_queued{0};
+  std::mutex sleep_mtx;
+  std::condition_variable sleep_cv;
+  bool stop = false;
+
+  std::mutex main_mtx;
+  std::vector<job> main_jobs;
+};
+
+}; // namespace toolkit
@@ -0,0 +1,282 @@
+#include "toolkit/json_scene.hpp"
+#include "toolkit/binary_scene.hpp"
+#include "toolkit/jobs.hpp"
+#include "toolkit/memory.hpp"
+#include <charconv>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+// entity ids are the object keys of the legacy layout, returns false if `key`
+// is not a valid id
+static bool parse_entity_key(const std::string &key, entt::entity &entity) {
+  std::uint32_t id = 0;
+  auto end = key.data() + key.size();
+  auto [ptr, ec] = std::from_chars(key.data(), end, id);
+  if (ec != std::errc() || ptr != end)
+    return false;
+  entity = entt::entity{id};
+  return true;
+}
+
+/**
+ * Sax handler splitting a json scene into per-type columns, both the columnar
+ * layout `{"entities": [id], "components": {component: {"entities": [id],
+ * "data": [value]}}, ...}` and the legacy layout `{"registry": {id:
+ * {component: value}}, ...}` are accepted. Values and everything outside of
+ * the component data are built with the dom parser of nlohmann, one small
+ * value at a time.
+ */
+class json_scene_sax {
+public:
+  using json = nlohmann::json;
+  using dom_parser = nlohmann::detail::json_sax_dom_parser<json>;
+
+  json_scene_sax(json_scene_staging &staging) : staging(staging) {}
+
+  bool null() {
+    return scalar([](dom_parser &p) { return p.null(); });
+  }
+  bool boolean(bool val) {
+    return scalar([&](dom_parser &p) { return p.boolean(val); });
+  }
+  bool number_integer(json::number_integer_t val) {
+    return scalar([&](dom_parser &p) { return p.number_integer(val); });
+  }
+  bool number_unsigned(json::number_unsigned_t val) {
+    return scalar([&](dom_parser &p) { return p.number_unsigned(val); });
+  }
+  bool number_float(json::number_float_t val, const json::string_t &s) {
+    return scalar([&](dom_parser &p) { return p.number_float(val, s); });
+  }
+  bool string(json::string_t &val) {
+    return scalar([&](dom_parser &p) { return p.string(val); });
+  }
+  bool binary(json::binary_t &val) {
+    return scalar([&](dom_parser &p) { return p.binary(val); });
+  }
+
+  bool start_object(std::size_t elements) {
+    if (begin_capture())
+      return forward_open([&](dom_parser &p) { return p.start_object(elements); });
+    depth++;
+    return true;
+  }
+  bool end_object() {
+    if (dom)
+      return forward_close([](dom_parser &p) { return p.end_object(); });
+    depth--;
+    if (depth == 1)
+      section = section_type::none;
+    else if (depth == 2)
+      column = nullptr;
+    return true;
+  }
+  bool start_array(std::size_t elements) {
+    if (begin_capture())
+      return forward_open([&](dom_parser &p) { return p.start_array(elements); });
+    // arrays are not expected at the structural levels, skip them entirely
+    pending = &scratch;
+    begin_capture();
+    return forward_open([&](dom_parser &p) { return p.start_array(elements); });
+  }
+  bool end_array() {
+    if (dom)
+      return forward_close([](dom_parser &p) { return p.end_array(); });
+    return false;
+  }
+
+  bool key(json::string_t &val) {
+    if (dom)
+      return dom->key(val);
+    if (depth == 1) {
+      if (val == "registry")
+        section = section_type::registry;
+      else if (val == "components")
+        section = section_type::components;
+      else if (val == "entities")
+        pending = &entity_table;
+      else
+        pending = &staging.meta[val];
+    } else if (section == section_type::components) {
+      if (depth == 2) {
+        if (iapp::__comp_column_callbacks__.count(val) == 0) {
+          pending = &scratch;
+        } else {
+          column = &staging.columns[val];
+          column_entities.emplace_back(column, nullptr);
+        }
+      } else if (depth == 3 && column != nullptr) {
+        if (val == "entities")
+          pending = &column_entities.back().second;
+        else if (val == "data")
+          pending = &column->data;
+        else
+          pending = &scratch;
+      }
+    } else if (depth == 2 && section == section_type::registry) {
+      entt::entity entity;
+      if (!parse_entity_key(val, entity)) {
+        spdlog::error("Invalid entity id \"{0}\" in json scene", val);
+        return false;
+      }
+      staging.entities.push_back(entity);
+    } else if (depth == 3 && section == section_type::registry) {
+      if (iapp::__comp_column_callbacks__.count(val) == 0) {
+        pending = &scratch;
+      } else {
+        auto &column = staging.columns[val];
+        column.entities.push_back(staging.entities.back());
+        column.data.push_back(nullptr);
+        pending = &column.data.back();
+      }
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t position, const std::string &last_token,
+                   const nlohmann::detail::exception &ex) {
+    spdlog::error("Failed to parse json scene at {0} near \"{1}\": {2}",
+                  position, last_token, ex.what());
+    return false;
+  }
+
+  /**
+   * Move the entity lists of the columnar layout into the staging area, call
+   * this after the parse finished.
+   */
+  void finish() {
+    if (entity_table.is_array())
+      staging.entities = entity_table.get<std::vector<entt::entity>>();
+    for (auto &[col, ids] : column_entities)
+      if (ids.is_array())
+        col->entities = ids.get<std::vector<entt::entity>>();
+  }
+
+private:
+  enum class section_type { none, registry, components };
+
+  bool begin_capture() {
+    if (dom)
+      return true;
+    if (pending == nullptr)
+      return false;
+    *pending = nullptr;
+    dom = std::make_unique<dom_parser>(*pending, false);
+    pending = nullptr;
+    capture_depth = 0;
+    return true;
+  }
+  template <typename F> bool scalar(F &&f) {
+    if (!begin_capture())
+      return true;
+    bool ok = f(*dom);
+    if (capture_depth == 0)
+      end_capture();
+    return ok;
+  }
+  template <typename F> bool forward_open(F &&f) {
+    capture_depth++;
+    return f(*dom);
+  }
+  template <typename F> bool forward_close(F &&f) {
+    bool ok = f(*dom);
+    if (--capture_depth == 0)
+      end_capture();
+    return ok;
+  }
+  void end_capture() {
+    dom.reset();
+    scratch = nullptr;
+  }
+
+  json_scene_staging &staging;
+  int depth = 0, capture_depth = 0;
+  section_type section = section_type::none;
+  json *pending = nullptr;
+  json scratch, entity_table;
+  json_scene_column *column = nullptr;
+  std::vector<std::pair<json_scene_column *, json>> column_entities;
+  std::unique_ptr<dom_parser> dom;
+};
+
+bool parse_json_scene(const std::string &filepath,
+                      json_scene_staging &staging) {
+  memory_scope memory(memory_tag::scenes);
+  mapped_file file;
+  if (!file.open(filepath)) {
+    spdlog::error("Failed to open json scene {0}", filepath);
+    return false;
+  }
+  json_scene_sax sax(staging);
+  if (!nlohmann::json::sax_parse(file.data(), file.data() + file.size(), &sax))
+    return false;
+  sax.finish();
+  return true;
+}
+
+void stage_json_scene(nlohmann::json &j, json_scene_staging &staging,
+                      const std::string &legacy_key) {
+  if (j.contains("components")) {
+    if (j.contains("entities"))
+      staging.entities = j["entities"].get<std::vector<entt::entity>>();
+    for (auto &[name, section] : j["components"].items()) {
+      if (iapp::__comp_column_callbacks__.count(name) == 0)
+        continue;
+      auto &column = staging.columns[name];
+      column.entities = section["entities"].get<std::vector<entt::entity>>();
+      column.data = std::move(section["data"]);
+    }
+  } else if (j.contains(legacy_key)) {
+    bool has_entity_table = j.contains("entities");
+    if (has_entity_table)
+      staging.entities = j["entities"].get<std::vector<entt::entity>>();
+    for (auto &[key, comps] : j[legacy_key].items()) {
+      entt::entity entity;
+      if (!parse_entity_key(key, entity)) {
+        spdlog::error("Skip invalid entity id \"{0}\" in json scene", key);
+        continue;
+      }
+      if (!has_entity_table)
+        staging.entities.push_back(entity);
+      for (auto &[name, value] : comps.items()) {
+        if (iapp::__comp_column_callbacks__.count(name) == 0)
+          continue;
+        auto &column = staging.columns[name];
+        column.entities.push_back(entity);
+        column.data.push_back(std::move(value));
+      }
+    }
+  }
+  for (auto &[key, value] : j.items())
+    if (key != "entities" && key != "components" && key != legacy_key)
+      staging.meta[key] = std::move(value);
+}
+
+std::vector<std::function<void(entt::registry &)>>
+decode_json_scene_columns(json_scene_staging &staging) {
+  auto &jobs = job_system::instance();
+  job_counter counter;
+  std::vector<std::function<void(entt::registry &)>> commits(
+      staging.columns.size());
+  auto commit = commits.begin();
+  for (auto &[name, column] : staging.columns) {
+    auto &decode = iapp::__comp_column_callbacks__[name].second;
+    jobs.run(
+        [&decode, &column, &commit = *commit++]() {
+          try {
+            commit = decode(std::move(column.entities), column.data);
+          } catch (std::exception &e) {
+            spdlog::error("Failed to decode component column: {0}", e.what());
+          }
+          // release the staged json as soon as it's decoded
+          column.data = nlohmann::json::array();
+        },
+        &counter);
+  }
+  jobs.wait(counter);
+  std::erase_if(commits, [](auto &commit) { return !commit; });
+  return commits;
+}
+
+}; // namespace toolkit
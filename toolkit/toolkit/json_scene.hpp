@@ -0,0 +1,50 @@
+#pragma once
+
+#include "toolkit/system.hpp"
+
+namespace toolkit {
+
+/**
+ * Components of one type collected from a json scene, `data[i]` belongs to
+ * `entities[i]`.
+ */
+struct json_scene_column {
+  std::vector<entt::entity> entities;
+  nlohmann::json data = nlohmann::json::array();
+};
+
+/**
+ * A json scene split up by component type. `meta` holds everything besides
+ * the entities and components (systems and late_serialize data), components
+ * are grouped by their type so each type can be decoded on its own thread.
+ */
+struct json_scene_staging {
+  std::vector<entt::entity> entities;
+  std::map<std::string, json_scene_column> columns;
+  nlohmann::json meta = nlohmann::json::object();
+};
+
+/**
+ * Parse a scene written by `iapp::serialize` with nlohmann's sax interface,
+ * the whole document is never materialized as one json object. Components of
+ * types not registered with DECLARE_COMPONENT are skipped.
+ */
+bool parse_json_scene(const std::string &filepath, json_scene_staging &staging);
+
+/**
+ * Split an already parsed scene or prefab, the columnar layout and the legacy
+ * per-entity layout stored under `legacy_key` ("registry" for scenes, "data"
+ * for prefabs) are both accepted. Values are moved out of `j`.
+ */
+void stage_json_scene(nlohmann::json &j, json_scene_staging &staging,
+                      const std::string &legacy_key = "registry");
+
+/**
+ * Decode all staged columns in parallel, the returned functions add the
+ * components to the registry and must be executed on the thread owning the
+ * registry. The staged data is consumed.
+ */
+std::vector<std::function<void(entt::registry &)>>
+decode_json_scene_columns(json_scene_staging &staging);
+
+}; // namespace toolkit
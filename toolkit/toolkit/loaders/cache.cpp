@@ -0,0 +1,99 @@
+#include "toolkit/loaders/cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+namespace toolkit::assets {
+
+constexpr char cache_magic[4] = {'T', 'K', 'A', 'C'};
+
+// state of the source file an entry was decoded from
+struct cache_stamp {
+  std::uint64_t source_time, source_size;
+};
+
+// returns false if the source file can't be found
+static bool locate_entry(const std::string &source, const std::string &options,
+                         std::filesystem::path &entry, cache_stamp &stamp) {
+  std::error_code ec;
+  auto absolute = std::filesystem::absolute(source, ec);
+  if (ec)
+    return false;
+  auto time = std::filesystem::last_write_time(absolute, ec);
+  if (ec)
+    return false;
+  auto size = std::filesystem::file_size(absolute, ec);
+  if (ec)
+    return false;
+  stamp = {(std::uint64_t)time.time_since_epoch().count(), size};
+  auto key = absolute.string() + "|" + options;
+  std::uint64_t h = _Reflect_Imp::fnv_offset;
+  for (unsigned char c : key)
+    h = (h ^ c) * _Reflect_Imp::fnv_prime;
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)h);
+  entry = std::filesystem::path(asset_cache::directory) / name;
+  return true;
+}
+
+bool asset_cache::read(const std::string &source, const std::string &options,
+                       std::vector<std::uint8_t> &bytes) {
+  std::filesystem::path entry;
+  cache_stamp stamp;
+  if (directory.empty() || !locate_entry(source, options, entry, stamp))
+    return false;
+  std::ifstream file(entry, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+    return false;
+  std::size_t size = file.tellg();
+  char magic[4];
+  cache_stamp stored;
+  if (size < sizeof(magic) + sizeof(stored))
+    return false;
+  file.seekg(0);
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(&stored), sizeof(stored));
+  if (!file || std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+      stored.source_time != stamp.source_time ||
+      stored.source_size != stamp.source_size)
+    return false;
+  bytes.resize(size - sizeof(magic) - sizeof(stored));
+  file.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+  return (bool)file;
+}
+
+void asset_cache::write(const std::string &source, const std::string &options,
+                        const std::vector<std::uint8_t> &bytes) {
+  std::filesystem::path entry;
+  cache_stamp stamp;
+  if (directory.empty() || !locate_entry(source, options, entry, stamp))
+    return;
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  // loaders on other threads may write the same entry
+  auto tmp_path = entry;
+  tmp_path += ".tmp" + std::to_string(std::hash<std::thread::id>{}(
+                           std::this_thread::get_id()));
+  {
+    std::ofstream file(tmp_path, std::ios::binary);
+    file.write(cache_magic, sizeof(cache_magic));
+    file.write(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    if (!file) {
+      file.close();
+      std::filesystem::remove(tmp_path, ec);
+      spdlog::warn("Failed to cache {0} in {1}", source, directory);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_path, entry, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    spdlog::warn("Failed to cache {0} in {1}", source, directory);
+  }
+}
+
+}; // namespace toolkit::assets
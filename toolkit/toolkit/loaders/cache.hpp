@@ -0,0 +1,49 @@
+#pragma once
+
+#include "toolkit/reflect.hpp"
+#include <string>
+#include <vector>
+
+namespace toolkit::assets {
+
+/**
+ * On disk cache of decoded assets, stored with `to_binary` so a hit is read
+ * back at memory bandwidth instead of decoding the source again. An entry is
+ * keyed by the source file and the decoding options, it goes stale once the
+ * source file is modified or the binary schema of the cached type changes.
+ *
+ * Entries are written to a temporary file and renamed, loaders may use the
+ * cache from several threads. Set `directory` to an empty string to disable
+ * the cache.
+ */
+class asset_cache {
+public:
+  static inline std::string directory = "cache";
+
+  // returns false and leaves `asset` default constructed on a miss
+  template <typename T>
+  static bool load(const std::string &source, const std::string &options,
+                   T &asset) {
+    std::vector<std::uint8_t> bytes;
+    if (!read(source, options, bytes))
+      return false;
+    if (from_binary(bytes, asset))
+      return true;
+    asset = T();
+    return false;
+  }
+
+  template <typename T>
+  static void store(const std::string &source, const std::string &options,
+                    const T &asset) {
+    write(source, options, to_binary(asset));
+  }
+
+private:
+  static bool read(const std::string &source, const std::string &options,
+                   std::vector<std::uint8_t> &bytes);
+  static void write(const std::string &source, const std::string &options,
+                    const std::vector<std::uint8_t> &bytes);
+};
+
+}; // namespace toolkit::assets
@@ -1,5 +1,8 @@
 #include "toolkit/loaders/image.hpp"
+#include "toolkit/loaders/cache.hpp"
 #include "toolkit/loaders/imp.hpp"
+#include "toolkit/memory.hpp"
+#include "toolkit/profiler.hpp"
 
 namespace toolkit::assets {
 
@@ -44,6 +47,11 @@ void flip_image_vertically(unsigned char *image, int width, int height,
 }
 
 bool image::load(std::string path, bool flip) {
+  PROFILE_SCOPE("image::load");
+  memory_scope memory(memory_tag::images);
+  auto cache_options = flip ? "flipped" : "";
+  if (asset_cache::load(path, cache_options, *this))
+    return true;
   stbi_set_flip_vertically_on_load(flip);
   unsigned char *_data =
       stbi_load(path.c_str(), &width, &height, &nchannels, 0);
@@ -55,11 +63,13 @@ bool image::load(std::string path, bool flip) {
   std::memcpy(data.data(), _data, width * height * nchannels);
   filepath = path;
   stbi_image_free(_data);
+  asset_cache::store(path, cache_options, *this);
   return true;
 }
 
 bool image::try_load_gray_scale(std::string path, int step_x, int step_y,
                                 bool flipy) {
+  memory_scope memory(memory_tag::images);
   stbi_set_flip_vertically_on_load(flipy);
   unsigned char *_data =
       stbi_load(path.c_str(), &width, &height, &nchannels, 0);
@@ -1,4 +1,7 @@
 #include "toolkit/loaders/motion.hpp"
+#include "toolkit/loaders/cache.hpp"
+#include "toolkit/memory.hpp"
+#include "toolkit/profiler.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -76,6 +79,14 @@ quat QuatFromEulers(vector3 angles, int order) {
 }
 
 bool motion::load_from_bvh(string filename, float scale) {
+  PROFILE_SCOPE("motion::load_from_bvh");
+  memory_scope memory(memory_tag::motions);
+  auto cache_options = "bvh " + std::to_string(scale);
+  if (asset_cache::load(filename, cache_options, *this)) {
+    for (auto &p : poses)
+      p.skeleton = &skeleton;
+    return true;
+  }
   std::ifstream fileInput(filename);
   if (!fileInput.is_open()) {
     printf("failed to open file %s\n", filename.c_str());
@@ -148,8 +159,9 @@ bool motion::load_from_bvh(string filename, float scale) {
             parentJoint = s.top();
             skeleton.joint_parent.push_back(parentJoint);
             skeleton.joint_children[parentJoint].push_back(currentJoint);
-            skeleton.joint_names.push_back(skeleton.joint_names[parentJoint] +
-                                          "_End"); // the end effector's name
+            skeleton.joint_names.push_back(
+                skeleton.joint_names[parentJoint].str() +
+                "_End"); // the end effector's name
             getline(fileInput, line);              // {
             getline(fileInput, line);              // OFFSET
             lineSeg = SplitByWhiteSpace(line);
@@ -235,6 +247,7 @@ bool motion::load_from_bvh(string filename, float scale) {
           throw std::runtime_error(
               "pose data should start with a MOTION label");
         fileInput.close();
+        asset_cache::store(filename, cache_options, *this);
         return true;
       } else
         throw std::runtime_error("the label should be ROOT instead of " +
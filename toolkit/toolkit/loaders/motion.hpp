@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "toolkit/intern.hpp"
 #include "toolkit/math.hpp"
 #include "toolkit/reflect.hpp"
 #include "toolkit/utils.hpp"
@@ -30,7 +31,7 @@ struct motion;
 // The parent joint has a lower index than all its children
 struct skeleton {
   std::string name;
-  std::vector<std::string> joint_names;
+  std::vector<interned_string> joint_names;
   // local position to joints' parent
   std::vector<toolkit::math::vector3> joint_offset;
   // local rotation to joints' parent
@@ -137,5 +138,8 @@ struct motion {
   // frame or last frame respectively.
   pose at(float frame);
 };
+// the skeleton pointers of the poses aren't stored, reset them after reading
+REFLECT(pose, root_local_pos, joint_local_rot)
+REFLECT(motion, fps, skeleton, poses, path)
 
 }; // namespace toolkit::assets
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Eigen/Eigen"
 #include "Eigen/Geometry"
 
+#include "toolkit/reflect.hpp"
 #include <json.hpp>
 
 #ifdef _WIN32
@@ -147,4 +148,67 @@ template <typename Scalar> struct adl_serializer<Eigen::Quaternion<Scalar>> {
     q.normalize();
   }
 };
-} // namespace nlohmann
\ No newline at end of file
+} // namespace nlohmann
+
+namespace toolkit {
+// the coefficients are stored in the storage order of the matrix
+template <typename Scalar, int Rows, int Cols, int Options, int MaxRows,
+          int MaxCols>
+struct binary_serializer<
+    Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>> {
+  using matrix = Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>;
+  static constexpr bool dynamic =
+      Rows == Eigen::Dynamic || Cols == Eigen::Dynamic;
+  static constexpr bool bulk =
+      !dynamic && sizeof(matrix) == sizeof(Scalar) * Rows * Cols;
+
+  static void write(binary_writer &writer, const matrix &mat) {
+    if constexpr (dynamic) {
+      writer.write(static_cast<std::int64_t>(mat.rows()));
+      writer.write(static_cast<std::int64_t>(mat.cols()));
+    }
+    writer.write_bytes(mat.data(), mat.size() * sizeof(Scalar));
+  }
+  static bool read(binary_reader &reader, matrix &mat) {
+    if constexpr (dynamic) {
+      std::int64_t rows = 0, cols = 0;
+      reader.read(rows);
+      reader.read(cols);
+      if (!reader.ok() || rows < 0 || cols < 0 ||
+          (Rows != Eigen::Dynamic && rows != Rows) ||
+          (Cols != Eigen::Dynamic && cols != Cols) ||
+          (rows > 0 && cols > reader.remaining() / sizeof(Scalar) / rows)) {
+        reader.fail();
+        return false;
+      }
+      mat.resize(rows, cols);
+    }
+    return reader.read_bytes(mat.data(), mat.size() * sizeof(Scalar));
+  }
+  static constexpr std::uint64_t schema() {
+    using namespace _Reflect_Imp;
+    return hash_combine(
+        hash_combine(hash_combine(hash_combine(fnv_offset, "eigen"),
+                                  binary_schema<Scalar>()),
+                     hash_combine(static_cast<std::uint64_t>(Rows), Cols)),
+        Options & Eigen::RowMajor);
+  }
+};
+template <typename Scalar, int Options>
+struct binary_serializer<Eigen::Quaternion<Scalar, Options>> {
+  using quaternion = Eigen::Quaternion<Scalar, Options>;
+  static constexpr bool bulk = sizeof(quaternion) == sizeof(Scalar) * 4;
+
+  static void write(binary_writer &writer, const quaternion &q) {
+    writer.write_bytes(q.coeffs().data(), sizeof(Scalar) * 4);
+  }
+  static bool read(binary_reader &reader, quaternion &q) {
+    return reader.read_bytes(q.coeffs().data(), sizeof(Scalar) * 4);
+  }
+  static constexpr std::uint64_t schema() {
+    using namespace _Reflect_Imp;
+    return hash_combine(hash_combine(fnv_offset, "quaternion"),
+                        binary_schema<Scalar>());
+  }
+};
+}; // namespace toolkit
@@ -0,0 +1,320 @@
+#include "toolkit/memory.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+// `memory_tag::count` marks allocations which are accounted elsewhere
+static thread_local memory_tag current_memory_tag = memory_tag::untagged;
+
+// constant initialized, usable by allocations during static initialization
+memory_tracker::counters memory_tracker::tags[(int)memory_tag::count];
+
+const char *memory_tag_name(memory_tag tag) {
+  switch (tag) {
+  case memory_tag::untagged:
+    return "untagged";
+  case memory_tag::meshes:
+    return "meshes";
+  case memory_tag::images:
+    return "images";
+  case memory_tag::motions:
+    return "motions";
+  case memory_tag::scenes:
+    return "scenes";
+  case memory_tag::gui:
+    return "gui";
+  default:
+    return "unknown";
+  }
+}
+
+namespace {
+
+// the counters of one thread, a thread only writes its own shard so the
+// allocating threads never share a cache line. Memory allocated on one
+// thread and freed on another leaves one shard positive and the other
+// negative, only their sum is meaningful.
+struct alignas(64) counter_shard {
+  std::atomic<std::int64_t> current[(int)memory_tag::count]{};
+  std::atomic<std::int64_t> allocations[(int)memory_tag::count]{};
+  std::atomic<bool> in_use{false};
+  counter_shard *next = nullptr;
+};
+
+// counts the frees of threads whose shard was already released on exit
+constinit counter_shard exited_threads;
+// shards are never deallocated, a shard released by an exiting thread is
+// reused by the next thread
+constinit std::atomic<counter_shard *> shards{&exited_threads};
+
+counter_shard *acquire_shard() {
+  for (auto s = shards.load(std::memory_order_acquire); s != nullptr;
+       s = s->next) {
+    bool expected = false;
+    if (s != &exited_threads &&
+        s->in_use.compare_exchange_strong(expected, true,
+                                          std::memory_order_acquire))
+      return s;
+  }
+  // malloc, operator new would count this allocation into the shard
+  auto memory = std::aligned_alloc(alignof(counter_shard),
+                                   sizeof(counter_shard));
+  if (memory == nullptr)
+    return &exited_threads;
+  auto s = new (memory) counter_shard;
+  s->in_use.store(true, std::memory_order_relaxed);
+  s->next = shards.load(std::memory_order_relaxed);
+  while (!shards.compare_exchange_weak(s->next, s, std::memory_order_release,
+                                       std::memory_order_relaxed))
+    ;
+  return s;
+}
+
+thread_local counter_shard *thread_shard = nullptr;
+thread_local bool thread_exited = false;
+
+struct shard_owner {
+  ~shard_owner() {
+    thread_shard->in_use.store(false, std::memory_order_release);
+    thread_shard = nullptr;
+    thread_exited = true;
+  }
+};
+
+counter_shard &local_shard() {
+  if (thread_shard != nullptr)
+    return *thread_shard;
+  if (thread_exited)
+    return exited_threads;
+  thread_shard = acquire_shard();
+  // releases the shard when the thread exits
+  static thread_local shard_owner owner;
+  return *thread_shard;
+}
+
+void raise_to(std::atomic<std::int64_t> &peak, std::int64_t value) {
+  auto previous = peak.load(std::memory_order_relaxed);
+  while (previous < value &&
+         !peak.compare_exchange_weak(previous, value,
+                                     std::memory_order_relaxed))
+    ;
+}
+
+}; // namespace
+
+void memory_tracker::allocated(memory_tag tag, std::size_t bytes) {
+  if (tag >= memory_tag::count)
+    return;
+  auto &s = local_shard();
+  s.current[(int)tag].fetch_add(bytes, std::memory_order_relaxed);
+  s.allocations[(int)tag].fetch_add(1, std::memory_order_relaxed);
+}
+
+void memory_tracker::freed(memory_tag tag, std::size_t bytes) {
+  if (tag >= memory_tag::count)
+    return;
+  auto &s = local_shard();
+  s.current[(int)tag].fetch_sub(bytes, std::memory_order_relaxed);
+  s.allocations[(int)tag].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void memory_tracker::sum_counters(std::int64_t *current,
+                                  std::int64_t *allocations) {
+  std::fill_n(current, (int)memory_tag::count, 0);
+  std::fill_n(allocations, (int)memory_tag::count, 0);
+  for (auto s = shards.load(std::memory_order_acquire); s != nullptr;
+       s = s->next)
+    for (int i = 0; i < (int)memory_tag::count; i++) {
+      current[i] += s->current[i].load(std::memory_order_relaxed);
+      allocations[i] += s->allocations[i].load(std::memory_order_relaxed);
+    }
+  for (int i = 0; i < (int)memory_tag::count; i++)
+    raise_to(tags[i].peak, current[i]);
+}
+
+memory_stats memory_tracker::stats(memory_tag tag) {
+  return snapshot()[(int)tag];
+}
+
+std::vector<memory_stats> memory_tracker::snapshot() {
+  std::int64_t current[(int)memory_tag::count];
+  std::int64_t allocations[(int)memory_tag::count];
+  sum_counters(current, allocations);
+  std::vector<memory_stats> result;
+  for (int i = 0; i < (int)memory_tag::count; i++)
+    result.push_back(memory_stats{(memory_tag)i, current[i],
+                                  tags[i].peak.load(), allocations[i],
+                                  tags[i].budget.load()});
+  return result;
+}
+
+void memory_tracker::reset_peaks() {
+  std::int64_t current[(int)memory_tag::count];
+  std::int64_t allocations[(int)memory_tag::count];
+  sum_counters(current, allocations);
+  for (int i = 0; i < (int)memory_tag::count; i++)
+    tags[i].peak = current[i];
+}
+
+void memory_tracker::set_budget(memory_tag tag, std::int64_t bytes) {
+  tags[(int)tag].budget = bytes;
+}
+
+bool memory_tracker::check_budgets() {
+  std::int64_t current[(int)memory_tag::count];
+  std::int64_t allocations[(int)memory_tag::count];
+  sum_counters(current, allocations);
+  bool within_budgets = true;
+  for (int i = 0; i < (int)memory_tag::count; i++) {
+    auto &c = tags[i];
+    auto budget = c.budget.load();
+    bool over_budget = budget > 0 && current[i] > budget;
+    if (over_budget && !c.over_budget)
+      spdlog::warn("Memory of {0} exceeds its budget, {1:.2f} MB of {2:.2f} MB",
+                   memory_tag_name((memory_tag)i), current[i] / 1048576.0,
+                   budget / 1048576.0);
+    c.over_budget = over_budget;
+    within_budgets &= !over_budget;
+  }
+  return within_budgets;
+}
+
+memory_tag memory_tracker::current_tag() { return current_memory_tag; }
+
+memory_scope::memory_scope(memory_tag tag) : previous(current_memory_tag) {
+  current_memory_tag = tag;
+}
+
+memory_scope::~memory_scope() { current_memory_tag = previous; }
+
+void *tracking_resource::do_allocate(std::size_t bytes,
+                                     std::size_t alignment) {
+  void *ptr;
+  {
+    // the upstream may allocate with operator new, don't charge it twice
+    memory_scope untracked(memory_tag::count);
+    ptr = upstream->allocate(bytes, alignment);
+  }
+  memory_tracker::allocated(tag, bytes);
+  return ptr;
+}
+
+void tracking_resource::do_deallocate(void *ptr, std::size_t bytes,
+                                      std::size_t alignment) {
+  upstream->deallocate(ptr, bytes, alignment);
+  memory_tracker::freed(tag, bytes);
+}
+
+}; // namespace toolkit
+
+#ifndef TOOLKIT_DISABLE_MEMORY_TRACKING
+
+namespace {
+
+// stored right before each allocation of operator new
+struct allocation_header {
+  std::uint64_t size;
+  // distance from the start of the malloc'ed block
+  std::uint32_t offset;
+  toolkit::memory_tag tag;
+};
+constexpr std::size_t header_size = 16;
+static_assert(sizeof(allocation_header) <= header_size);
+
+void *tracked_allocate(std::size_t size, std::size_t alignment) noexcept {
+  alignment = std::max(alignment, header_size);
+  // malloc aligns to 16 bytes already, over aligned types need some slack
+  std::size_t slack = alignment > header_size ? alignment : 0;
+  auto raw = static_cast<char *>(std::malloc(size + header_size + slack));
+  if (raw == nullptr)
+    return nullptr;
+  auto address = reinterpret_cast<std::uintptr_t>(raw) + header_size;
+  address = (address + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+  auto ptr = reinterpret_cast<char *>(address);
+  auto header = reinterpret_cast<allocation_header *>(ptr - header_size);
+  header->size = size;
+  header->offset = ptr - raw;
+  header->tag = toolkit::current_memory_tag;
+  toolkit::memory_tracker::allocated(header->tag, size);
+  return ptr;
+}
+
+void tracked_free(void *ptr) noexcept {
+  if (ptr == nullptr)
+    return;
+  auto header = reinterpret_cast<allocation_header *>(static_cast<char *>(ptr) -
+                                                      header_size);
+  toolkit::memory_tracker::freed(header->tag, header->size);
+  std::free(static_cast<char *>(ptr) - header->offset);
+}
+
+void *tracked_allocate_or_throw(std::size_t size, std::size_t alignment) {
+  if (auto ptr = tracked_allocate(size, alignment))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+}; // namespace
+
+void *operator new(std::size_t size) {
+  return tracked_allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new[](std::size_t size) {
+  return tracked_allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return tracked_allocate_or_throw(size, (std::size_t)alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return tracked_allocate_or_throw(size, (std::size_t)alignment);
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return tracked_allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return tracked_allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return tracked_allocate(size, (std::size_t)alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return tracked_allocate(size, (std::size_t)alignment);
+}
+
+void operator delete(void *ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  tracked_free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  tracked_free(ptr);
+}
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  tracked_free(ptr);
+}
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+  tracked_free(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  tracked_free(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  tracked_free(ptr);
+}
+void operator delete(void *ptr, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  tracked_free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  tracked_free(ptr);
+}
+
+#endif
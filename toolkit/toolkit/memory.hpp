@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace toolkit {
+
+/**
+ * Subsystems the heap memory is accounted to. Allocations made by `operator
+ * new` are charged to the tag of the innermost `memory_scope` of the
+ * allocating thread and refunded to the same tag when freed, wherever that
+ * happens.
+ */
+enum class memory_tag : std::uint8_t {
+  untagged,
+  meshes,
+  images,
+  motions,
+  scenes,
+  gui,
+  count
+};
+const char *memory_tag_name(memory_tag tag);
+
+struct memory_stats {
+  memory_tag tag;
+  // bytes currently allocated and the most seen allocated at once
+  std::int64_t current, peak;
+  // number of live allocations
+  std::int64_t allocations;
+  // 0 for no budget
+  std::int64_t budget;
+};
+
+/**
+ * Heap usage per subsystem. The global `operator new` and `operator delete`
+ * are replaced to feed it, define `TOOLKIT_DISABLE_MEMORY_TRACKING` to keep
+ * the default ones, only `tracking_resource` is accounted then.
+ *
+ * Every thread counts its allocations on its own cache lines, the counters
+ * are summed when the stats are queried. The peaks are sampled then as well,
+ * spikes freed before the next query or `check_budgets` aren't seen.
+ */
+class memory_tracker {
+public:
+  static void allocated(memory_tag tag, std::size_t bytes);
+  static void freed(memory_tag tag, std::size_t bytes);
+
+  static memory_stats stats(memory_tag tag);
+  // the stats of all tags, indexed by tag
+  static std::vector<memory_stats> snapshot();
+  static void reset_peaks();
+
+  /**
+   * Log a warning when `tag` uses more than `bytes`, 0 removes the budget.
+   * The budgets are checked by `check_budgets`, the main loop calls it once
+   * per frame.
+   */
+  static void set_budget(memory_tag tag, std::int64_t bytes);
+  // returns false if any tag exceeded its budget since the last check
+  static bool check_budgets();
+
+  // tag charged by the allocations of the current thread
+  static memory_tag current_tag();
+
+private:
+  friend class memory_scope;
+  // summed over the threads, only touched off the allocation path
+  struct counters {
+    std::atomic<std::int64_t> peak{0}, budget{0};
+    bool over_budget = false;
+  };
+  static counters tags[(int)memory_tag::count];
+  static void sum_counters(std::int64_t *current, std::int64_t *allocations);
+};
+
+// charge the allocations of the current thread to `tag` while it's alive
+class memory_scope {
+public:
+  explicit memory_scope(memory_tag tag);
+  ~memory_scope();
+  memory_scope(const memory_scope &) = delete;
+  memory_scope &operator=(const memory_scope &) = delete;
+
+private:
+  memory_tag previous;
+};
+
+/**
+ * Memory resource charging the allocations of `std::pmr` containers to
+ * `tag`, the upstream resource defaults to the heap.
+ */
+class tracking_resource : public std::pmr::memory_resource {
+public:
+  explicit tracking_resource(
+      memory_tag tag,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : tag(tag), upstream(upstream) {}
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *ptr, std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  memory_tag tag;
+  std::pmr::memory_resource *upstream;
+};
+
+}; // namespace toolkit
@@ -43,7 +43,22 @@ void context::init(unsigned int width, unsigned int height, const char *title,
     printf("Failed to load glad\n");
     return;
   }
+  // let the driver pick the number of shader compiler threads
+  if (GLAD_GL_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    parallel_shader_compile = true;
+  } else if (GLAD_GL_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    parallel_shader_compile = true;
+  }
 
+  // charge the allocations of imgui and implot to the gui memory
+  ImGui::SetAllocatorFunctions(
+      [](size_t size, void *) {
+        memory_scope memory(memory_tag::gui);
+        return ::operator new(size);
+      },
+      [](void *ptr, void *) { ::operator delete(ptr); });
   ImGui::CreateContext();
   ImGui_ImplGlfw_InitForOpenGL(window, true);
   ImGui_ImplOpenGL3_Init();
@@ -62,16 +77,9 @@ void context::init(unsigned int width, unsigned int height, const char *title,
 
 void context::shutdown() {
   // free opengl handles
-  for (auto handle : buffer_handles)
-    glDeleteBuffers(1, &handle);
-  for (auto handle : vertex_array_handles)
-    glDeleteVertexArrays(1, &handle);
-  for (auto handle : texture_handles)
-    glDeleteTextures(1, &handle);
+  gpu_resources::instance().shutdown();
   for (auto handle : program_handles)
     glDeleteProgram(handle);
-  for (auto handle : framebuffer_handles)
-    glDeleteFramebuffers(1, &handle);
 
   window = nullptr;
   ImPlot::DestroyContext();
@@ -81,6 +89,30 @@ void context::shutdown() {
   glfwTerminate();
 }
 
+std::size_t texture::texel_size(GLint internal_format) {
+  switch (internal_format) {
+  case GL_R8:
+    return 1;
+  case GL_RG8:
+  case GL_R16F:
+    return 2;
+  case GL_RGB8:
+    return 3;
+  case GL_RGB16F:
+    return 6;
+  case GL_RG32F:
+  case GL_RGBA16F:
+    return 8;
+  case GL_RGB32F:
+    return 12;
+  case GL_RGBA32F:
+    return 16;
+  default:
+    // 8 bit rgba, 32 bit single channel and depth formats
+    return 4;
+  }
+}
+
 void context::run(std::function<void(void)> mainLoop) {
   while (!glfwWindowShouldClose(window)) {
     poll();
@@ -201,46 +233,47 @@ bool shader::compile_shader_from_path(std::string vsp, std::string fsp,
 // Load shader code directly, create and link program
 bool shader::compile_shader_from_source(std::string vss, std::string fss,
                                         std::string gss) {
-  unsigned int vertex, fragment;
-  // vertex shader
-  const char *vShaderCode = vss.c_str();
-  const char *fShaderCode = fss.c_str();
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
-  check_compile_errors(vertex, "VERTEX");
-  // fragment Shader
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  check_compile_errors(fragment, "FRAGMENT");
+  begin_compile(vss, fss, gss);
+  return end_compile();
+}
+
+void shader::begin_compile(const std::string &vss, const std::string &fss,
+                           const std::string &gss) {
+  auto compile_stage = [&](GLenum type, const std::string &source) {
+    const char *code = source.c_str();
+    GLuint stage = glCreateShader(type);
+    glShaderSource(stage, 1, &code, NULL);
+    glCompileShader(stage);
+    pending_stages.push_back(stage);
+  };
+  compile_stage(GL_VERTEX_SHADER, vss);
+  compile_stage(GL_FRAGMENT_SHADER, fss);
   // if geometry shader is given, compile geometry shader
-  unsigned int geometry;
-  if (gss != "none") {
-    const char *gShaderCode = gss.c_str();
-    geometry = glCreateShader(GL_GEOMETRY_SHADER);
-    glShaderSource(geometry, 1, &gShaderCode, NULL);
-    glCompileShader(geometry);
-    check_compile_errors(geometry, "GEOMETRY");
-  }
+  if (gss != "none")
+    compile_stage(GL_GEOMETRY_SHADER, gss);
   // shader Program
   gl_handle = glCreateProgram();
-  glAttachShader(gl_handle, vertex);
-  glAttachShader(gl_handle, fragment);
-  if (gss != "none")
-    glAttachShader(gl_handle, geometry);
+  for (auto stage : pending_stages)
+    glAttachShader(gl_handle, stage);
   // linking the shader is a time consuming process
   // this should be avoglHandle between frames in all cost
   glLinkProgram(gl_handle);
-  check_compile_errors(gl_handle, "PROGRAM");
+  context::program_handles.insert(gl_handle);
+}
+
+bool shader::end_compile() {
+  // the status queries wait for the driver
+  const char *stage_names[] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+  bool success = true;
+  for (std::size_t i = 0; i < pending_stages.size(); i++)
+    success &= check_compile_errors(pending_stages[i], stage_names[i]);
+  success &= check_compile_errors(gl_handle, "PROGRAM");
   // delete the shaders as they're linked into our program now and no longer
   // necessary
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
-  if (gss != "none")
-    glDeleteShader(geometry);
-  context::program_handles.insert(gl_handle);
-  return true;
+  for (auto stage : pending_stages)
+    glDeleteShader(stage);
+  pending_stages.clear();
+  return success;
 }
 
 bool shader::set_texture2d(std::string name, unsigned int texture, int slot) {
@@ -268,32 +301,35 @@ bool shader::set_cubemap(std::string name, unsigned int cubemapID, int slot) {
 }
 
 void compute_shader::create(const std::string computeCode) {
-  const char *cShaderCode = computeCode.c_str();
-  // Compile shaders
-  GLuint compute;
-  GLint success;
-  GLchar infoLog[1024];
+  begin_compile(computeCode);
+  end_compile();
+}
 
+void compute_shader::begin_compile(const std::string &code) {
+  const char *cShaderCode = code.c_str();
   // Compute Shader
-  compute = glCreateShader(GL_COMPUTE_SHADER);
-  glShaderSource(compute, 1, &cShaderCode, nullptr);
-  glCompileShader(compute);
-  check_compile_errors(compute, "COMPUTE");
+  pending_stage = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(pending_stage, 1, &cShaderCode, nullptr);
+  glCompileShader(pending_stage);
 
   // Shader Program
   gl_handle = glCreateProgram();
-  glAttachShader(gl_handle, compute);
+  glAttachShader(gl_handle, pending_stage);
   glLinkProgram(gl_handle);
-  check_compile_errors(gl_handle, "PROGRAM");
+  context::program_handles.insert(gl_handle);
+}
 
+bool compute_shader::end_compile() {
+  bool success = check_compile_errors(pending_stage, "COMPUTE");
+  success &= check_compile_errors(gl_handle, "PROGRAM");
   // del the shader as it's linked into our program now and no longer
   // necessary
-  glDeleteShader(compute);
-
-  context::program_handles.insert(gl_handle);
+  glDeleteShader(pending_stage);
+  pending_stage = 0;
+  return success;
 }
 
-void check_compile_errors(GLuint shader, std::string type) {
+bool check_compile_errors(GLuint shader, std::string type) {
   GLint success;
   GLchar infoLog[1024];
   if (type != "PROGRAM") {
@@ -310,6 +346,7 @@ void check_compile_errors(GLuint shader, std::string type) {
       printf("PROGRAM_LINKING_ERROR of type: %s\n %s", type.c_str(), infoLog);
     }
   }
+  return success;
 }
 
 }; // namespace toolkit::opengl
\ No newline at end of file
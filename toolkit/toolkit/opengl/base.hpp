@@ -2,6 +2,7 @@
 
 #include "toolkit/assets/icons_lucide.h"
 #include "toolkit/opengl/imp.hpp"
+#include "toolkit/opengl/resources.hpp"
 #include "toolkit/system.hpp"
 
 namespace toolkit::opengl {
@@ -121,6 +122,9 @@ public:
   math::vector2 get_window_size() const { return {wnd_width, wnd_height}; }
   math::vector2 get_scene_size() const { return {scene_width, scene_height}; }
 
+  // Whether `init` created a window and opengl context
+  bool has_context() const { return window != nullptr; }
+
   GLFWwindow *window = nullptr;
   uint32_t wnd_width = 0, wnd_height = 0, scene_width = 0, scene_height = 0,
            scene_pos_x = 0, scene_pos_y = 0;
@@ -129,8 +133,11 @@ public:
 
   entt::entity active_camera = entt::null;
 
-  static inline std::set<unsigned int> buffer_handles, vertex_array_handles,
-      texture_handles, program_handles, framebuffer_handles;
+  // buffers, vertex arrays, textures and framebuffers are owned by
+  // `gpu_resources`
+  static inline std::set<unsigned int> program_handles;
+  // the driver compiles shaders on its own threads, see `shader::begin_compile`
+  static inline bool parallel_shader_compile = false;
 
 private:
   // Private constructor to prevent direct instantiation
@@ -149,24 +156,28 @@ private:
 
 static context &g_instance = context::get_instance();
 
-// opengl buffer object
+/**
+ * Opengl buffer object, copies share the buffer and the last one alive
+ * releases it. `del` only drops the reference of this copy.
+ */
 class buffer {
 public:
   buffer() {}
   ~buffer() {}
 
   void create() {
-    glGenBuffers(1, &gl_handle);
-    context::buffer_handles.insert(gl_handle);
+    handle = gpu_resources::instance().create(gpu_resource_type::buffer);
+    gl_handle = handle.id();
   }
   void del() {
-    if (glIsBuffer(gl_handle))
-      glDeleteBuffers(1, &gl_handle);
+    handle.reset();
+    gl_handle = 0;
   }
 
   // Bind the buffer to target, setup the filled data in it.
-  template <typename T>
-  void set_data_as(GLenum TARGET_BUFFER_NAME, const std::vector<T> &data,
+  template <typename T, typename Alloc>
+  void set_data_as(GLenum TARGET_BUFFER_NAME,
+                   const std::vector<T, Alloc> &data,
                    GLenum usage = GL_STATIC_DRAW) {
     glBindBuffer(TARGET_BUFFER_NAME, gl_handle);
     // setting a buffer of size 0 is a invalid operation
@@ -176,9 +187,10 @@ public:
     else
       glBufferData(TARGET_BUFFER_NAME, data.size() * sizeof(T),
                    (void *)data.data(), usage);
+    handle.set_size(std::max<std::size_t>(data.size() * sizeof(T), 1));
   }
-  template <typename T>
-  void set_data_ssbo(const std::vector<T> &data,
+  template <typename T, typename Alloc>
+  void set_data_ssbo(const std::vector<T, Alloc> &data,
                      GLenum usage = GL_DYNAMIC_DRAW) {
     set_data_as(GL_SHADER_STORAGE_BUFFER, data, usage);
   }
@@ -188,12 +200,13 @@ public:
       glBufferData(GL_SHADER_STORAGE_BUFFER, 1, nullptr, usage);
     else
       glBufferData(GL_SHADER_STORAGE_BUFFER, byteSize, nullptr, usage);
+    handle.set_size(std::max(byteSize, 1u));
   }
   // update the data in this buffer as described in offset. Make sure the buffer
   // has enough space for update.
-  template <typename T>
-  void update_data_as(GLenum TARGET_BUFFER_NAME, const std::vector<T> &data,
-                      size_t offset) {
+  template <typename T, typename Alloc>
+  void update_data_as(GLenum TARGET_BUFFER_NAME,
+                      const std::vector<T, Alloc> &data, size_t offset) {
     glBindBuffer(TARGET_BUFFER_NAME, gl_handle);
     if (data.size() == 0)
       glBufferSubData(TARGET_BUFFER_NAME, offset, 1, nullptr);
@@ -262,22 +275,24 @@ public:
   GLuint get_handle() const { return gl_handle; }
 
 private:
-  GLuint gl_handle;
+  gpu_handle handle;
+  // cached id of `handle`
+  GLuint gl_handle = 0;
 };
 
-// opengl vertex array object
+// opengl vertex array object, shared by its copies like `buffer`
 class vao {
 public:
   vao() {}
   ~vao() {}
 
   void create() {
-    glGenVertexArrays(1, &gl_handle);
-    context::vertex_array_handles.insert(gl_handle);
+    handle = gpu_resources::instance().create(gpu_resource_type::vertex_array);
+    gl_handle = handle.id();
   }
   void del() {
-    if (glIsVertexArray(gl_handle))
-      glDeleteVertexArrays(1, &gl_handle);
+    handle.reset();
+    gl_handle = 0;
   }
 
   void bind() const { glBindVertexArray(gl_handle); }
@@ -293,9 +308,11 @@ public:
   GLuint get_handle() const { return gl_handle; }
 
 private:
-  GLuint gl_handle;
+  gpu_handle handle;
+  GLuint gl_handle = 0;
 };
 
+// opengl texture object, shared by its copies like `buffer`
 class texture {
 public:
   texture() {}
@@ -303,10 +320,9 @@ public:
 
   // Constructor: Initializes the texture object
   void create(GLenum target = GL_TEXTURE_2D) {
-    gl_handle = 0;
     gl_target = target;
-    glGenTextures(1, &gl_handle);
-    context::texture_handles.insert(gl_handle);
+    handle = gpu_resources::instance().create(gpu_resource_type::texture);
+    gl_handle = handle.id();
   }
 
   void set_data_from_image(assets::image &img) {
@@ -358,8 +374,8 @@ public:
   }
 
   void del() {
-    if (glIsTexture(gl_handle))
-      glDeleteTextures(1, &gl_handle);
+    handle.reset();
+    gl_handle = 0;
   }
 
   // Binds the texture to a specific texture unit (default: 0)
@@ -383,6 +399,8 @@ public:
     glTexImage2D(gl_target, 0, internalFormat, width, height, 0, format, type,
                  data);
     unbind();
+    handle.set_size((std::size_t)width * height *
+                    texel_size(internalFormat));
   }
 
   void clear_data() {
@@ -395,6 +413,7 @@ public:
     glTexImage2D(gl_target, 0, m_internal_format, m_width, m_height, 0,
                  m_format, GL_UNSIGNED_BYTE, whitePixel);
     unbind();
+    handle.set_size(4);
   }
 
   // Configures texture parameters
@@ -417,9 +436,13 @@ public:
   GLsizei get_width() const { return m_width; }
   GLsizei get_height() const { return m_height; }
 
+  // bytes per texel of an internal format, used for the video memory stats
+  static std::size_t texel_size(GLint internal_format);
+
 private:
-  GLuint gl_handle; // texture object ID
-  GLenum gl_target; // texture target (e.g., GL_TEXTURE_2D)
+  gpu_handle handle;
+  GLuint gl_handle = 0; // texture object ID
+  GLenum gl_target;     // texture target (e.g., GL_TEXTURE_2D)
 
   GLsizei m_width;         // texture width
   GLsizei m_height;        // texture height
@@ -427,18 +450,19 @@ private:
   GLint m_internal_format; // GL_RGBA8
 };
 
+// opengl framebuffer object, shared by its copies like `buffer`
 class framebuffer {
 public:
   framebuffer() {}
   ~framebuffer() {}
 
   void create() {
-    glGenFramebuffers(1, &m_fbo);
-    context::framebuffer_handles.insert(m_fbo);
+    handle = gpu_resources::instance().create(gpu_resource_type::framebuffer);
+    m_fbo = handle.id();
   }
   void del() {
-    if (glIsFramebuffer(m_fbo))
-      glDeleteFramebuffers(1, &m_fbo);
+    handle.reset();
+    m_fbo = 0;
   }
 
   // record previous framebuffer, setup new framebuffer (you need to manually
@@ -487,6 +511,7 @@ public:
   unsigned int get_handle() { return m_fbo; }
 
 private:
+  gpu_handle handle;
   GLuint m_fbo = 0;
   GLenum m_bound_target = GL_FRAMEBUFFER;
   unsigned int attachment_counter = 0;
@@ -495,7 +520,8 @@ private:
   int prev_fbo, prev_viewport[4];
 };
 
-void check_compile_errors(GLuint shader, std::string type);
+// print the errors of a shader or program, returns false if it has any
+bool check_compile_errors(GLuint shader, std::string type);
 
 class shader {
 public:
@@ -514,6 +540,15 @@ public:
   bool compile_shader_from_source(std::string vss, std::string fss,
                                   std::string gss = "none");
 
+  /**
+   * Start compiling and linking the program without waiting for the result.
+   * With `context::parallel_shader_compile` the driver does the work on its
+   * own threads until `end_compile` waits for it and reports the errors.
+   */
+  void begin_compile(const std::string &vss, const std::string &fss,
+                     const std::string &gss = "none");
+  bool end_compile();
+
   // Load shader from path, compile and link them into a program
   bool compile_shader_from_path(std::string vsp, std::string fsp,
                                 std::string gsp = "none");
@@ -591,18 +626,25 @@ public:
   }
 
   bool set_cubemap(std::string name, unsigned int cubemapID, int slot);
+
+private:
+  // shader objects attached to the program until `end_compile`
+  std::vector<GLuint> pending_stages;
 };
 
 class compute_shader {
 public:
   std::string identifier;
-  GLuint gl_handle;
+  GLuint gl_handle = 0;
 
   compute_shader() {}
   ~compute_shader() {}
 
   // Constructor reads and builds the compute shader
   void create(const std::string computeCode);
+  // same as `shader::begin_compile` and `shader::end_compile`
+  void begin_compile(const std::string &code);
+  bool end_compile();
   void del() {
     if (glIsProgram(gl_handle))
       glDeleteProgram(gl_handle);
@@ -692,6 +734,9 @@ public:
   void barrier(GLuint barrierBit = GL_SHADER_STORAGE_BARRIER_BIT) {
     glMemoryBarrier(barrierBit);
   }
+
+private:
+  GLuint pending_stage = 0;
 };
 
 }; // namespace toolkit::opengl
\ No newline at end of file
@@ -48,7 +48,12 @@ void material::draw_gui(iapp *app) {
   }
 }
 void material::bind_uniforms(shader &mat_shader) {
-  for (auto &field : material_fields) {
+  bind_material_fields(mat_shader, material_fields);
+}
+
+void bind_material_fields(shader &mat_shader,
+                          const std::vector<material_field> &fields) {
+  for (auto &field : fields) {
     if (field.type == "float") {
       mat_shader.set_float(field.name, field.value.get<float>());
     } else if (field.type == "int") {
@@ -12,6 +12,10 @@ struct material_field {
 };
 REFLECT(material_field, name, type, value)
 
+// set the uniform of each field in `mat_shader`
+void bind_material_fields(shader &mat_shader,
+                          const std::vector<material_field> &fields);
+
 std::vector<material_field>
 parse_glsl_uniforms(std::vector<std::string> sources);
 
@@ -72,10 +76,13 @@ bool has_any_materials(entt::registry &registry, entt::entity entity);
           material_shader;                                                     \
       toolkit::opengl::material::__shader_initialized__[#class_name] = true;   \
     }                                                                          \
-    mat_instance.material_fields =                                             \
-        parse_glsl_uniforms({mat_instance.vertex_shader_source,                \
-                             mat_instance.fragment_shader_source,              \
-                             mat_instance.geometry_shader_source});            \
+    /* materials inserted by the column decoder or by clone_hierarchy       \
+       already carry their field values */                                     \
+    if (mat_instance.material_fields.empty())                                  \
+      mat_instance.material_fields =                                           \
+          parse_glsl_uniforms({mat_instance.vertex_shader_source,              \
+                               mat_instance.fragment_shader_source,            \
+                               mat_instance.geometry_shader_source});          \
   }                                                                            \
   inline void __material_view_for_each_##class_name(                           \
       entt::registry &registry,                                                \
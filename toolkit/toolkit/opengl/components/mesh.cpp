@@ -156,6 +156,9 @@ void mesh_data::draw_gui(iapp *app) {
   }
 }
 
+// stays on the main thread, scenes are loaded synchronously and init1 has to
+// leave a drawable mesh behind, the buffers can only be created on the thread
+// owning the opengl context
 void mesh_data::init1() {
   std::string base_path = join_path(
       ".", "assets", "meshes", replace(replace(model_name, " ", ""), ":", ""));
@@ -228,16 +231,9 @@ void mesh_data::update_buffers(bool save_assets) {
   init_opengl_buffers(*this, save_assets);
 }
 
-void init_opengl_buffers_internal(mesh_data &data,
-                                  std::vector<_render_vertex> &vertices,
-                                  std::vector<_blendshape_data> &blendshapes,
-                                  bool save_asset) {
-  // prepare default bounding box
-  for (int i = 0; i < data.vertices.size(); i++) {
-    data.bb_max = math::max3(data.bb_max, data.vertices[i].position.head<3>());
-    data.bb_min = math::min3(data.bb_min, data.vertices[i].position.head<3>());
-  }
-
+static void create_mesh_buffers(mesh_data &data,
+                                std::vector<_render_vertex> &vertices,
+                                std::vector<_blendshape_data> &blendshapes) {
   data.vertex_array.create();
   data.vertex_array.bind();
   data.vertex_buffer.create();
@@ -269,6 +265,22 @@ void init_opengl_buffers_internal(mesh_data &data,
                                                GL_STATIC_DRAW);
     }
   }
+}
+
+void init_opengl_buffers_internal(mesh_data &data,
+                                  std::vector<_render_vertex> &vertices,
+                                  std::vector<_blendshape_data> &blendshapes,
+                                  bool save_asset) {
+  // prepare default bounding box
+  for (int i = 0; i < data.vertices.size(); i++) {
+    data.bb_max = math::max3(data.bb_max, data.vertices[i].position.head<3>());
+    data.bb_min = math::min3(data.bb_min, data.vertices[i].position.head<3>());
+  }
+
+  // headless applications have no opengl context, only the cpu side data
+  // is prepared
+  if (g_instance.has_context())
+    create_mesh_buffers(data, vertices, blendshapes);
 
   if (save_asset) {
     // save data into text file relative to binary file
@@ -305,6 +317,15 @@ void init_opengl_buffers(mesh_data &data, bool save_asset) {
   init_opengl_buffers_internal(data, vertices, blendshapes, save_asset);
 }
 
+void free_opengl_buffers(mesh_data &data) {
+  if (!g_instance.has_context())
+    return;
+  data.vertex_array.del();
+  data.vertex_buffer.del();
+  data.index_buffer.del();
+  data.blendshape_targets.clear();
+}
+
 entt::entity create_cube(entt::registry &registry, math::matrix4 t) {
   auto ent = registry.create();
   auto &trans = registry.emplace<transform>(ent);
@@ -2,6 +2,7 @@
 
 #include "toolkit/opengl/base.hpp"
 #include "toolkit/system.hpp"
+#include "toolkit/transform.hpp"
 
 #include "toolkit/loaders/mesh.hpp"
 
@@ -30,18 +31,33 @@ struct mesh_data : public icomponent {
   void draw(GLenum mode = GL_TRIANGLES);
 
   void init1() override;
+  // copies share the vertex data and opengl buffers of the source mesh, there's
+  // no need to load the mesh asset again
+  void init_clone() {}
 
+  // set by update_buffers, the renderer rebuilds the scene buffers and clears it
   bool force_update_flag = false;
   void update_buffers(bool save_assets = false);
 };
 DECLARE_COMPONENT(mesh_data, data, mesh_name, model_name, should_render_mesh)
+SORT_WITH_HIERARCHY(mesh_data)
 
 struct skinned_mesh_bundle : public icomponent {
   std::vector<entt::entity> bone_entities, mesh_entities;
 };
+inline void remap_entities(skinned_mesh_bundle &comp,
+                           const entity_remap &remap) {
+  remap(comp.bone_entities);
+  remap(comp.mesh_entities);
+}
 DECLARE_COMPONENT(skinned_mesh_bundle, data, bone_entities, mesh_entities)
 
 void init_opengl_buffers(mesh_data &data, bool save_asset = true);
+/**
+ * Release the opengl buffers of a mesh, copies made by clone_hierarchy share
+ * the buffers of their source and keep them alive.
+ */
+void free_opengl_buffers(mesh_data &data);
 
 void draw_mesh_data(mesh_data &data, GLenum mode = GL_TRIANGLES);
 
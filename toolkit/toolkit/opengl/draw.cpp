@@ -34,7 +34,8 @@ void draw_lines(std::vector<std::pair<vector3, vector3>> &lines, matrix4 vp,
     initialized = true;
   }
   vao.bind();
-  std::vector<vector3> points;
+  std::pmr::vector<vector3> points(&frame_arena::instance());
+  points.reserve(2 * lines.size());
   for (auto &p : lines) {
     points.push_back(p.first);
     points.push_back(p.second);
@@ -119,7 +120,8 @@ void draw_capsules(std::vector<std::pair<math::vector3, math::vector3>> &lines,
     initialized = true;
   }
   vao.bind();
-  std::vector<vector3> points;
+  std::pmr::vector<vector3> points(&frame_arena::instance());
+  points.reserve(2 * lines.size());
   for (auto &p : lines) {
     points.push_back(p.first);
     points.push_back(p.second);
@@ -381,7 +383,8 @@ void draw_bones(std::vector<std::pair<math::vector3, math::vector3>> &bones,
   }
   // initialize vbo with `bones`
   vao.bind();
-  std::vector<math::vector3> buffer;
+  std::pmr::vector<math::vector3> buffer(&frame_arena::instance());
+  buffer.reserve(2 * bones.size());
   for (auto &pair : bones) {
     buffer.push_back(pair.first);  // bone start
     buffer.push_back(pair.second); // bond end
@@ -992,7 +995,8 @@ void draw_arrows(
   }
   // initialize vbo with `bones`
   vao.bind();
-  std::vector<math::vector3> buffer;
+  std::pmr::vector<math::vector3> buffer(&frame_arena::instance());
+  buffer.reserve(2 * start_end_pairs.size());
   for (auto &pair : start_end_pairs) {
     buffer.push_back(pair.first);  // bone start
     buffer.push_back(pair.second); // bond end
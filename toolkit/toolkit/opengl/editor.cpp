@@ -1,4 +1,5 @@
 #include "toolkit/opengl/editor.hpp"
+#include "toolkit/binary_scene.hpp"
 #include "toolkit/anim/components/actor.hpp"
 #include "toolkit/anim/scripts/vis.hpp"
 #include "toolkit/opengl/components/materials/all.hpp"
@@ -12,6 +13,7 @@ void editor::init() {
   auto &instance = context::get_instance();
   instance.init(1920, 1080, "Editor", 4, 6);
   reset();
+  connect_component_listener(registry, history);
 
   // init imgui
   imgui_io = &ImGui::GetIO();
@@ -19,7 +21,57 @@ void editor::init() {
   imgui_io->ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 }
 
-void editor::shutdown() { g_instance.shutdown(); }
+void editor::shutdown() {
+  disconnect_component_listener(registry, history);
+  g_instance.shutdown();
+}
+
+void editor::undo() {
+  if (history.undo(registry) && !registry.valid(selected_entity))
+    selected_entity = entt::null;
+}
+
+void editor::redo() {
+  if (history.redo(registry) && !registry.valid(selected_entity))
+    selected_entity = entt::null;
+}
+
+task<void> editor::import_model(std::string filepath) {
+  auto generation = scene_generation;
+  auto model = co_await assets::read_model_assimp(filepath);
+  co_await resume_on_main_thread();
+  if (model == nullptr)
+    co_return;
+  if (generation != scene_generation) {
+    spdlog::warn("Drop import of {0}, the scene changed", filepath);
+    co_return;
+  }
+  history.record(registry, "Import Model", {},
+                 [&]() { assets::build_model_assimp(registry, *model); });
+  spdlog::info("Import model to current scene from {0}", filepath);
+}
+
+task<void> editor::import_prefab_json(std::string filepath) {
+  auto generation = scene_generation;
+  auto bytes = co_await read_file_async(filepath);
+  // still on the worker reading the file
+  nlohmann::json data;
+  {
+    memory_scope memory(memory_tag::scenes);
+    data = nlohmann::json::parse(bytes.begin(), bytes.end(), nullptr, false);
+  }
+  co_await resume_on_main_thread();
+  if (bytes.empty() || data.is_discarded()) {
+    spdlog::error("Failed to import prefab from {0}", filepath);
+    co_return;
+  }
+  if (generation != scene_generation) {
+    spdlog::warn("Drop import of {0}, the scene changed", filepath);
+    co_return;
+  }
+  history.record(registry, "Import Prefab", {}, [&]() { load_prefab(data); });
+  spdlog::info("Import prefab to current scene from {0}", filepath);
+}
 
 void editor::late_serialize(nlohmann::json &j) {
   nlohmann::json editor_settings;
@@ -46,87 +98,105 @@ void editor::late_deserialize(nlohmann::json &j) {
   render_sys = get_sys<defered_forward_mixed>();
   script_sys = get_sys<script_system>();
   anim_sys = get_sys<anim::anim_system>();
+  history.clear();
+  scene_generation++;
 }
 
 void editor::run() {
   auto &instance = context::get_instance();
   timer.reset();
+  profiler::set_thread_name("main");
 
   add_default_objects();
 
   instance.run([&]() {
+    profiler::new_frame();
+    job_system::instance().process_main_thread();
     float dt = timer.elapse_s();
     timer.reset();
 
     transform_sys->update_transform(registry);
-    render_sys->update_scene_buffers(registry);
     active_camera_manipulate(dt);
 
-    for (auto sys : systems)
-      if (sys->active)
-        sys->preupdate(registry, dt);
+    update_phase(system_phase::preupdate, dt);
     if (script_sys->active)
       script_sys->preupdate(this, dt);
-    for (auto sys : systems)
-      if (sys->active)
-        sys->update(registry, dt);
+    update_phase(system_phase::update, dt);
     if (script_sys->active)
       script_sys->update(this, dt);
-    for (auto sys : systems)
-      if (sys->active)
-        sys->lateupdate(registry, dt);
+    update_phase(system_phase::lateupdate, dt);
     if (script_sys->active)
       script_sys->lateupdate(this, dt);
 
-    render_sys->render(registry);
+    // the scene, the debug shapes and the gizmos all show the registry after
+    // the late update
+    transform_sys->update_transform(registry);
+    render_sys->update_scene_buffers(registry);
+    render_sys->extract(registry);
+    render_sys->render();
+    render_sys->render_debug(registry);
 
     glClearColor(0, 0, 0, 1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0, 0, instance.wnd_width, instance.wnd_height);
 
-    instance.begin_imgui();
-
-    ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
-    ImGui::Begin("Scene");
-    ImGui::BeginChild("GameRenderer");
-    auto size = ImGui::GetContentRegionAvail();
-    auto pos = ImGui::GetWindowPos();
-    instance.scene_pos_x = pos.x;
-    instance.scene_pos_y = pos.y;
-    ImGui::Image((void *)static_cast<std::uintptr_t>(
-                     render_sys->get_target_texture().get_handle()),
-                 {size.x, size.y}, ImVec2(0, 1), ImVec2(1, 0));
-    if (instance.scene_width != size.x || instance.scene_height != size.y) {
-      // resize sceneFBO
-      instance.scene_width = size.x;
-      instance.scene_height = size.y;
-      render_sys->resize(size.x, size.y);
-      render_sys->render(registry);
+    {
+      PROFILE_SCOPE("editor gui");
+      instance.begin_imgui();
+
+      ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
+      ImGui::Begin("Scene");
+      ImGui::BeginChild("GameRenderer");
+      auto size = ImGui::GetContentRegionAvail();
+      auto pos = ImGui::GetWindowPos();
+      instance.scene_pos_x = pos.x;
+      instance.scene_pos_y = pos.y;
+      ImGui::Image((void *)static_cast<std::uintptr_t>(
+                       render_sys->get_target_texture().get_handle()),
+                   {size.x, size.y}, ImVec2(0, 1), ImVec2(1, 0));
+      if (instance.scene_width != size.x || instance.scene_height != size.y) {
+        // resize sceneFBO
+        instance.scene_width = size.x;
+        instance.scene_height = size.y;
+        render_sys->resize(size.x, size.y);
+        render_sys->render();
+      }
+      draw_gizmos();
+      ImGui::EndChild();
+      ImGui::End();
+
+      draw_main_menubar();
+      draw_entity_hierarchy();
+      draw_entity_components();
+      editor_shortkeys();
+      if (show_profiler)
+        profiler_panel.draw(&show_profiler);
+
+      instance.end_imgui();
     }
-    draw_gizmos();
-    ImGui::EndChild();
-    ImGui::End();
-
-    draw_main_menubar();
-    draw_entity_hierarchy();
-    draw_entity_components();
-    editor_shortkeys();
-
-    instance.end_imgui();
 
+    PROFILE_SCOPE("swap buffer");
     instance.swap_buffer();
+    frame_arena::instance().reset();
+    memory_tracker::check_budgets();
+    gpu_resources::instance().collect();
   });
 }
 
 void editor::reset() {
   registry.clear();
-  systems.clear();
+  history.clear();
+  scene_generation++;
+  clear_systems();
 
   transform_sys = add_sys<transform_system>();
   render_sys = add_sys<defered_forward_mixed>();
   script_sys = add_sys<script_system>();
   anim_sys = add_sys<anim::anim_system>();
   phy_sys = add_sys<physics::physics_system>();
+  add_sys<autosave_system>();
+  add_sys<world_partition>();
+  add_sys<frame_recorder>();
 }
 
 void editor::add_default_objects() {
@@ -139,6 +209,16 @@ void editor::add_default_objects() {
 }
 
 void editor::editor_shortkeys() {
+  if (!imgui_io->WantTextInput &&
+      g_instance.is_key_pressed(GLFW_KEY_LEFT_CONTROL)) {
+    if (g_instance.is_key_triggered(GLFW_KEY_Z)) {
+      if (g_instance.is_key_pressed(GLFW_KEY_LEFT_SHIFT))
+        redo();
+      else
+        undo();
+    } else if (g_instance.is_key_triggered(GLFW_KEY_Y))
+      redo();
+  }
   if (g_instance.cursor_in_scene_window()) {
     // only change the gizmo operation mode
     // if the cursor is inside scene window
@@ -163,9 +243,11 @@ void editor::editor_shortkeys() {
         g_instance.is_mouse_button_triggered(GLFW_MOUSE_BUTTON_LEFT)) {
       math::vector3 ray_o, ray_d;
       if (mouse_query_ray(ray_o, ray_d)) {
-        std::priority_queue<ray_query_data, std::vector<ray_query_data>,
+        std::priority_queue<ray_query_data,
+                            std::pmr::vector<ray_query_data>,
                             compare_ray_query_data>
-            q;
+            q(compare_ray_query_data(),
+              std::pmr::vector<ray_query_data>(&frame_arena::instance()));
         registry.view<entt::entity, transform>().each(
             [&](entt::entity entity, transform &trans) {
               if (entity == g_instance.active_camera)
@@ -406,6 +488,11 @@ void editor::draw_gizmos(bool enable) {
     auto &camTrans = registry.get<transform>(g_instance.active_camera);
     auto &camComp = registry.get<camera>(g_instance.active_camera);
     if (registry.valid(selected_entity)) {
+      // a drag starts on a click and moves the transform in that frame already
+      if (!gizmo_dragging && ImGuizmo::IsOver() &&
+          ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+        gizmo_before =
+            history.capture(registry, {selected_entity}, {"transform"});
       auto &selTrans = registry.get<transform>(selected_entity);
       math::matrix4 transform = selTrans.matrix();
       if (ImGuizmo::Manipulate(camComp.view.data(), camComp.proj.data(),
@@ -429,7 +516,15 @@ void editor::draw_gizmos(bool enable) {
         if ((current_gizmo_operation() & ImGuizmo::SCALE) != 0)
           selTrans.set_world_scale(scale);
       }
-    }
+      // the whole drag becomes one history entry
+      if (ImGuizmo::IsUsing())
+        gizmo_dragging = true;
+      else if (gizmo_dragging) {
+        history.commit(registry, "Gizmo Edit", std::move(gizmo_before));
+        gizmo_dragging = false;
+      }
+    } else
+      gizmo_dragging = false;
   }
 }
 
@@ -447,11 +542,7 @@ void editor::draw_main_menubar() {
         std::string filepath;
         if (save_file_dialog("Serialize scene file", {"*.scene"}, "Scene File",
                              filepath)) {
-          auto data = serialize();
-          std::ofstream output(filepath);
-          if (output.is_open()) {
-            output << data.dump(2) << std::endl;
-            output.close();
+          if (serialize_binary(filepath)) {
             spdlog::info("Save scene to {0}", filepath);
           } else {
             spdlog::error("Failed to save scene to {0}", filepath);
@@ -462,15 +553,42 @@ void editor::draw_main_menubar() {
         std::string filepath;
         if (open_file_dialog("Deserialize scene file", {"*.scene"},
                              "Scene File", filepath)) {
-          std::ifstream input(filepath);
-          if (input.is_open()) {
-            auto data = nlohmann::json::parse(
-                std::string((std::istreambuf_iterator<char>(input)),
-                            std::istreambuf_iterator<char>()));
-            deserialize(data);
-            spdlog::info("Load scene from {0}", filepath);
+          if (is_binary_scene_file(filepath)) {
+            if (deserialize_binary(filepath))
+              spdlog::info("Load scene from {0}", filepath);
+            else
+              spdlog::error("Failed to load scene from {0}", filepath);
           } else {
-            spdlog::error("Failed to load scene from {0}", filepath);
+            // scenes saved as json are still supported
+            if (deserialize_json_file(filepath))
+              spdlog::info("Load scene from {0}", filepath);
+            else
+              spdlog::error("Failed to load scene from {0}", filepath);
+          }
+        }
+      }
+      if (ImGui::MenuItem("Recover Autosave")) {
+        std::string directory = "autosave";
+        if (auto autosave = get_sys<autosave_system>())
+          directory = autosave->directory;
+        if (autosave_system::recover(this, directory))
+          spdlog::info("Recover autosaved scene from {0}", directory);
+        else
+          spdlog::error("Failed to recover autosaved scene from {0}",
+                        directory);
+      }
+      if (ImGui::MenuItem("Export Scene Json")) {
+        std::string filepath;
+        if (save_file_dialog("Export scene as json", {"*.json"}, "Json File",
+                             filepath)) {
+          auto data = serialize();
+          std::ofstream output(filepath);
+          if (output.is_open()) {
+            output << data.dump(2) << std::endl;
+            output.close();
+            spdlog::info("Export scene to {0}", filepath);
+          } else {
+            spdlog::error("Failed to export scene to {0}", filepath);
           }
         }
       }
@@ -481,17 +599,19 @@ void editor::draw_main_menubar() {
         std::string filepath;
         if (open_file_dialog("Import prefab to current scene", {"*.prefab"},
                              "*.prefab", filepath)) {
-          std::ifstream input(filepath);
-          if (input.is_open()) {
-            auto data = nlohmann::json::parse(
-                std::string((std::istreambuf_iterator<char>(input)),
-                            std::istreambuf_iterator<char>()));
-            load_prefab(data);
-            spdlog::info("Import prefab to current scene from {0}", filepath);
+          if (is_binary_scene_file(filepath)) {
+            entt::entity root = entt::null;
+            history.record(registry, "Import Prefab", {}, [&]() {
+              root = load_prefab_binary(filepath);
+            });
+            if (root != entt::null)
+              spdlog::info("Import prefab to current scene from {0}",
+                           filepath);
+            else
+              spdlog::error("Failed to import prefab from {0}", filepath);
           } else {
-            spdlog::error("Failed to import prefab from {0}", filepath);
+            spawn(import_prefab_json(filepath));
           }
-          input.close();
         }
       }
       ImGui::Separator();
@@ -505,7 +625,7 @@ void editor::draw_main_menubar() {
                              "*.fbx, *.obj, *.pmx, *.ply", filepath)) {
           spdlog::info("Load model file {0}", filepath);
           // assets::open_model_ufbx(registry, filepath);
-          assets::open_model_assimp(registry, filepath);
+          spawn(import_model(filepath));
         }
       }
       // if (ImGui::MenuItem("Import   BVH")) {
@@ -518,6 +638,25 @@ void editor::draw_main_menubar() {
       // }
       ImGui::EndMenu();
     }
+    if (ImGui::BeginMenu("Edit")) {
+      if (ImGui::MenuItem(
+              str_format("Undo %s", history.undo_label().c_str()).c_str(),
+              "Ctrl+Z", false, history.can_undo()))
+        undo();
+      if (ImGui::MenuItem(
+              str_format("Redo %s", history.redo_label().c_str()).c_str(),
+              "Ctrl+Y", false, history.can_redo()))
+        redo();
+      ImGui::Separator();
+      ImGui::MenuItem(str_format("History: %d entries, %.2f MB",
+                                 static_cast<int>(history.size()),
+                                 history.memory_usage() / 1048576.0)
+                          .c_str(),
+                      nullptr, false, false);
+      if (ImGui::MenuItem("Clear History"))
+        history.clear();
+      ImGui::EndMenu();
+    }
     if (ImGui::BeginMenu("Settings")) {
       // system configuration
       ImGui::MenuItem("Configure Systems", nullptr, false, false);
@@ -532,6 +671,7 @@ void editor::draw_main_menubar() {
 
       ImGui::Separator();
       ImGui::MenuItem("Editor Settings", nullptr, false, false);
+      ImGui::MenuItem("Show Profiler", nullptr, &show_profiler);
       std::vector<std::string> valid_camera_names;
       std::vector<entt::entity> valid_cameras;
       int active_camera_index = -1, tmp_counter = 0;
@@ -589,8 +729,8 @@ void editor::draw_main_menubar() {
 }
 
 void draw_entity_hierarchy_recursive(
-    entt::registry &registry, entt::entity &selected, entt::entity current,
-    ImGuiTreeNodeFlags flag,
+    entt::registry &registry, edit_history &history, entt::entity &selected,
+    entt::entity current, ImGuiTreeNodeFlags flag,
     std::function<void(entt::entity)> rightClickEntity) {
   bool currentSelected = (selected == current);
   ImGuiTreeNodeFlags finalFlag = flag;
@@ -627,14 +767,18 @@ void draw_entity_hierarchy_recursive(
   if (ImGui::BeginDragDropTarget()) {
     if (const ImGuiPayload *payload = ImGui::AcceptDragDropPayload("ENTITY")) {
       auto entity = *(entt::entity *)payload->Data;
-      current_transform.add_child(entity);
+      history.record(
+          registry, "Change Parent",
+          {current, entity, registry.get<transform>(entity).m_parent},
+          [&]() { current_transform.add_child(entity); });
     }
     ImGui::EndDragDropTarget();
   }
 
   // Right click context menu
   if (ImGui::BeginPopupContextItem(
-          (current_transform.name + std::to_string(entt::to_integral(current)))
+          (current_transform.name.str() +
+           std::to_string(entt::to_integral(current)))
               .c_str(),
           ImGuiPopupFlags_MouseButtonRight)) {
     rightClickEntity(current);
@@ -644,7 +788,7 @@ void draw_entity_hierarchy_recursive(
   // Draw children nodes
   if (nodeOpen) {
     for (auto c : current_transform.m_children)
-      draw_entity_hierarchy_recursive(registry, selected, c, flag,
+      draw_entity_hierarchy_recursive(registry, history, selected, c, flag,
                                       rightClickEntity);
     ImGui::TreePop();
   }
@@ -670,28 +814,36 @@ void editor::draw_entity_hierarchy() {
     ImGui::SeparatorText("Operation");
     if (ImGui::BeginMenu("Create")) {
       if (ImGui::MenuItem("New Entity")) {
-        auto ent = registry.create();
-        auto &trans = registry.emplace<transform>(ent);
-        trans.name = str_format("new entity: %d", entt::to_integral(ent));
+        history.record(registry, "New Entity", {}, [&]() {
+          auto ent = registry.create();
+          auto &trans = registry.emplace<transform>(ent);
+          trans.name = str_format("new entity: %d", entt::to_integral(ent));
+        });
       }
 
       ImGui::Separator();
       if (ImGui::MenuItem("New Cube"))
-        create_cube(registry);
+        history.record(registry, "New Cube", {},
+                       [&]() { create_cube(registry); });
       if (ImGui::MenuItem("New Sphere"))
-        create_sphere(registry);
+        history.record(registry, "New Sphere", {},
+                       [&]() { create_sphere(registry); });
       if (ImGui::MenuItem("New Cylinder"))
-        create_cylinder(registry);
+        history.record(registry, "New Cylinder", {},
+                       [&]() { create_cylinder(registry); });
       if (ImGui::MenuItem("New Plane"))
-        create_plane(registry);
+        history.record(registry, "New Plane", {},
+                       [&]() { create_plane(registry); });
 
       ImGui::Separator();
       if (ImGui::MenuItem("New Point Light")) {
-        auto ent = registry.create();
-        auto &trans = registry.emplace<transform>(ent);
-        auto number = registry.view<point_light>().size();
-        trans.name = str_format("Point Light (%d)", number);
-        auto &light = registry.emplace<point_light>(ent);
+        history.record(registry, "New Point Light", {}, [&]() {
+          auto ent = registry.create();
+          auto &trans = registry.emplace<transform>(ent);
+          auto number = registry.view<point_light>().size();
+          trans.name = str_format("Point Light (%d)", number);
+          auto &light = registry.emplace<point_light>(ent);
+        });
       }
 
       ImGui::EndMenu();
@@ -702,27 +854,50 @@ void editor::draw_entity_hierarchy() {
     if (ImGui::MenuItem("Select")) {
       selected_entity = entity;
     }
+    if (ImGui::MenuItem("Duplicate")) {
+      std::vector<entt::entity> copies;
+      history.record(registry, "Duplicate", {},
+                     [&]() { copies = clone_hierarchy(entity); });
+      if (!copies.empty())
+        selected_entity = copies[0];
+    }
     if (ImGui::MenuItem("Make Prefab")) {
       std::string filepath;
       if (save_file_dialog("Save entity hierarchy as prefab", {"*.prefab"},
                            "*.prefab", filepath)) {
+        if (make_prefab_binary(entity, filepath)) {
+          spdlog::info("Save prefab to filepath {0}", filepath);
+        } else {
+          spdlog::error("Failed to save prefab to filepath {0}", filepath);
+        }
+      }
+    }
+    if (ImGui::MenuItem("Export Prefab Json")) {
+      std::string filepath;
+      if (save_file_dialog("Export entity hierarchy as json", {"*.json"},
+                           "Json File", filepath)) {
         auto data = make_prefab(entity);
         std::ofstream output(filepath);
         if (output.is_open()) {
           output << data.dump(2) << std::endl;
-          spdlog::info("Save prefab to filepath {0}", filepath);
+          spdlog::info("Export prefab to filepath {0}", filepath);
         } else {
-          spdlog::error("Failed to save prefab to filepath {0}", filepath);
+          spdlog::error("Failed to export prefab to filepath {0}", filepath);
         }
         output.close();
       }
     }
     if (ImGui::MenuItem("Clear Parent")) {
       auto &trans = registry.get<transform>(entity);
-      trans.remove_parent();
+      history.record(registry, "Clear Parent", {entity, trans.m_parent},
+                     [&]() { trans.remove_parent(); });
     }
     if (ImGui::MenuItem("Delete Entity")) {
-      destroy_hierarchy(registry, entity);
+      // the parent loses a child, the destroyed entities are restored by undo
+      auto entities = collect_hierarchy(registry, entity);
+      entities.push_back(registry.get<transform>(entity).m_parent);
+      history.record(registry, "Delete Entity", entities,
+                     [&]() { destroy_hierarchy(registry, entity); });
     }
   };
 
@@ -745,7 +920,7 @@ void editor::draw_entity_hierarchy() {
   ImGui::BeginChild("DrawEntityHierarchy_entityhierarchy",
                     ImGui::GetContentRegionAvail());
   for (auto ent : transform_sys->root_entities)
-    draw_entity_hierarchy_recursive(registry, selected_entity, ent,
+    draw_entity_hierarchy_recursive(registry, history, selected_entity, ent,
                                     guiTreeNodeFlags, right_click_entity);
   ImGui::EndChild();
   ImGui::End();
@@ -782,7 +957,8 @@ void editor::draw_entity_components() {
             if (ImGui::MenuItem(i.first.c_str())) {
               spdlog::info("create component {0} for entity {1}", i.first,
                            entt::to_integral(current_entity));
-              i.second(registry, current_entity);
+              history.record(registry, "Add Component", {current_entity},
+                             [&]() { i.second(registry, current_entity); });
             }
           }
           ImGui::EndMenu();
@@ -792,8 +968,38 @@ void editor::draw_entity_components() {
     }
     ImGui::Separator();
 
+    // the component guis modify the components directly. A click or a key
+    // press can activate a widget and edit it in the same frame (e.g. a slider
+    // jumping to the cursor), the baseline is taken before the widgets then
+    bool pressed =
+        ImGui::IsMouseClicked(ImGuiMouseButton_Left) ||
+        (ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows) &&
+         (ImGui::IsKeyPressed(ImGuiKey_Space, false) ||
+          ImGui::IsKeyPressed(ImGuiKey_Enter, false) ||
+          ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false)));
+    if (pressed) {
+      component_panel.before = history.capture(registry, {current_entity});
+      component_panel.entity = current_entity;
+    }
+    ImGui::BeginGroup();
     for (auto &sys : systems)
       sys->draw_gui(registry, current_entity);
+    ImGui::EndGroup();
+    if (ImGui::IsItemActivated() && !pressed) {
+      component_panel.before = history.capture(registry, {current_entity});
+      component_panel.entity = current_entity;
+    }
+    if (ImGui::IsItemEdited() && component_panel.entity == current_entity) {
+      mark_components_changed(registry, current_entity);
+      // one entry per widget interaction, e.g. a whole slider drag
+      history.commit(registry, "Edit Components",
+                     std::move(component_panel.before),
+                     entt::to_integral(current_entity) + 1ull);
+      // the widget may still be in use
+      component_panel.before = history.capture(registry, {current_entity});
+    }
+    if (ImGui::IsItemDeactivated())
+      history.seal();
   } else
     current_entity = entt::null;
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "toolkit/autosave.hpp"
+#include "toolkit/history.hpp"
+#include "toolkit/recorder.hpp"
 #include "toolkit/opengl/base.hpp"
 #include "toolkit/scriptable.hpp"
 #include "toolkit/system.hpp"
@@ -9,6 +12,8 @@
 
 #include "toolkit/anim/anim_system.hpp"
 #include "toolkit/opengl/components/camera.hpp"
+#include "toolkit/opengl/gui/profiler.hpp"
+#include "toolkit/opengl/partition.hpp"
 #include "toolkit/opengl/rasterize/mixed.hpp"
 #include "toolkit/physics/system.hpp"
 
@@ -21,6 +26,22 @@ std::string wstring_to_string(const std::wstring &wstr);
 void open_model_ufbx(entt::registry &registry, std::string filepath);
 void open_model_assimp(entt::registry &registry, std::string filepath);
 
+// a model file parsed by assimp
+struct assimp_model;
+/**
+ * Parse the model file on a worker, nullptr if it fails. The entities are
+ * created from it by `build_model_assimp` on the main thread.
+ */
+task<std::shared_ptr<assimp_model>> read_model_assimp(std::string filepath);
+entt::entity build_model_assimp(entt::registry &registry,
+                                const assimp_model &model);
+
+// a model file parsed by ufbx, loaded the same way as `assimp_model`
+struct ufbx_model;
+task<std::shared_ptr<ufbx_model>> read_model_ufbx(std::string filepath);
+entt::entity build_model_ufbx(entt::registry &registry,
+                              const ufbx_model &model);
+
 }; // namespace toolkit::assets
 
 namespace toolkit::opengl {
@@ -75,12 +96,23 @@ public:
 
   entt::entity selected_entity = entt::null;
 
+  /**
+   * Gizmo, component panel and hierarchy edits are recorded here, it gets
+   * cleared whenever a scene is loaded or reset.
+   */
+  edit_history history;
+  void undo();
+  void redo();
+
   defered_forward_mixed *render_sys = nullptr;
   transform_system *transform_sys = nullptr;
   script_system *script_sys = nullptr;
   anim::anim_system *anim_sys = nullptr;
   physics::physics_system *phy_sys = nullptr;
 
+  gui::profiler_window profiler_panel;
+  bool show_profiler = false;
+
   float click_selection_max_sin = 2e-2f;
   std::vector<ray_query_data> selection_candidates;
 
@@ -110,10 +142,31 @@ public:
 
   void active_camera_manipulate(float dt);
 
+  /**
+   * Parse the files on the workers and add their content to the scene once
+   * they're ready, the frame loop keeps running meanwhile. Imports still
+   * running when the scene gets reset or loaded are dropped.
+   */
+  task<void> import_model(std::string filepath);
+  task<void> import_prefab_json(std::string filepath);
+
 private:
   int gizmo_mode_idx = 0;
+  // transform of the selected entity before the current gizmo drag
+  bool gizmo_dragging = false;
+  edit_snapshot gizmo_before;
+
+  // components of the entity shown in the component panel before the widget
+  // being used edits them
+  struct component_baseline {
+    entt::entity entity = entt::null;
+    edit_snapshot before;
+  } component_panel;
 
   active_camera_manipulate_data cam_manip_data;
+
+  // bumped when the scene gets replaced, pending imports check it
+  std::uint64_t scene_generation = 0;
 };
 
 inline void script_draw_to_scene_proxy(
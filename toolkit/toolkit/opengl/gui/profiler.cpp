@@ -0,0 +1,216 @@
+#include "toolkit/opengl/gui/profiler.hpp"
+
+namespace toolkit::gui {
+
+void profiler_window::take_snapshot() {
+  frames = profiler::frames();
+  if (frames.size() > history + 1)
+    frames.erase(frames.begin(), frames.end() - (history + 1));
+  std::uint64_t since = frames.empty() ? 0 : frames.front();
+  threads.clear();
+  for (auto &ring : profiler::rings()) {
+    thread_zones t;
+    ring->collect(since, t.zones);
+    if (t.zones.empty())
+      continue;
+    t.name = profiler::thread_name(*ring);
+    for (auto &zone : t.zones)
+      t.max_depth = std::max(t.max_depth, zone.depth);
+    threads.push_back(std::move(t));
+  }
+}
+
+void profiler_window::draw(bool *open) {
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+  bool recording = profiler::enabled;
+  if (ImGui::Checkbox("Record", &recording))
+    profiler::enabled = recording;
+  ImGui::SameLine();
+  ImGui::Checkbox("Pause", &paused);
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(120.0f);
+  ImGui::DragInt("History", &history, 1.0f, 16, profiler::frame_capacity - 1);
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome Trace")) {
+    std::string filepath;
+    if (save_file_dialog("Export chrome trace", {"*.json"}, "Chrome Trace",
+                         filepath)) {
+      if (profiler::export_chrome_trace(filepath))
+        spdlog::info("Export chrome trace to {0}", filepath);
+    }
+  }
+  draw_memory();
+  if (!paused)
+    take_snapshot();
+  if (frames.size() < 2) {
+    ImGui::Text("No complete frame recorded yet");
+    ImGui::End();
+    return;
+  }
+  draw_frame_times();
+  draw_timeline();
+  ImGui::End();
+}
+
+void profiler_window::draw_frame_times() {
+  int num_frames = frames.size() - 1;
+  if (selected_frame >= num_frames)
+    selected_frame = -1;
+  std::vector<float> durations(num_frames);
+  for (int i = 0; i < num_frames; i++)
+    durations[i] = (frames[i + 1] - frames[i]) * 1e-6f;
+  if (ImPlot::BeginPlot("##frame times", ImVec2(-1, 120),
+                        ImPlotFlags_NoLegend | ImPlotFlags_NoMenus)) {
+    ImPlot::SetupAxes(nullptr, "ms", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotBars("frame time", durations.data(), num_frames, 1.0);
+    double selected = selected_frame < 0 ? num_frames - 1 : selected_frame;
+    ImPlot::PlotInfLines("selected", &selected, 1);
+    if (ImPlot::IsPlotHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+      int clicked = std::round(ImPlot::GetPlotMousePos().x);
+      if (clicked >= 0 && clicked < num_frames)
+        selected_frame = clicked == num_frames - 1 ? -1 : clicked;
+    }
+    ImPlot::EndPlot();
+  }
+}
+
+void profiler_window::draw_timeline() {
+  int frame = selected_frame < 0 ? frames.size() - 2 : selected_frame;
+  std::uint64_t frame_start = frames[frame], frame_end = frames[frame + 1];
+  double frame_ms = (frame_end - frame_start) * 1e-6;
+  ImGui::Text("Frame %d: %.3f ms", frame, frame_ms);
+
+  // every thread gets one row per nesting depth
+  std::vector<double> row_base, tick_pos;
+  std::vector<const char *> tick_labels;
+  double num_rows = 0.0;
+  for (auto &t : threads) {
+    row_base.push_back(num_rows);
+    tick_pos.push_back(num_rows + 0.5);
+    tick_labels.push_back(t.name.c_str());
+    num_rows += t.max_depth + 1.5;
+  }
+
+  if (!ImPlot::BeginPlot("##timeline", ImVec2(-1, -1),
+                         ImPlotFlags_NoLegend | ImPlotFlags_NoMenus))
+    return;
+  // follow the latest frame unless the user is inspecting the history
+  auto cond = paused ? ImPlotCond_Once : ImPlotCond_Always;
+  ImPlot::SetupAxis(ImAxis_X1, "ms");
+  ImPlot::SetupAxis(ImAxis_Y1, nullptr, ImPlotAxisFlags_Invert);
+  ImPlot::SetupAxisLimits(ImAxis_X1, 0.0, frame_ms, cond);
+  ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, std::max(num_rows, 1.0), cond);
+  if (!tick_pos.empty())
+    ImPlot::SetupAxisTicks(ImAxis_Y1, tick_pos.data(), tick_pos.size(),
+                           tick_labels.data());
+  ImPlot::SetupFinish();
+
+  auto draw_list = ImPlot::GetPlotDrawList();
+  auto mouse = ImGui::GetMousePos();
+  bool hovered = ImPlot::IsPlotHovered();
+  int num_colors = ImPlot::GetColormapSize();
+  ImPlot::PushPlotClipRect();
+  for (int ti = 0; ti < threads.size(); ti++) {
+    for (auto &zone : threads[ti].zones) {
+      if (zone.end_ns <= frame_start || zone.start_ns >= frame_end)
+        continue;
+      double x0 = ((double)zone.start_ns - frame_start) * 1e-6;
+      double x1 = ((double)zone.end_ns - frame_start) * 1e-6;
+      double y = row_base[ti] + zone.depth;
+      auto p0 = ImPlot::PlotToPixels(x0, y);
+      auto p1 = ImPlot::PlotToPixels(x1, y + 0.9);
+      ImVec2 pmin(std::min(p0.x, p1.x), std::min(p0.y, p1.y));
+      ImVec2 pmax(std::max(p0.x, p1.x), std::max(p0.y, p1.y));
+      if (pmax.x - pmin.x < 1.0f)
+        pmax.x = pmin.x + 1.0f;
+      // zones from the same call site share the same name pointer
+      auto color = ImPlot::GetColormapColor(
+          (std::hash<const void *>{}(zone.name) >> 4) % num_colors);
+      draw_list->AddRectFilled(pmin, pmax, ImGui::GetColorU32(color));
+      auto text_size = ImGui::CalcTextSize(zone.name);
+      if (text_size.x + 4.0f < pmax.x - pmin.x)
+        draw_list->AddText(
+            ImVec2(pmin.x + 2.0f, (pmin.y + pmax.y - text_size.y) * 0.5f),
+            IM_COL32_BLACK, zone.name);
+      if (hovered && mouse.x >= pmin.x && mouse.x <= pmax.x &&
+          mouse.y >= pmin.y && mouse.y <= pmax.y) {
+        ImGui::BeginTooltip();
+        ImGui::Text("%s", zone.name);
+        ImGui::Text("%.3f ms", (zone.end_ns - zone.start_ns) * 1e-6);
+        ImGui::EndTooltip();
+      }
+    }
+  }
+  ImPlot::PopPlotClipRect();
+  ImPlot::EndPlot();
+}
+
+void profiler_window::draw_memory() {
+  if (!ImGui::CollapsingHeader("Memory"))
+    return;
+  if (ImGui::Button("Reset Peaks"))
+    memory_tracker::reset_peaks();
+  if (!ImGui::BeginTable("##memory", 5,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    return;
+  ImGui::TableSetupColumn("Tag");
+  ImGui::TableSetupColumn("Current (MB)");
+  ImGui::TableSetupColumn("Peak (MB)");
+  ImGui::TableSetupColumn("Allocations");
+  ImGui::TableSetupColumn("Budget (MB)");
+  ImGui::TableHeadersRow();
+  for (auto &stats : memory_tracker::snapshot()) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::Text("%s", memory_tag_name(stats.tag));
+    ImGui::TableNextColumn();
+    bool over_budget = stats.budget > 0 && stats.current > stats.budget;
+    if (over_budget)
+      ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
+    ImGui::Text("%.2f", stats.current / 1048576.0);
+    if (over_budget)
+      ImGui::PopStyleColor();
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", stats.peak / 1048576.0);
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld", (long long)stats.allocations);
+    ImGui::TableNextColumn();
+    // 0 for no budget
+    float budget = stats.budget / 1048576.0f;
+    ImGui::PushID((int)stats.tag);
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::DragFloat("##budget", &budget, 1.0f, 0.0f, 1e6f, "%.0f"))
+      memory_tracker::set_budget(stats.tag,
+                                 (std::int64_t)(budget * 1048576.0));
+    ImGui::PopID();
+  }
+  ImGui::EndTable();
+
+  ImGui::Text("Video Memory");
+  if (!ImGui::BeginTable("##video memory", 4,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+    return;
+  ImGui::TableSetupColumn("Type");
+  ImGui::TableSetupColumn("Size (MB)");
+  ImGui::TableSetupColumn("Objects");
+  ImGui::TableSetupColumn("Pending Deletion");
+  ImGui::TableHeadersRow();
+  for (auto &stats : opengl::gpu_resources::instance().snapshot()) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::Text("%s", opengl::gpu_resource_type_name(stats.type));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", stats.bytes / 1048576.0);
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld", (long long)stats.count);
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld", (long long)stats.pending);
+  }
+  ImGui::EndTable();
+}
+
+}; // namespace toolkit::gui
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "toolkit/opengl/base.hpp"
+#include "toolkit/profiler.hpp"
+
+namespace toolkit::gui {
+
+/**
+ * Editor window showing the recent frame times and the zones recorded by
+ * `toolkit::profiler` for one frame, one row per thread. Click on the frame
+ * time plot to inspect an older frame.
+ */
+class profiler_window {
+public:
+  void draw(bool *open = nullptr);
+
+  // number of frames kept in the snapshot
+  int history = 240;
+  bool paused = false;
+
+private:
+  struct thread_zones {
+    std::string name;
+    std::vector<profiler_zone> zones;
+    std::uint32_t max_depth = 0;
+  };
+
+  void take_snapshot();
+  void draw_frame_times();
+  void draw_timeline();
+  void draw_memory();
+
+  std::vector<std::uint64_t> frames;
+  std::vector<thread_zones> threads;
+  // index into `frames` of the inspected frame, -1 for the latest one
+  int selected_frame = -1;
+};
+
+}; // namespace toolkit::gui
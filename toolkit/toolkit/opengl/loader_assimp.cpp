@@ -25,7 +25,8 @@ math::matrix4 convert_assimp_mat4(const aiMatrix4x4 &assimp_mat4) {
 void build_skeleton(
     const entt::registry &registry, entt::entity cur,
     const std::map<aiNode *, entt::entity> &node_mapping,
-    const std::map<std::string, entt::entity> &name_to_bone_entity,
+    const std::unordered_map<interned_string, entt::entity>
+        &name_to_bone_entity,
     anim::actor &actor_comp) {
   auto &cur_trans = registry.get<transform>(cur);
   if (name_to_bone_entity.find(cur_trans.name) != name_to_bone_entity.end()) {
@@ -40,7 +41,7 @@ void collect_bone_entities(entt::registry &registry,
                            std::map<aiNode *, entt::entity> &node_mapping,
                            std::vector<entt::entity> &bone_entities,
                            const aiScene *scene) {
-  std::map<std::string, entt::entity> name_to_bone_entity;
+  std::unordered_map<interned_string, entt::entity> name_to_bone_entity;
   for (auto &p : node_mapping) {
     for (int i = 0; i < p.first->mNumMeshes; i++) {
       auto mesh = scene->mMeshes[p.first->mMeshes[i]];
@@ -253,18 +254,46 @@ build_node_mapping(entt::registry &registry, aiNode *node, const aiScene *scene,
   return ent;
 }
 
-void open_model_assimp(entt::registry &registry, std::string filepath) {
+struct assimp_model {
   Assimp::Importer importer;
-  const aiScene *scene = importer.ReadFile(
+  const aiScene *scene = nullptr;
+  std::string filepath;
+};
+
+static std::shared_ptr<assimp_model> parse_model_assimp(std::string filepath) {
+  PROFILE_SCOPE("parse_model_assimp");
+  memory_scope memory(memory_tag::meshes);
+  auto model = std::make_shared<assimp_model>();
+  model->filepath = filepath;
+  model->scene = model->importer.ReadFile(
       filepath, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
                     aiProcess_CalcTangentSpace | aiProcess_GenNormals |
                     aiProcess_LimitBoneWeights |
                     aiProcess_PopulateArmatureData | aiProcess_GlobalScale);
-
-  if (!scene || !scene->mRootNode) {
-    std::cerr << "Assimp failed: " << importer.GetErrorString() << std::endl;
-    return;
+  if (!model->scene || !model->scene->mRootNode) {
+    spdlog::error("Assimp failed to load {0}: {1}", filepath,
+                  model->importer.GetErrorString());
+    return nullptr;
   }
+  return model;
+}
+
+task<std::shared_ptr<assimp_model>> read_model_assimp(std::string filepath) {
+  co_await resume_on_workers();
+  co_return parse_model_assimp(filepath);
+}
+
+void open_model_assimp(entt::registry &registry, std::string filepath) {
+  if (auto model = parse_model_assimp(filepath))
+    build_model_assimp(registry, *model);
+}
+
+entt::entity build_model_assimp(entt::registry &registry,
+                                const assimp_model &model) {
+  PROFILE_SCOPE("build_model_assimp");
+  memory_scope memory(memory_tag::meshes);
+  auto &filepath = model.filepath;
+  auto scene = model.scene;
 
 #ifdef _WIN32
   std::string filename =
@@ -317,6 +346,7 @@ void open_model_assimp(entt::registry &registry, std::string filepath) {
 
   // handle animation track loading if any
   // ...
+  return root_entity;
 }
 
 }; // namespace toolkit::assets
\ No newline at end of file
@@ -380,7 +380,15 @@ std::vector<entt::entity> create_skinned_mesh_bundle_data(
   return bone_entities;
 }
 
-void open_model_ufbx(entt::registry &registry, std::string filepath) {
+struct ufbx_model {
+  ufbx_scene *scene = nullptr;
+  std::string filepath;
+  ~ufbx_model() { ufbx_free_scene(scene); }
+};
+
+static std::shared_ptr<ufbx_model> parse_model_ufbx(std::string filepath) {
+  PROFILE_SCOPE("parse_model_ufbx");
+  memory_scope memory(memory_tag::meshes);
   ufbx_error error;
   ufbx_load_opts opts = {
       .load_external_files = true,
@@ -394,11 +402,32 @@ void open_model_ufbx(entt::registry &registry, std::string filepath) {
           },
       .target_unit_meters = 1.0f,
   };
-  ufbx_scene *scene = ufbx_load_file(filepath.c_str(), &opts, &error);
-  if (!scene) {
+  auto model = std::make_shared<ufbx_model>();
+  model->filepath = filepath;
+  model->scene = ufbx_load_file(filepath.c_str(), &opts, &error);
+  if (!model->scene) {
     spdlog::error("Failed to load: {0}", error.description.data);
-    return;
+    return nullptr;
   }
+  return model;
+}
+
+task<std::shared_ptr<ufbx_model>> read_model_ufbx(std::string filepath) {
+  co_await resume_on_workers();
+  co_return parse_model_ufbx(filepath);
+}
+
+void open_model_ufbx(entt::registry &registry, std::string filepath) {
+  if (auto model = parse_model_ufbx(filepath))
+    build_model_ufbx(registry, *model);
+}
+
+entt::entity build_model_ufbx(entt::registry &registry,
+                              const ufbx_model &model) {
+  PROFILE_SCOPE("build_model_ufbx");
+  memory_scope memory(memory_tag::meshes);
+  auto &filepath = model.filepath;
+  auto scene = model.scene;
 
 // create nodes
 #ifdef _WIN32
@@ -423,8 +452,7 @@ void open_model_ufbx(entt::registry &registry, std::string filepath) {
   for (int i = 0; i < scene->meshes.count; i++) {
     read_mesh(registry, scene->meshes[i], ufbx_node_to_entity, scene, filename);
   }
-
-  ufbx_free_scene(scene);
+  return ufbx_node_to_entity[scene->root_node];
 }
 
 }; // namespace toolkit::assets
@@ -0,0 +1,270 @@
+#include "toolkit/opengl/partition.hpp"
+#include "toolkit/binary_scene.hpp"
+#include "toolkit/jobs.hpp"
+#include "toolkit/opengl/components/camera.hpp"
+#include "toolkit/opengl/components/mesh.hpp"
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <spdlog/spdlog.h>
+
+namespace toolkit::opengl {
+
+static const char *manifest_name = "partition.json";
+
+world_partition::~world_partition() {
+  // the background decoding doesn't touch the registry, just wait for it
+  for (auto &[key, c] : cells)
+    if (c.pending.valid())
+      c.pending.wait();
+}
+
+void world_partition::init0(entt::registry &registry) {
+  app = registry.ctx().get<iapp *>();
+}
+
+world_partition::cell_key
+world_partition::key_of(const math::vector3 &position) const {
+  return {static_cast<int>(std::floor(position.x() / cell_size)),
+          static_cast<int>(std::floor(position.y() / cell_size)),
+          static_cast<int>(std::floor(position.z() / cell_size))};
+}
+
+float world_partition::distance_to(const cell_key &key,
+                                   const math::vector3 &position) const {
+  math::vector3 cell_min(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+  cell_min *= cell_size;
+  math::vector3 cell_max = cell_min + math::vector3::Constant(cell_size);
+  math::vector3 closest = math::max3(cell_min, math::min3(cell_max, position));
+  return (closest - position).norm();
+}
+
+bool world_partition::load_manifest() {
+  manifest_read = true;
+  for (auto &[key, c] : cells)
+    if (c.state != cell_state::unloaded)
+      unload(app->registry, c);
+  cells.clear();
+  auto filepath = join_path(directory, manifest_name);
+  std::ifstream input(filepath);
+  if (!input.is_open())
+    return false;
+  try {
+    auto manifest = nlohmann::json::parse(input);
+    cell_size = manifest["cell_size"].get<float>();
+    for (auto &entry : manifest["cells"]) {
+      auto &c = cells[{entry["key"][0].get<int>(), entry["key"][1].get<int>(),
+                       entry["key"][2].get<int>()}];
+      c.file = entry["file"].get<std::string>();
+      c.entity_count = entry["entities"].get<std::size_t>();
+    }
+  } catch (std::exception &e) {
+    spdlog::error("Failed to parse partition manifest {0}: {1}", filepath,
+                  e.what());
+    cells.clear();
+    return false;
+  }
+  spdlog::info("Load partition manifest {0} with {1} cells", filepath,
+               cells.size());
+  return true;
+}
+
+void world_partition::begin_load(entt::registry &registry, cell &c) {
+  c.entities.resize(c.entity_count);
+  // the entities are created right away so the decoding can remap the
+  // entity references without touching the registry
+  registry.create(c.entities.begin(), c.entities.end());
+  app->transient_entities.insert(c.entities.begin(), c.entities.end());
+  c.state = cell_state::loading;
+  c.pending = job_system::instance().async(
+      [filepath = join_path(directory, c.file),
+       entities = c.entities]() -> cell_commits {
+        PROFILE_SCOPE("world_partition::decode_cell");
+        scene_reader reader;
+        if (!reader.open(filepath) || !reader.is_prefab()) {
+          spdlog::error("Failed to open partition cell {0}", filepath);
+          return {};
+        }
+        auto old_entities = reader.entities();
+        if (old_entities.size() != entities.size()) {
+          spdlog::error("Partition cell {0} has {1} entities, expect {2}",
+                        filepath, old_entities.size(), entities.size());
+          return {};
+        }
+        std::map<entt::entity, entt::entity> remap;
+        for (std::size_t i = 0; i < entities.size(); i++)
+          remap[old_entities[i]] = entities[i];
+        return decode_component_sections(reader, &remap);
+      });
+}
+
+void world_partition::commit(entt::registry &registry, cell &c,
+                             cell_commits &&commits) {
+  PROFILE_SCOPE("world_partition::commit");
+  if (commits.empty()) {
+    // failed to decode, keep the cell unloaded until the manifest is reloaded
+    unload(registry, c);
+    c.entity_count = 0;
+    return;
+  }
+  for (auto &commit : commits)
+    commit(registry);
+  // mesh_data creates its opengl buffers here
+  for (auto entity : c.entities)
+    for (auto &fp : iapp::__comp_init1_funcs__)
+      fp.second(registry, entity);
+  c.state = cell_state::loaded;
+}
+
+void world_partition::unload(entt::registry &registry, cell &c) {
+  PROFILE_SCOPE("world_partition::unload");
+  if (c.pending.valid())
+    c.pending.wait();
+  for (auto entity : c.entities) {
+    app->transient_entities.erase(entity);
+    if (!registry.valid(entity))
+      continue;
+    if (auto mesh = registry.try_get<mesh_data>(entity))
+      free_opengl_buffers(*mesh);
+    registry.destroy(entity);
+  }
+  c.entities.clear();
+  c.state = cell_state::unloaded;
+}
+
+void world_partition::preupdate(entt::registry &registry, float dt) {
+  // init1 only runs when the system is deserialized with a scene
+  if (!manifest_read)
+    load_manifest();
+  int num_commits = 0;
+  for (auto &[key, c] : cells) {
+    if (c.state != cell_state::loading || num_commits >= max_commits_per_frame)
+      continue;
+    if (c.pending.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready) {
+      commit(registry, c, c.pending.get());
+      num_commits++;
+    }
+  }
+
+  if (cells.empty() || !registry.valid(g_instance.active_camera))
+    return;
+  auto focus = registry.get<transform>(g_instance.active_camera).position();
+  for (auto &[key, c] : cells) {
+    float distance = distance_to(key, focus);
+    if (c.state == cell_state::unloaded && c.entity_count > 0 &&
+        distance < load_radius)
+      begin_load(registry, c);
+    else if (c.state == cell_state::loaded && distance > unload_radius)
+      unload(registry, c);
+  }
+}
+
+void world_partition::load_all(entt::registry &registry) {
+  for (auto &[key, c] : cells)
+    if (c.state == cell_state::unloaded && c.entity_count > 0)
+      begin_load(registry, c);
+  for (auto &[key, c] : cells) {
+    if (c.state == cell_state::loading)
+      commit(registry, c, c.pending.get());
+    for (auto entity : c.entities)
+      app->transient_entities.erase(entity);
+  }
+  // the entities belong to the scene now, stop streaming them
+  cells.clear();
+}
+
+bool world_partition::partition(entt::registry &registry) {
+  PROFILE_SCOPE("world_partition::partition");
+  load_all(registry);
+  std::map<cell_key, std::vector<entt::entity>> groups;
+  std::vector<entt::entity> roots;
+  registry.view<entt::entity, transform>().each(
+      [&](entt::entity entity, transform &trans) {
+        if (trans.m_parent == entt::null)
+          roots.push_back(entity);
+      });
+  for (auto root : roots) {
+    auto hierarchy = collect_hierarchy(registry, root);
+    bool has_mesh = false, has_camera = false;
+    for (auto entity : hierarchy) {
+      has_mesh |= registry.all_of<mesh_data>(entity);
+      has_camera |= registry.all_of<camera>(entity);
+    }
+    if (!has_mesh || has_camera)
+      continue;
+    auto &group = groups[key_of(registry.get<transform>(root).position())];
+    group.insert(group.end(), hierarchy.begin(), hierarchy.end());
+  }
+
+  if (!std::filesystem::exists(directory) && !mkdir(directory)) {
+    spdlog::error("Failed to create partition directory {0}", directory);
+    return false;
+  }
+  nlohmann::json manifest;
+  manifest["cell_size"] = cell_size;
+  manifest["cells"] = nlohmann::json::array();
+  std::set<std::string> written;
+  for (auto &[key, group] : groups) {
+    auto [x, y, z] = key;
+    auto file = str_format("cell_%d_%d_%d.prefab", x, y, z);
+    scene_writer writer;
+    writer.set_entities(group);
+    write_component_sections(writer, registry, &group);
+    if (!writer.write(join_path(directory, file), prefab_magic))
+      return false;
+    written.insert(file);
+    manifest["cells"].push_back(
+        {{"key", {x, y, z}}, {"file", file}, {"entities", group.size()}});
+  }
+  std::ofstream output(join_path(directory, manifest_name));
+  if (!output.is_open()) {
+    spdlog::error("Failed to write partition manifest under {0}", directory);
+    return false;
+  }
+  output << manifest.dump(2) << std::endl;
+  output.close();
+  // cells from a previous partition with a different layout
+  std::vector<std::string> stale;
+  listdir(directory, [&](std::string filepath) {
+    auto file = std::filesystem::path(filepath).filename().string();
+    if (file.starts_with("cell_") && endswith(file, ".prefab") &&
+        !written.contains(file))
+      stale.push_back(filepath);
+  });
+  for (auto &filepath : stale)
+    std::filesystem::remove(filepath);
+
+  // the partitioned hierarchies live in the cells from now on
+  for (auto &[key, group] : groups) {
+    for (auto entity : group)
+      if (auto mesh = registry.try_get<mesh_data>(entity))
+        free_opengl_buffers(*mesh);
+    registry.destroy(group.begin(), group.end());
+  }
+  spdlog::info("Partition the scene into {0} cells under {1}", groups.size(),
+               directory);
+  return load_manifest();
+}
+
+void world_partition::draw_menu_gui() {
+  ImGui::DragFloat("Cell Size", &cell_size, 1.0f, 1.0f, 1e4f);
+  ImGui::DragFloat("Load Radius", &load_radius, 1.0f, 0.0f, 1e5f);
+  ImGui::DragFloat("Unload Radius", &unload_radius, 1.0f, 0.0f, 1e5f);
+  ImGui::InputInt("Commits Per Frame", &max_commits_per_frame);
+  int num_loaded = 0;
+  for (auto &[key, c] : cells)
+    num_loaded += c.state == cell_state::loaded ? 1 : 0;
+  ImGui::MenuItem(str_format("Loaded Cells: %d/%d", num_loaded,
+                             static_cast<int>(cells.size()))
+                      .c_str(),
+                  nullptr, nullptr, false);
+  if (ImGui::MenuItem("Partition Scene"))
+    partition(app->registry);
+  if (ImGui::MenuItem("Load All Cells"))
+    load_all(app->registry);
+  if (ImGui::MenuItem("Reload Manifest"))
+    load_manifest();
+}
+
+}; // namespace toolkit::opengl
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "toolkit/opengl/base.hpp"
+#include "toolkit/system.hpp"
+#include "toolkit/transform.hpp"
+#include <future>
+
+namespace toolkit::opengl {
+
+/**
+ * Splits the world into cubic cells of `cell_size` and streams them around the
+ * active camera. `partition` moves every root hierarchy holding a mesh (and no
+ * camera) into the binary prefab of the cell containing its root, the cells
+ * are listed in `partition.json` under `directory`.
+ *
+ * Cells closer than `load_radius` are read and decoded on a background thread
+ * with their own entity mapping, at most `max_commits_per_frame` decoded cells
+ * are added to the registry per frame. Cells further than `unload_radius` get
+ * destroyed together with the opengl buffers of their meshes. Streamed
+ * entities are transient, they are not saved with the scene, so edit the
+ * cells by loading them with `load_all` and partitioning again.
+ */
+class world_partition : public isystem {
+public:
+  static constexpr bool requires_context = true;
+
+  ~world_partition();
+
+  void init0(entt::registry &registry) override;
+  void preupdate(entt::registry &registry, float dt) override;
+  void draw_menu_gui() override;
+  std::string get_name() override { return "World Partition"; }
+
+  /**
+   * Write the streamable hierarchies into cells under `directory` and remove
+   * them from the registry. Returns false if a cell or the manifest can't be
+   * written, the registry is left untouched in that case.
+   */
+  bool partition(entt::registry &registry);
+  /**
+   * Synchronously load every cell, e.g. before partitioning again with a
+   * different cell size. The loaded entities are no longer transient.
+   */
+  void load_all(entt::registry &registry);
+  bool load_manifest();
+
+  std::string directory = "partition";
+  float cell_size = 64.0f;
+  float load_radius = 128.0f, unload_radius = 160.0f;
+  int max_commits_per_frame = 2;
+
+private:
+  using cell_key = std::tuple<int, int, int>;
+  using cell_commits = std::vector<std::function<void(entt::registry &)>>;
+  enum class cell_state { unloaded, loading, loaded };
+  struct cell {
+    std::string file;
+    std::size_t entity_count = 0;
+    cell_state state = cell_state::unloaded;
+    std::vector<entt::entity> entities;
+    std::future<cell_commits> pending;
+  };
+
+  cell_key key_of(const math::vector3 &position) const;
+  float distance_to(const cell_key &key, const math::vector3 &position) const;
+  void begin_load(entt::registry &registry, cell &c);
+  void commit(entt::registry &registry, cell &c, cell_commits &&commits);
+  void unload(entt::registry &registry, cell &c);
+
+  std::map<cell_key, cell> cells;
+  bool manifest_read = false;
+  iapp *app = nullptr;
+};
+DECLARE_SYSTEM(world_partition, directory, cell_size, load_radius,
+               unload_radius, max_commits_per_frame)
+
+}; // namespace toolkit::opengl
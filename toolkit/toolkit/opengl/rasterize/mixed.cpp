@@ -70,7 +70,16 @@ void defered_forward_mixed::draw_menu_gui() {
   }
   ImGui::Text(csm_depth_text.c_str());
   if (csm_modified)
-    resize_csm_buffer();
+    resources.invalidate("csm atlas");
+  ImGui::Separator();
+
+  ImGui::MenuItem("Render Resources", nullptr, nullptr, false);
+  for (auto &stats : resources.snapshot()) {
+    if (stats.created)
+      ImGui::Text("%s: %.2f ms", stats.name.c_str(), stats.last_ms);
+    else
+      ImGui::TextDisabled("%s: not created", stats.name.c_str());
+  }
 }
 
 void defered_forward_mixed::draw_gui(entt::registry &registry,
@@ -94,6 +103,8 @@ void defered_forward_mixed::draw_gui(entt::registry &registry,
 }
 
 void defered_forward_mixed::init0(entt::registry &registry) {
+  // only the names of the objects, the storage and shaders are created by the
+  // passes on their first use
   pos_tex.create(GL_TEXTURE_2D);
   normal_tex.create(GL_TEXTURE_2D);
   gbuffer_depth_tex.create(GL_TEXTURE_2D);
@@ -102,20 +113,6 @@ void defered_forward_mixed::init0(entt::registry &registry) {
   ao_color.create(GL_TEXTURE_2D);
   csm_depth_atlas.create(GL_TEXTURE_2D);
 
-  gbuffer_geometry_pass.compile_shader_from_source(gbuffer_geometry_pass_vs,
-                                                   gbuffer_geometry_pass_fs);
-  defered_phong_pass.compile_shader_from_source(defered_phong_pass_vs,
-                                                defered_phong_pass_fs);
-
-  collect_scene_vertex_buffer_program.create(str_format(
-      collect_scene_vertex_buffer_program_source.c_str(), work_group_size));
-  collect_scene_index_buffer_program.create(str_format(
-      collect_scene_index_buffer_program_source.c_str(), work_group_size));
-  scene_buffer_apply_blendshape_program.create(str_format(
-      scene_buffer_apply_blendshape_program_source.c_str(), work_group_size));
-  scene_buffer_apply_mesh_skinning_program.create(
-      str_format(scene_buffer_apply_mesh_skinning_program_source.c_str(),
-                 work_group_size));
   scene_vertex_buffer.create();
   scene_index_buffer.create();
   scene_vao.create();
@@ -128,109 +125,175 @@ void defered_forward_mixed::init0(entt::registry &registry) {
   ao_buffer.create();
   csm_buffer.create();
   csm_vp_matrix_buffer.create();
-  csm_depth_program.compile_shader_from_source(csm_vs, csm_fs);
-  csm_selection_mask_program.compile_shader_from_source(quad_vs,
-                                                        csm_selection_mask_fs);
 
   light_data_buffer.create();
 
+  declare_resources();
+  // with parallel compilation the driver compiles the shaders of the enabled
+  // passes in the background until their first frame
+  if (context::parallel_shader_compile) {
+    resources.prefetch("scene programs");
+    resources.prefetch("gbuffer shaders");
+    if (enable_sun)
+      resources.prefetch("csm shaders");
+  }
+
   float sun_v_rad = sun_v / 180 * 3.1415927f;
   float sun_h_rad = sun_h / 180 * 3.1415927f;
   math::vector3 sun_dir(cos(sun_v_rad) * cos(sun_h_rad),
                         cos(sun_v_rad) * sin(sun_h_rad), sin(sun_v_rad));
   ss_model.update(sun_dir, sun_turbidity);
 
-  // ---------------- call resize after all initialzation finishes
-  // ----------------
   resize(g_instance.scene_width, g_instance.scene_height);
 
   // initialize materials
   for (auto &initialier : material::__material_constructors__)
     initialier.second(registry);
+
+  mesh_changes.connect(registry);
 }
 
 void defered_forward_mixed::init1(entt::registry &registry) {}
 
-void defered_forward_mixed::resize(int width, int height) {
-  gbuffer.bind();
-  gbuffer.begin_draw_buffers();
-  pos_tex.set_data(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-  pos_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
-                          {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
-                          {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-                          {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  normal_tex.set_data(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-  normal_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+void defered_forward_mixed::declare_resources() {
+  resources.declare(
+      "scene programs",
+      [this]() {
+        collect_scene_vertex_buffer_program.end_compile();
+        collect_scene_index_buffer_program.end_compile();
+        scene_buffer_apply_blendshape_program.end_compile();
+        scene_buffer_apply_mesh_skinning_program.end_compile();
+      },
+      [this]() {
+        collect_scene_vertex_buffer_program.begin_compile(str_format(
+            collect_scene_vertex_buffer_program_source.c_str(),
+            work_group_size));
+        collect_scene_index_buffer_program.begin_compile(str_format(
+            collect_scene_index_buffer_program_source.c_str(),
+            work_group_size));
+        scene_buffer_apply_blendshape_program.begin_compile(str_format(
+            scene_buffer_apply_blendshape_program_source.c_str(),
+            work_group_size));
+        scene_buffer_apply_mesh_skinning_program.begin_compile(str_format(
+            scene_buffer_apply_mesh_skinning_program_source.c_str(),
+            work_group_size));
+      });
+  resources.declare(
+      "gbuffer shaders", [this]() { gbuffer_geometry_pass.end_compile(); },
+      [this]() {
+        gbuffer_geometry_pass.begin_compile(gbuffer_geometry_pass_vs,
+                                            gbuffer_geometry_pass_fs);
+      });
+  resources.declare(
+      "csm shaders", [this]() { csm_depth_program.end_compile(); },
+      [this]() { csm_depth_program.begin_compile(csm_vs, csm_fs); });
+
+  resources.declare("gbuffer targets", [this]() {
+    gbuffer.bind();
+    gbuffer.begin_draw_buffers();
+    pos_tex.set_data(target_width, target_height, GL_RGBA32F, GL_RGBA,
+                     GL_FLOAT);
+    pos_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+                            {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
+                            {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+                            {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
+    normal_tex.set_data(target_width, target_height, GL_RGBA32F, GL_RGBA,
+                        GL_FLOAT);
+    normal_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+                               {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
+                               {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+                               {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
+    mask_tex.set_data(target_width, target_height, GL_RGBA32F, GL_RGBA,
+                      GL_FLOAT);
+    mask_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
                              {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
                              {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
                              {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  mask_tex.set_data(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-  mask_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
-                           {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
-                           {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-                           {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  gbuffer_depth_tex.set_data(width, height, GL_DEPTH_COMPONENT24,
-                             GL_DEPTH_COMPONENT, GL_FLOAT);
-  gbuffer_depth_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
-                                    {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
-                                    {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-                                    {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  gbuffer.attach_color_buffer(pos_tex, GL_COLOR_ATTACHMENT0);
-  gbuffer.attach_color_buffer(normal_tex, GL_COLOR_ATTACHMENT1);
-  gbuffer.attach_color_buffer(mask_tex, GL_COLOR_ATTACHMENT2);
-  gbuffer.end_draw_buffers();
-  gbuffer.attach_depth_buffer(gbuffer_depth_tex);
-  if (!gbuffer.check_status())
-    spdlog::error("gbuffer not complete!");
-  gbuffer.unbind();
+    gbuffer_depth_tex.set_data(target_width, target_height,
+                               GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT,
+                               GL_FLOAT);
+    gbuffer_depth_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+                                      {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
+                                      {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+                                      {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
+    gbuffer.attach_color_buffer(pos_tex, GL_COLOR_ATTACHMENT0);
+    gbuffer.attach_color_buffer(normal_tex, GL_COLOR_ATTACHMENT1);
+    gbuffer.attach_color_buffer(mask_tex, GL_COLOR_ATTACHMENT2);
+    gbuffer.end_draw_buffers();
+    gbuffer.attach_depth_buffer(gbuffer_depth_tex);
+    if (!gbuffer.check_status())
+      spdlog::error("gbuffer not complete!");
+    gbuffer.unbind();
+  });
 
-  cbuffer.bind();
-  cbuffer.begin_draw_buffers();
-  color_tex.set_data(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
-  color_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_LINEAR},
-                            {GL_TEXTURE_MAG_FILTER, GL_LINEAR},
-                            {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-                            {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  cbuffer.attach_color_buffer(color_tex, GL_COLOR_ATTACHMENT0);
-  cbuffer.end_draw_buffers();
-  if (!cbuffer.check_status())
-    spdlog::error("cbuffer not complete!");
-  cbuffer.unbind();
+  resources.declare("color target", [this]() {
+    cbuffer.bind();
+    cbuffer.begin_draw_buffers();
+    color_tex.set_data(target_width, target_height, GL_RGBA8, GL_RGBA,
+                       GL_UNSIGNED_BYTE);
+    color_tex.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_LINEAR},
+                              {GL_TEXTURE_MAG_FILTER, GL_LINEAR},
+                              {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+                              {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
+    cbuffer.attach_color_buffer(color_tex, GL_COLOR_ATTACHMENT0);
+    cbuffer.end_draw_buffers();
+    if (!cbuffer.check_status())
+      spdlog::error("cbuffer not complete!");
+    cbuffer.unbind();
+  });
 
-  ao_buffer.bind();
-  ao_buffer.begin_draw_buffers();
-  ao_color.set_data(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
-  ao_color.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
-                           {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
-                           {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-                           {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
-  ao_buffer.attach_color_buffer(ao_color, GL_COLOR_ATTACHMENT0);
-  ao_buffer.end_draw_buffers();
-  if (!ao_buffer.check_status())
-    spdlog::error("ao buffer not complete!");
-  ao_buffer.unbind();
-
-  msaa_buffer.bind();
-  glGenRenderbuffers(1, &msaa_color_buffer);
-  glBindRenderbuffer(GL_RENDERBUFFER, msaa_color_buffer);
-  glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa_samples, GL_RGB, width,
-                                   height);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                            GL_RENDERBUFFER, msaa_color_buffer);
-
-  glGenRenderbuffers(1, &msaa_depth_buffer);
-  glBindRenderbuffer(GL_RENDERBUFFER, msaa_depth_buffer);
-  glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa_samples,
-                                   GL_DEPTH24_STENCIL8, width, height);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                            GL_RENDERBUFFER, msaa_depth_buffer);
-
-  if (!msaa_buffer.check_status()) {
-    spdlog::error("msaa buffer not complete!");
-  }
-  msaa_buffer.unbind();
+  resources.declare("ao target", [this]() {
+    ao_buffer.bind();
+    ao_buffer.begin_draw_buffers();
+    ao_color.set_data(target_width, target_height, GL_RGBA8, GL_RGBA,
+                      GL_UNSIGNED_BYTE);
+    ao_color.set_parameters({{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+                             {GL_TEXTURE_MAG_FILTER, GL_NEAREST},
+                             {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+                             {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE}});
+    ao_buffer.attach_color_buffer(ao_color, GL_COLOR_ATTACHMENT0);
+    ao_buffer.end_draw_buffers();
+    if (!ao_buffer.check_status())
+      spdlog::error("ao buffer not complete!");
+    ao_buffer.unbind();
+  });
+
+  resources.declare("msaa targets", [this]() {
+    msaa_buffer.bind();
+    // the renderbuffers of the previous size are replaced
+    glDeleteRenderbuffers(1, &msaa_color_buffer);
+    glGenRenderbuffers(1, &msaa_color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, msaa_color_buffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa_samples, GL_RGB,
+                                     target_width, target_height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, msaa_color_buffer);
+
+    glDeleteRenderbuffers(1, &msaa_depth_buffer);
+    glGenRenderbuffers(1, &msaa_depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, msaa_depth_buffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa_samples,
+                                     GL_DEPTH24_STENCIL8, target_width,
+                                     target_height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, msaa_depth_buffer);
+
+    if (!msaa_buffer.check_status()) {
+      spdlog::error("msaa buffer not complete!");
+    }
+    msaa_buffer.unbind();
+  });
 
-  resize_csm_buffer();
+  resources.declare("csm atlas", [this]() { resize_csm_buffer(); });
+}
+
+void defered_forward_mixed::resize(int width, int height) {
+  target_width = width;
+  target_height = height;
+  resources.invalidate("gbuffer targets");
+  resources.invalidate("color target");
+  resources.invalidate("ao target");
+  resources.invalidate("msaa targets");
 }
 
 void defered_forward_mixed::preupdate(entt::registry &registry, float dt) {
@@ -242,24 +305,41 @@ void defered_forward_mixed::preupdate(entt::registry &registry, float dt) {
 }
 
 void defered_forward_mixed::update_scene_buffers(entt::registry &registry) {
+  PROFILE_SCOPE("defered_forward_mixed::update_scene_buffers");
   auto mesh_data_entities = registry.view<entt::entity, transform, mesh_data>();
 
-  bool any_force_update_flag = false;
-  int64_t current_scene_vertex_counter = 0, current_scene_index_counter = 0;
-  mesh_data_entities.each(
-      [&](entt::entity entity, transform &trans, mesh_data &data) {
-        any_force_update_flag |= data.force_update_flag;
-        data.force_update_flag = false;
-        current_scene_vertex_counter += data.vertices.size();
-        current_scene_index_counter += data.indices.size();
-      });
+  // the scene buffers only depend on the mesh_data components, skip the
+  // recount unless one of them got constructed, patched or destroyed
+  bool any_mesh_changed = false, any_force_update_flag = false;
+  mesh_changes.consume([&](entt::entity entity) { any_mesh_changed = true; });
+  // update_buffers doesn't know its entity and can't patch, so the flags are
+  // still scanned, this only touches the mesh_data storage
+  for (auto &data : registry.storage<mesh_data>()) {
+    any_force_update_flag |= data.force_update_flag;
+    data.force_update_flag = false;
+  }
+  bool scene_mesh_mismatch =
+      scene_mesh_counter != mesh_data_entities.size_hint();
+  // a scene without meshes doesn't need the compute programs
+  if (scene_mesh_counter == 0 && !scene_mesh_mismatch)
+    return;
+  resources.require("scene programs");
+  int64_t current_scene_vertex_counter = scene_vertex_counter,
+          current_scene_index_counter = scene_index_counter;
+  if (any_mesh_changed || scene_mesh_mismatch) {
+    current_scene_vertex_counter = 0;
+    current_scene_index_counter = 0;
+    mesh_data_entities.each(
+        [&](entt::entity entity, transform &trans, mesh_data &data) {
+          current_scene_vertex_counter += data.vertices.size();
+          current_scene_index_counter += data.indices.size();
+        });
+  }
 
   bool scene_vtx_count_mismatch =
       (current_scene_vertex_counter != scene_vertex_counter);
   bool scene_idx_count_mismatch =
       (current_scene_index_counter != scene_index_counter);
-  bool scene_mesh_mismatch =
-      scene_mesh_counter != mesh_data_entities.size_hint();
   if (scene_vtx_count_mismatch || scene_idx_count_mismatch ||
       scene_mesh_mismatch || any_force_update_flag) {
     spdlog::info("Detect change in scnene vertex count, scene index count, "
@@ -324,7 +404,7 @@ void defered_forward_mixed::update_scene_buffers(entt::registry &registry) {
   }
 
   // check for blend shapes and skinned meshes
-  std::set<entt::entity> mesh_with_active_bs;
+  std::pmr::set<entt::entity> mesh_with_active_bs(&frame_arena::instance());
   collect_scene_vertex_buffer_program.use();
   mesh_data_entities.each([&](entt::entity entity, transform &trans,
                               mesh_data &data) {
@@ -384,8 +464,8 @@ void defered_forward_mixed::update_scene_buffers(entt::registry &registry) {
         if (bundle.mesh_entities.size() == 0 ||
             bundle.bone_entities.size() == 0)
           return;
-        std::vector<_bone_matrix_block> bone_matrices(
-            bundle.bone_entities.size());
+        std::pmr::vector<_bone_matrix_block> bone_matrices(
+            bundle.bone_entities.size(), &frame_arena::instance());
         for (int i = 0; i < bundle.bone_entities.size(); i++) {
           // mark invalid bones as null entity, we can't remove it since the
           // bone id in each vertex should remain static.
@@ -451,19 +531,41 @@ void defered_forward_mixed::update_scene_buffers(entt::registry &registry) {
   scene_index_buffer.unbind_as(GL_ELEMENT_ARRAY_BUFFER);
 }
 
-void defered_forward_mixed::update_scene_lights(entt::registry &registry) {
+void defered_forward_mixed::extract(entt::registry &registry) {
+  PROFILE_SCOPE("defered_forward_mixed::extract");
+  auto cam_ptr = registry.try_get<camera>(g_instance.active_camera);
+  snapshot.has_camera = cam_ptr != nullptr;
+  if (!cam_ptr)
+    return;
+  // the camera may have moved since the systems updated its matrices
+  compute_vp_matrix(registry, g_instance.active_camera, g_instance.scene_width,
+                    g_instance.scene_height);
+  auto &cam_trans = registry.get<transform>(g_instance.active_camera);
+  auto &cam_comp = *cam_ptr;
+  snapshot.view = cam_comp.view;
+  snapshot.proj = cam_comp.proj;
+  snapshot.vp = cam_comp.vp;
+  snapshot.camera_matrix = cam_trans.matrix();
+  snapshot.camera_position = cam_trans.position();
+  snapshot.camera_forward = cam_trans.local_forward();
+  snapshot.z_near = cam_comp.z_near;
+  snapshot.z_far = cam_comp.z_far;
+  snapshot.fovy_degree = cam_comp.fovy_degree;
+
+  // ---------------- lights ----------------
   float sun_v_rad = sun_v / 180 * 3.1415927f;
   float sun_h_rad = sun_h / 180 * 3.1415927f;
   sun_direction =
       -math::vector3(cos(sun_v_rad) * sin(sun_h_rad), sin(sun_v_rad),
                      cos(sun_v_rad) * cos(sun_h_rad));
-  std::vector<light_data_pacakge> lights;
+  snapshot.sun_direction = sun_direction;
+  snapshot.lights.clear();
   if (enable_sun) {
     light_data_pacakge package;
     package.idata[0] = 0;
     package.color << sun_color, 1.0f;
     package.fdata0 << sun_direction, 0.0f;
-    lights.emplace_back(package);
+    snapshot.lights.emplace_back(package);
   }
   registry.view<point_light, transform>().each(
       [&](entt::entity entity, point_light &light, transform &trans) {
@@ -471,9 +573,49 @@ void defered_forward_mixed::update_scene_lights(entt::registry &registry) {
         package.idata[0] = 1;
         package.pos << trans.position(), 1.0f;
         package.color << light.color, 1.0f;
-        lights.emplace_back(package);
+        snapshot.lights.emplace_back(package);
+      });
+
+  // ---------------- meshes ----------------
+  auto make_item = [&](transform &trans, mesh_data &data) {
+    render_snapshot::draw_item item;
+    item.matrix = trans.matrix();
+    item.bb_min = data.bb_min;
+    item.bb_max = data.bb_max;
+    item.vertex_offset = data.scene_vertex_offset;
+    item.index_offset = data.scene_index_offset;
+    item.index_count = data.indices.size();
+    item.skinned = data.skinned;
+    item.visible = data.skinned || visibility_check(cam_comp.planes,
+                                                    data.bb_min, data.bb_max,
+                                                    item.matrix);
+    return item;
+  };
+  snapshot.draws.clear();
+  registry.view<entt::entity, transform, mesh_data>().each(
+      [&](entt::entity entity, transform &trans, mesh_data &data) {
+        snapshot.draws.push_back(make_item(trans, data));
       });
-  light_data_buffer.set_data_ssbo(lights);
+  for (auto &mat_shader_pair : material::__material_shaders__) {
+    auto &draws = snapshot.materials[mat_shader_pair.first];
+    // assign over the previous frame, the fields keep their allocations
+    std::size_t num_draws = 0;
+    material::__material_view__[mat_shader_pair.first](
+        registry, [&](entt::entity entity, material *mat) {
+          auto mesh_ptr = registry.try_get<mesh_data>(entity);
+          if (!mesh_ptr || !mesh_ptr->should_render_mesh)
+            return;
+          auto item = make_item(registry.get<transform>(entity), *mesh_ptr);
+          if (!item.visible)
+            return;
+          if (num_draws == draws.size())
+            draws.emplace_back();
+          draws[num_draws].item = item;
+          draws[num_draws].fields = mat->material_fields;
+          num_draws++;
+        });
+    draws.resize(num_draws);
+  }
 }
 
 void defered_forward_mixed::resize_csm_buffer() {
@@ -492,23 +634,24 @@ void defered_forward_mixed::resize_csm_buffer() {
   csm_buffer.unbind();
 }
 
-void defered_forward_mixed::render(entt::registry &registry) {
-  if (auto cam_ptr = registry.try_get<camera>(g_instance.active_camera)) {
-    auto &cam_trans = registry.get<transform>(g_instance.active_camera);
-    auto &cam_comp = *cam_ptr;
-
-    update_scene_lights(registry);
-
-    auto trans_mesh_view = registry.view<entt::entity, transform, mesh_data>();
+void defered_forward_mixed::render() {
+  PROFILE_SCOPE("defered_forward_mixed::render");
+  // the editor shows the color target even without a camera
+  resources.require("color target");
+  if (snapshot.has_camera) {
+    light_data_buffer.set_data_ssbo(snapshot.lights);
 
     // ---------------- render csm if sun is enabled ----------------
     if (enable_sun) {
+      PROFILE_SCOPE("csm pass");
+      resources.require("csm atlas");
+      resources.require("csm shaders");
       csm_buffer.bind();
       glClear(GL_DEPTH_BUFFER_BIT);
       glClearColor(0, 0, 0, 1);
-      csm_cascades[0] = cam_comp.z_near;
+      csm_cascades[0] = snapshot.z_near;
       math::vector3 csm_side_dir = math::world_up;
-      if (abs(csm_side_dir.dot(sun_direction)) < 1e-3f)
+      if (abs(csm_side_dir.dot(snapshot.sun_direction)) < 1e-3f)
         csm_side_dir = (csm_side_dir + 0.1f * math::world_forward).normalized();
       csm_depth_program.use();
       scene_vao.bind();
@@ -520,43 +663,45 @@ void defered_forward_mixed::render(entt::registry &registry) {
         // compute depth for view frustom split
         csm_cascades[i + 1] =
             csm_split_lambda *
-                (cam_comp.z_near * pow(cam_comp.z_far / cam_comp.z_near,
+                (snapshot.z_near * pow(snapshot.z_far / snapshot.z_near,
                                        (float)(i + 1) / num_cascades)) +
             (1.0f - csm_split_lambda) *
-                (cam_comp.z_near +
-                 (i + 1) * (cam_comp.z_far - cam_comp.z_near) / num_cascades);
+                (snapshot.z_near +
+                 (i + 1) * (snapshot.z_far - snapshot.z_near) / num_cascades);
         auto [bb_sphere_center, bb_sphere_radius] = frustom_bounding_sphere(
-            csm_cascades[i], csm_cascades[i + 1], cam_comp.fovy_degree,
+            csm_cascades[i], csm_cascades[i + 1], snapshot.fovy_degree,
             g_instance.scene_width, g_instance.scene_height);
         math::vector4 tmp_point;
         tmp_point << bb_sphere_center, 1.0f;
-        tmp_point = cam_trans.matrix() * tmp_point;
+        tmp_point = snapshot.camera_matrix * tmp_point;
         csm_vp_matrix[i] =
             math::ortho(-bb_sphere_radius, bb_sphere_radius, bb_sphere_radius,
                         -bb_sphere_radius, std::min(-bb_sphere_radius, -300.0f),
                         bb_sphere_radius) *
             math::lookat(tmp_point.head<3>(),
-                         tmp_point.head<3>() + sun_direction.normalized(),
+                         tmp_point.head<3>() +
+                             snapshot.sun_direction.normalized(),
                          csm_side_dir);
         update_bounding_planes(csm_frustom_planes, csm_vp_matrix[i]);
         csm_depth_program.set_mat4("gVP", csm_vp_matrix[i]);
-        trans_mesh_view.each([&](entt::entity entity, transform &trans,
-                                 mesh_data &data) {
-          if (!visibility_check(csm_frustom_planes, data.bb_min, data.bb_max,
-                                trans.matrix()))
-            return;
-          csm_depth_program.set_mat4("gModel", data.skinned
+        for (auto &draw : snapshot.draws) {
+          if (!visibility_check(csm_frustom_planes, draw.bb_min, draw.bb_max,
+                                draw.matrix))
+            continue;
+          csm_depth_program.set_mat4("gModel", draw.skinned
                                                    ? math::matrix4::Identity()
-                                                   : trans.matrix());
-          glDrawElements(GL_TRIANGLES, data.indices.size(), GL_UNSIGNED_INT,
-                         (void *)(data.scene_index_offset * sizeof(GLuint)));
-        });
+                                                   : draw.matrix);
+          glDrawElements(GL_TRIANGLES, draw.index_count, GL_UNSIGNED_INT,
+                         (void *)(draw.index_offset * sizeof(GLuint)));
+        }
       }
       scene_vao.unbind();
       csm_buffer.unbind();
     }
 
     // ------------------ render to geometry framebuffer ------------------
+    resources.require("gbuffer targets");
+    resources.require("gbuffer shaders");
     gbuffer.bind();
     gbuffer.set_viewport(0, 0, g_instance.scene_width, g_instance.scene_height);
     glEnable(GL_DEPTH_TEST);
@@ -564,39 +709,40 @@ void defered_forward_mixed::render(entt::registry &registry) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0, 0, 0, 1);
     if (scene_mesh_counter > 0) {
+      PROFILE_SCOPE("geometry pass");
       scene_vao.bind();
       gbuffer_geometry_pass.use();
-      gbuffer_geometry_pass.set_mat4("gVP", cam_comp.vp);
-      gbuffer_geometry_pass.set_mat4("gproj", cam_comp.proj);
-      trans_mesh_view.each([&](entt::entity entity, transform &trans,
-                               mesh_data &data) {
-        if (!data.skinned && !visibility_check(cam_comp.planes, data.bb_min,
-                                               data.bb_max, trans.matrix())) {
-          return; // break if not visible
-        }
-        gbuffer_geometry_pass.set_mat4("gModel", data.skinned
+      gbuffer_geometry_pass.set_mat4("gVP", snapshot.vp);
+      gbuffer_geometry_pass.set_mat4("gproj", snapshot.proj);
+      for (auto &draw : snapshot.draws) {
+        if (!draw.visible)
+          continue;
+        gbuffer_geometry_pass.set_mat4("gModel", draw.skinned
                                                      ? math::matrix4::Identity()
-                                                     : trans.matrix());
-        glDrawElements(GL_TRIANGLES, data.indices.size(), GL_UNSIGNED_INT,
-                       (void *)(data.scene_index_offset * sizeof(GLuint)));
-      });
+                                                     : draw.matrix);
+        glDrawElements(GL_TRIANGLES, draw.index_count, GL_UNSIGNED_INT,
+                       (void *)(draw.index_offset * sizeof(GLuint)));
+      }
       scene_vao.unbind();
     }
     gbuffer.unbind();
 
     // render ao buffer if needed
     if (enable_ao_pass) {
+      PROFILE_SCOPE("ssao pass");
+      resources.require("ao target");
       ao_buffer.bind();
       ao_buffer.set_viewport(0, 0, g_instance.scene_width,
                              g_instance.scene_height);
       glClear(GL_COLOR_BUFFER_BIT);
       glClearColor(0, 0, 0, 1);
-      ssao(pos_tex, normal_tex, mask_tex, cam_comp.view, cam_comp.proj,
+      ssao(pos_tex, normal_tex, mask_tex, snapshot.view, snapshot.proj,
            ssao_noise_scale, ssao_radius);
       ao_buffer.unbind();
     }
 
     // ------------------- render to multisample framebuffer -------------------
+    resources.require("msaa targets");
     msaa_buffer.bind();
     msaa_buffer.set_viewport(0, 0, g_instance.scene_width,
                              g_instance.scene_height);
@@ -604,7 +750,7 @@ void defered_forward_mixed::render(entt::registry &registry) {
     glClearColor(0, 0, 0, 1);
 
     glDisable(GL_DEPTH_TEST);
-    ss_model.render(cam_comp.vp, cam_trans.position());
+    ss_model.render(snapshot.vp, snapshot.camera_position);
     glEnable(GL_DEPTH_TEST);
 
     // iterate through all material types
@@ -615,38 +761,25 @@ void defered_forward_mixed::render(entt::registry &registry) {
       material::__material_instance__[mat_name]->prepare0();
       mat_shader.use();
       // bind common bindings
-      mat_shader.set_mat4("gViewMat", cam_comp.view);
-      mat_shader.set_mat4("gProjMat", cam_comp.proj);
-      mat_shader.set_vec3("gViewDir", -cam_trans.local_forward());
+      mat_shader.set_mat4("gViewMat", snapshot.view);
+      mat_shader.set_mat4("gProjMat", snapshot.proj);
+      mat_shader.set_vec3("gViewDir", -snapshot.camera_forward);
       mat_shader.set_vec2("gViewport", g_instance.get_scene_size());
       mat_shader.set_buffer_ssbo(light_data_buffer, 0);
       ss_model.setup_uniforms(mat_shader);
-      material::__material_view__[mat_name](registry, [&](entt::entity entity,
-                                                          material *mat) {
-        if (auto mesh_ptr = registry.try_get<mesh_data>(entity)) {
-          if (mesh_ptr->should_render_mesh) {
-            auto &trans = registry.get<transform>(entity);
-            if (!mesh_ptr->skinned &&
-                !visibility_check(cam_comp.planes, mesh_ptr->bb_min,
-                                  mesh_ptr->bb_max, trans.matrix())) {
-              return;
-            }
-            mat_shader.set_int("gVertexOffset", mesh_ptr->scene_vertex_offset);
-            mat_shader.set_mat4("gModelToWorldPoint",
-                                mesh_ptr->skinned ? math::matrix4::Identity()
-                                                  : trans.matrix());
-            mat_shader.set_mat3(
-                "gModelToWorldDir",
-                mesh_ptr->skinned
-                    ? (math::matrix3)(math::matrix3::Identity())
-                    : (math::matrix3)(trans.matrix().block<3, 3>(0, 0)));
-            mat->bind_uniforms(mat_shader);
-            glDrawElements(
-                GL_TRIANGLES, mesh_ptr->indices.size(), GL_UNSIGNED_INT,
-                (void *)(mesh_ptr->scene_index_offset * sizeof(GLuint)));
-          }
-        }
-      });
+      for (auto &[item, fields] : snapshot.materials[mat_name]) {
+        mat_shader.set_int("gVertexOffset", item.vertex_offset);
+        mat_shader.set_mat4("gModelToWorldPoint",
+                            item.skinned ? math::matrix4::Identity()
+                                         : item.matrix);
+        mat_shader.set_mat3(
+            "gModelToWorldDir",
+            item.skinned ? (math::matrix3)(math::matrix3::Identity())
+                         : (math::matrix3)(item.matrix.block<3, 3>(0, 0)));
+        bind_material_fields(mat_shader, fields);
+        glDrawElements(GL_TRIANGLES, item.index_count, GL_UNSIGNED_INT,
+                       (void *)(item.index_offset * sizeof(GLuint)));
+      }
       material::__material_instance__[mat_name]->prepare1();
     }
     scene_vao.unbind();
@@ -658,22 +791,11 @@ void defered_forward_mixed::render(entt::registry &registry) {
       glEnable(GL_BLEND);
       glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
       glBlendEquation(GL_FUNC_ADD);
-      draw_infinite_grid(cam_comp.view, cam_comp.proj, cam_comp.z_near,
-                         cam_comp.z_far, grid_spacing);
+      draw_infinite_grid(snapshot.view, snapshot.proj, snapshot.z_near,
+                         snapshot.z_far, grid_spacing);
       glDisable(GL_BLEND);
     }
 
-    // render debug ui from scripts
-    if (should_draw_debug) {
-      glDisable(GL_DEPTH_TEST);
-      // debug rendering
-      if (auto app_ptr = registry.ctx().get<iapp *>()) {
-        auto script_sys = app_ptr->get_sys<script_system>();
-        script_sys->draw_to_scene(app_ptr);
-      }
-      glEnable(GL_DEPTH_TEST);
-    }
-
     // ------------------- apply post processing -------------------
     glEnable(GL_BLEND);
 
@@ -763,4 +885,20 @@ void defered_forward_mixed::render(entt::registry &registry) {
   }
 }
 
+
+void defered_forward_mixed::render_debug(entt::registry &registry) {
+  if (!should_draw_debug || !snapshot.has_camera)
+    return;
+  PROFILE_SCOPE("defered_forward_mixed::render_debug");
+  cbuffer.bind();
+  cbuffer.set_viewport(0, 0, g_instance.scene_width, g_instance.scene_height);
+  glDisable(GL_DEPTH_TEST);
+  if (auto app_ptr = registry.ctx().get<iapp *>()) {
+    auto script_sys = app_ptr->get_sys<script_system>();
+    script_sys->draw_to_scene(app_ptr);
+  }
+  glEnable(GL_DEPTH_TEST);
+  cbuffer.unbind();
+}
+
 }; // namespace toolkit::opengl
\ No newline at end of file
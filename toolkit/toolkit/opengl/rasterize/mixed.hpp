@@ -6,6 +6,7 @@
 
 #include "toolkit/opengl/components/camera.hpp"
 #include "toolkit/opengl/components/lights.hpp"
+#include "toolkit/opengl/components/material.hpp"
 #include "toolkit/opengl/components/mesh.hpp"
 
 #include "toolkit/opengl/effects/sky.hpp"
@@ -23,18 +24,66 @@ struct light_data_pacakge {
   math::vector4 fdata1;
 };
 
+/**
+ * Everything `defered_forward_mixed::render` reads from the registry, copied
+ * by `extract` so the draw calls don't touch the registry, e.g. the scene is
+ * redrawn after a resize without extracting again.
+ */
+struct render_snapshot {
+  struct draw_item {
+    math::matrix4 matrix;
+    math::vector3 bb_min, bb_max;
+    int64_t vertex_offset, index_offset;
+    std::size_t index_count;
+    // skinned meshes are stored in world space in the scene buffer
+    bool skinned;
+    // inside the view frustom of the camera
+    bool visible;
+  };
+  struct material_draw {
+    draw_item item;
+    std::vector<material_field> fields;
+  };
+
+  // false if there's no active camera, nothing gets rendered
+  bool has_camera = false;
+  math::matrix4 view, proj, vp, camera_matrix;
+  math::vector3 camera_position, camera_forward;
+  float z_near, z_far, fovy_degree;
+
+  math::vector3 sun_direction;
+  std::vector<light_data_pacakge> lights;
+  // all meshes, used by the shadow and geometry passes
+  std::vector<draw_item> draws;
+  // visible meshes to shade, grouped by material type
+  std::map<std::string, std::vector<material_draw>> materials;
+};
+
 class defered_forward_mixed : public isystem {
 public:
+  static constexpr bool requires_context = true;
+
   void init0(entt::registry &registry) override;
   void init1(entt::registry &registry) override;
 
+  // the render targets are allocated with the new size on their next use
   void resize(int width, int height);
 
   void preupdate(entt::registry &registry, float dt) override;
-  void render(entt::registry &registry);
+  void declare_access(system_access &access) override {
+    access.read<transform>().write<camera>();
+  }
+  /**
+   * Copy the camera, lights and meshes of the registry into the snapshot
+   * consumed by `render`, call it on the main thread while no system runs.
+   */
+  void extract(entt::registry &registry);
+  // draw the last extracted snapshot, it doesn't touch the registry
+  void render();
+  // draw the debug shapes of the scripts over the rendered scene
+  void render_debug(entt::registry &registry);
 
   void update_scene_buffers(entt::registry &registry);
-  void update_scene_lights(entt::registry &registry);
 
   texture get_target_texture() const { return color_tex; }
 
@@ -62,10 +111,18 @@ public:
   preetham_sun_sky ss_model;
 
 protected:
+  /**
+   * Shaders and render targets of the passes, created by the first frame
+   * running the pass. `draw_menu_gui` shows how long each one took.
+   */
+  lazy_resources resources;
+  void declare_resources();
+  int target_width = 0, target_height = 0;
+
   framebuffer gbuffer, cbuffer, msaa_buffer;
   shader gbuffer_geometry_pass, defered_phong_pass;
   texture pos_tex, normal_tex, gbuffer_depth_tex, mask_tex;
-  unsigned int msaa_color_buffer, msaa_depth_buffer;
+  unsigned int msaa_color_buffer = 0, msaa_depth_buffer = 0;
 
   framebuffer ao_buffer;
   texture ao_color;
@@ -99,7 +156,11 @@ protected:
 
   buffer skeleton_matrices_buffer;
 
+  render_snapshot snapshot;
+
   int64_t scene_vertex_counter = 0, scene_index_counter = 0;
+  // mesh_data components changed since the last update_scene_buffers
+  change_observer<mesh_data> mesh_changes;
 
   std::map<entt::entity, bool> main_cam_visible_cache;
 
@@ -0,0 +1,220 @@
+#include "toolkit/opengl/resources.hpp"
+#include "toolkit/profiler.hpp"
+#include <spdlog/spdlog.h>
+
+namespace toolkit::opengl {
+
+const char *gpu_resource_type_name(gpu_resource_type type) {
+  switch (type) {
+  case gpu_resource_type::buffer:
+    return "buffers";
+  case gpu_resource_type::vertex_array:
+    return "vertex arrays";
+  case gpu_resource_type::texture:
+    return "textures";
+  case gpu_resource_type::framebuffer:
+    return "framebuffers";
+  default:
+    return "unknown";
+  }
+}
+
+class opengl_backend : public gpu_backend {
+public:
+  GLuint create(gpu_resource_type type) override {
+    GLuint id = 0;
+    switch (type) {
+    case gpu_resource_type::buffer:
+      glGenBuffers(1, &id);
+      break;
+    case gpu_resource_type::vertex_array:
+      glGenVertexArrays(1, &id);
+      break;
+    case gpu_resource_type::texture:
+      glGenTextures(1, &id);
+      break;
+    case gpu_resource_type::framebuffer:
+      glGenFramebuffers(1, &id);
+      break;
+    default:
+      break;
+    }
+    return id;
+  }
+  void destroy(gpu_resource_type type, GLuint id) override {
+    switch (type) {
+    case gpu_resource_type::buffer:
+      glDeleteBuffers(1, &id);
+      break;
+    case gpu_resource_type::vertex_array:
+      glDeleteVertexArrays(1, &id);
+      break;
+    case gpu_resource_type::texture:
+      glDeleteTextures(1, &id);
+      break;
+    case gpu_resource_type::framebuffer:
+      glDeleteFramebuffers(1, &id);
+      break;
+    default:
+      break;
+    }
+  }
+};
+
+void gpu_handle::set_size(std::size_t bytes) {
+  if (!resource)
+    return;
+  auto &instance = gpu_resources::instance();
+  instance.bytes[(int)resource->type] +=
+      (std::int64_t)bytes - (std::int64_t)resource->size;
+  resource->size = bytes;
+}
+
+gpu_resources::gpu_resources() : backend(std::make_unique<opengl_backend>()) {}
+
+gpu_resources &gpu_resources::instance() {
+  // never destroyed, static handles may let go of their objects at exit
+  static auto resources = new gpu_resources();
+  return *resources;
+}
+
+gpu_handle gpu_resources::create(gpu_resource_type type) {
+  auto resource = new gpu_resource{type, backend->create(type)};
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    live.insert(resource);
+  }
+  gpu_handle handle;
+  handle.resource = std::shared_ptr<gpu_resource>(
+      resource, [this](gpu_resource *r) { release(r); });
+  return handle;
+}
+
+void gpu_resources::release(gpu_resource *resource) {
+  std::unique_lock<std::mutex> lock(mtx);
+  if (!active) {
+    // the context is gone, so is the object
+    delete resource;
+    return;
+  }
+  resource->released_frame = frame;
+  released.push_back(resource);
+}
+
+void gpu_resources::collect() {
+  std::vector<gpu_resource *> expired;
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    frame++;
+    std::erase_if(released, [&](gpu_resource *resource) {
+      if (resource->released_frame + frames_in_flight > frame)
+        return false;
+      expired.push_back(resource);
+      live.erase(resource);
+      return true;
+    });
+  }
+  // delete on the calling thread, which owns the context
+  for (auto resource : expired) {
+    backend->destroy(resource->type, resource->id);
+    bytes[(int)resource->type] -= resource->size;
+    delete resource;
+  }
+}
+
+void gpu_resources::shutdown() {
+  std::unique_lock<std::mutex> lock(mtx);
+  for (auto resource : live) {
+    backend->destroy(resource->type, resource->id);
+    bytes[(int)resource->type] -= resource->size;
+  }
+  for (auto resource : released)
+    delete resource;
+  live.clear();
+  released.clear();
+  active = false;
+}
+
+void gpu_resources::set_backend(std::unique_ptr<gpu_backend> &&new_backend) {
+  backend = std::move(new_backend);
+}
+
+gpu_memory_stats gpu_resources::stats(gpu_resource_type type) {
+  std::unique_lock<std::mutex> lock(mtx);
+  gpu_memory_stats result{type, 0, bytes[(int)type].load(), 0};
+  for (auto resource : live)
+    result.count += resource->type == type;
+  for (auto resource : released)
+    result.pending += resource->type == type;
+  return result;
+}
+
+std::vector<gpu_memory_stats> gpu_resources::snapshot() {
+  std::vector<gpu_memory_stats> result;
+  for (int i = 0; i < (int)gpu_resource_type::count; i++)
+    result.push_back(stats((gpu_resource_type)i));
+  return result;
+}
+
+void lazy_resources::declare(const std::string &name,
+                             std::function<void()> &&create,
+                             std::function<void()> &&prepare) {
+  auto &e = entries[name];
+  e.create = std::move(create);
+  e.prepare = std::move(prepare);
+}
+
+bool lazy_resources::require(const std::string &name) {
+  auto it = entries.find(name);
+  if (it == entries.end()) {
+    spdlog::error("Render resource {0} is not declared", name);
+    return false;
+  }
+  auto &e = it->second;
+  if (e.created)
+    return true;
+  // a prefetch already spent some of the time
+  float prefetch_ms = e.prepared ? e.last_ms : 0.0f;
+  auto start = profiler::now_ns();
+  if (e.prepare && !e.prepared)
+    e.prepare();
+  e.create();
+  // the next creation prepares again
+  e.prepared = false;
+  e.created = true;
+  e.creations++;
+  e.last_ms = prefetch_ms + (profiler::now_ns() - start) * 1e-6f;
+  spdlog::info("Created render resource {0} in {1:.2f} ms", name, e.last_ms);
+  return true;
+}
+
+void lazy_resources::prefetch(const std::string &name) {
+  auto it = entries.find(name);
+  if (it == entries.end() || !it->second.prepare || it->second.prepared ||
+      it->second.created)
+    return;
+  auto start = profiler::now_ns();
+  it->second.prepare();
+  it->second.prepared = true;
+  it->second.last_ms = (profiler::now_ns() - start) * 1e-6f;
+}
+
+void lazy_resources::invalidate(const std::string &name) {
+  auto it = entries.find(name);
+  if (it != entries.end())
+    it->second.created = false;
+}
+
+bool lazy_resources::is_created(const std::string &name) const {
+  auto it = entries.find(name);
+  return it != entries.end() && it->second.created;
+}
+
+std::vector<lazy_resource_stats> lazy_resources::snapshot() const {
+  std::vector<lazy_resource_stats> result;
+  for (auto &[name, e] : entries)
+    result.push_back({name, e.created, e.creations, e.last_ms});
+  return result;
+}
+
+}; // namespace toolkit::opengl
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace toolkit::opengl {
+
+enum class gpu_resource_type : std::uint8_t {
+  buffer,
+  vertex_array,
+  texture,
+  framebuffer,
+  count
+};
+const char *gpu_resource_type_name(gpu_resource_type type);
+
+/**
+ * Creates and deletes the opengl objects, `gpu_resources` goes through it so
+ * the resource management can be tested without a context.
+ */
+class gpu_backend {
+public:
+  virtual ~gpu_backend() {}
+  virtual GLuint create(gpu_resource_type type) = 0;
+  virtual void destroy(gpu_resource_type type, GLuint id) = 0;
+};
+
+struct gpu_resource {
+  gpu_resource_type type;
+  GLuint id;
+  // bytes of video memory recorded by `gpu_handle::set_size`
+  std::size_t size = 0;
+  // frame in which the last handle let go of it
+  std::uint64_t released_frame = 0;
+};
+
+/**
+ * Reference counted opengl object, copies share the object. Once the last
+ * copy is gone the object is queued for deletion by `gpu_resources`.
+ */
+class gpu_handle {
+public:
+  gpu_handle() {}
+
+  GLuint id() const { return resource ? resource->id : 0; }
+  // gpu_resource_type::count for an empty handle
+  gpu_resource_type type() const {
+    return resource ? resource->type : gpu_resource_type::count;
+  }
+  std::size_t size() const { return resource ? resource->size : 0; }
+  explicit operator bool() const { return resource != nullptr; }
+  long use_count() const { return resource.use_count(); }
+
+  // record the video memory allocated for the object
+  void set_size(std::size_t bytes);
+  void reset() { resource.reset(); }
+
+private:
+  friend class gpu_resources;
+  std::shared_ptr<gpu_resource> resource;
+};
+
+struct gpu_memory_stats {
+  gpu_resource_type type;
+  // live objects and their recorded bytes, including the queued ones
+  std::int64_t count, bytes;
+  // objects waiting for deletion
+  std::int64_t pending;
+};
+
+/**
+ * Owner of the opengl objects created through `gpu_handle`. Released objects
+ * are deleted by `collect` `frames_in_flight` frames later, so the frames
+ * still being drawn by the driver can use them. The main loop calls
+ * `collect` once per frame, `shutdown` deletes everything before the context
+ * is destroyed.
+ */
+class gpu_resources {
+public:
+  static gpu_resources &instance();
+
+  gpu_handle create(gpu_resource_type type);
+
+  void collect();
+  void shutdown();
+
+  // replace the backend, e.g. with a mock in tests
+  void set_backend(std::unique_ptr<gpu_backend> &&new_backend);
+
+  gpu_memory_stats stats(gpu_resource_type type);
+  std::vector<gpu_memory_stats> snapshot();
+
+  int frames_in_flight = 2;
+
+private:
+  friend class gpu_handle;
+  gpu_resources();
+  void release(gpu_resource *resource);
+
+  std::unique_ptr<gpu_backend> backend;
+  std::mutex mtx;
+  std::uint64_t frame = 0;
+  bool active = true;
+  std::unordered_set<gpu_resource *> live;
+  std::vector<gpu_resource *> released;
+  std::atomic<std::int64_t> bytes[(int)gpu_resource_type::count] = {};
+};
+
+struct lazy_resource_stats {
+  std::string name;
+  bool created;
+  // times the resource got created and the milliseconds spent on the last one
+  int creations;
+  float last_ms;
+};
+
+/**
+ * Resources of the render passes created the first time a pass needs them
+ * rather than at startup, so a tool that never runs a pass doesn't pay for
+ * its shaders and targets. A pass declares each resource with the function
+ * creating it and calls `require` before drawing. `invalidate` makes the
+ * next `require` create it again, after a resize for example.
+ *
+ * The optional `prepare` step starts the work that can run in the
+ * background, like compiling shaders on the driver threads, `prefetch` runs
+ * it ahead of the first use. Only use it on the thread owning the context.
+ */
+class lazy_resources {
+public:
+  void declare(const std::string &name, std::function<void()> &&create,
+               std::function<void()> &&prepare = {});
+  // create the resource unless it exists, returns false for unknown names
+  bool require(const std::string &name);
+  void prefetch(const std::string &name);
+  void invalidate(const std::string &name);
+  bool is_created(const std::string &name) const;
+
+  std::vector<lazy_resource_stats> snapshot() const;
+
+private:
+  struct entry {
+    std::function<void()> create, prepare;
+    bool prepared = false, created = false;
+    int creations = 0;
+    // milliseconds spent in `prepare` and `create` for the last creation
+    float last_ms = 0.0f;
+  };
+  std::map<std::string, entry> entries;
+};
+
+}; // namespace toolkit::opengl
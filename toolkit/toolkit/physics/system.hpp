@@ -5,7 +5,10 @@
 
 namespace toolkit::physics {
 
-class physics_system : public isystem {};
+class physics_system : public isystem {
+public:
+  void declare_access(system_access &access) override { access.none(); }
+};
 DECLARE_SYSTEM(physics_system)
 
 }; // namespace toolkit::physics
@@ -0,0 +1,151 @@
+#include "toolkit/profiler.hpp"
+#include <chrono>
+#include <fstream>
+#include <json.hpp>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_set>
+
+namespace toolkit {
+
+void profiler_ring::collect(std::uint64_t since_ns,
+                            std::vector<profiler_zone> &out) const {
+  auto h = head.load(std::memory_order_acquire);
+  auto begin = h > capacity ? h - capacity : 0;
+  auto offset = out.size();
+  for (auto i = begin; i < h; i++)
+    out.push_back(records[i & (capacity - 1)]);
+  // the slot after head may be in the middle of being overwritten as well
+  auto h2 = head.load(std::memory_order_acquire);
+  auto valid = h2 + 1 > capacity ? h2 + 1 - capacity : 0;
+  std::size_t dst = offset;
+  for (auto i = begin; i < h; i++) {
+    auto &zone = out[offset + (i - begin)];
+    if (i >= valid && zone.end_ns >= since_ns)
+      out[dst++] = zone;
+  }
+  out.resize(dst);
+}
+
+static std::mutex rings_mtx;
+static std::vector<std::shared_ptr<profiler_ring>> all_rings;
+
+// frame markers are only written by the main thread
+static std::array<std::uint64_t, profiler::frame_capacity> frame_starts;
+static std::atomic<std::uint64_t> frame_head{0};
+
+std::uint64_t profiler::now_ns() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void profiler::new_frame() {
+  auto h = frame_head.load(std::memory_order_relaxed);
+  frame_starts[h % frame_capacity] = now_ns();
+  frame_head.store(h + 1, std::memory_order_release);
+}
+
+std::vector<std::uint64_t> profiler::frames() {
+  auto h = frame_head.load(std::memory_order_acquire);
+  auto begin = h > frame_capacity ? h - frame_capacity : 0;
+  std::vector<std::uint64_t> result;
+  for (auto i = begin; i < h; i++)
+    result.push_back(frame_starts[i % frame_capacity]);
+  return result;
+}
+
+profiler_ring &profiler::thread_ring() {
+  // rings are kept by the registry after their thread exits, a new thread
+  // takes over a released ring so short lived threads don't pile up rings
+  struct ring_owner {
+    std::shared_ptr<profiler_ring> ring;
+    ring_owner() {
+      std::unique_lock<std::mutex> lock(rings_mtx);
+      for (auto &r : all_rings)
+        if (!r->in_use) {
+          ring = r;
+          break;
+        }
+      if (ring == nullptr) {
+        ring = std::make_shared<profiler_ring>(all_rings.size());
+        all_rings.push_back(ring);
+      }
+      ring->in_use = true;
+      ring->thread_name = "thread " + std::to_string(ring->thread_id);
+    }
+    ~ring_owner() {
+      std::unique_lock<std::mutex> lock(rings_mtx);
+      ring->in_use = false;
+    }
+  };
+  thread_local ring_owner owner;
+  return *owner.ring;
+}
+
+std::vector<std::shared_ptr<profiler_ring>> profiler::rings() {
+  std::unique_lock<std::mutex> lock(rings_mtx);
+  return all_rings;
+}
+
+void profiler::set_thread_name(const std::string &name) {
+  auto &ring = thread_ring();
+  std::unique_lock<std::mutex> lock(rings_mtx);
+  ring.thread_name = name;
+}
+
+std::string profiler::thread_name(const profiler_ring &ring) {
+  std::unique_lock<std::mutex> lock(rings_mtx);
+  return ring.thread_name;
+}
+
+const char *profiler::intern(const std::string &name) {
+  static std::mutex mtx;
+  static std::unordered_set<std::string> names;
+  std::unique_lock<std::mutex> lock(mtx);
+  return names.insert(name).first->c_str();
+}
+
+bool profiler::export_chrome_trace(const std::string &filepath) {
+  std::ofstream output(filepath);
+  if (!output.is_open()) {
+    spdlog::error("Failed to open {0} for trace export", filepath);
+    return false;
+  }
+  nlohmann::json events = nlohmann::json::array();
+  std::vector<profiler_zone> zones;
+  for (auto &ring : rings()) {
+    events.push_back({{"name", "thread_name"},
+                      {"ph", "M"},
+                      {"pid", 0},
+                      {"tid", ring->thread_id},
+                      {"args", {{"name", thread_name(*ring)}}}});
+    zones.clear();
+    ring->collect(0, zones);
+    for (auto &zone : zones) {
+      // chrome trace timestamps are in microseconds
+      events.push_back({{"name", zone.name},
+                        {"cat", "cpu"},
+                        {"ph", "X"},
+                        {"pid", 0},
+                        {"tid", ring->thread_id},
+                        {"ts", zone.start_ns / 1000.0},
+                        {"dur", (zone.end_ns - zone.start_ns) / 1000.0}});
+    }
+  }
+  for (auto frame : frames())
+    events.push_back({{"name", "frame"},
+                      {"ph", "i"},
+                      {"s", "g"},
+                      {"pid", 0},
+                      {"tid", 0},
+                      {"ts", frame / 1000.0}});
+  nlohmann::json trace;
+  trace["traceEvents"] = std::move(events);
+  trace["displayTimeUnit"] = "ms";
+  output << trace.dump();
+  return true;
+}
+
+}; // namespace toolkit
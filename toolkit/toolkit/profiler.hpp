@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace toolkit {
+
+/**
+ * One finished zone, `name` must outlive the profiler. String literals,
+ * `__func__` and names returned by `profiler::intern` are fine.
+ */
+struct profiler_zone {
+  const char *name;
+  std::uint64_t start_ns, end_ns;
+  std::uint32_t depth;
+};
+
+/**
+ * Zones recorded by a single thread. Only the owning thread writes, readers
+ * copy the recent records without taking a lock. Once the ring is full the
+ * oldest records get overwritten.
+ */
+class profiler_ring {
+public:
+  static constexpr std::size_t capacity = 1 << 14;
+
+  profiler_ring(std::uint32_t thread_id) : thread_id(thread_id) {}
+
+  void push(const profiler_zone &zone) {
+    auto h = head.load(std::memory_order_relaxed);
+    records[h & (capacity - 1)] = zone;
+    head.store(h + 1, std::memory_order_release);
+  }
+  /**
+   * Append the zones ending after `since_ns` to `out`, records overwritten
+   * during the copy are dropped.
+   */
+  void collect(std::uint64_t since_ns, std::vector<profiler_zone> &out) const;
+
+  const std::uint32_t thread_id;
+  // nesting depth of the currently open zones, owning thread only
+  std::uint32_t depth = 0;
+
+private:
+  friend class profiler;
+  // guarded by the registry lock of `profiler`
+  std::string thread_name;
+  bool in_use = false;
+  std::array<profiler_zone, capacity> records;
+  std::atomic<std::uint64_t> head{0};
+};
+
+/**
+ * Low overhead cpu profiler, use `PROFILE_SCOPE` and `PROFILE_FUNCTION` to
+ * record zones. Define `TOOLKIT_DISABLE_PROFILER` to compile the zones out.
+ */
+class profiler {
+public:
+  static constexpr std::size_t frame_capacity = 512;
+
+  static std::uint64_t now_ns();
+
+  /**
+   * Mark the start of a new frame, call this once per main loop iteration.
+   */
+  static void new_frame();
+  /**
+   * Start timestamps of the recent frames, the oldest first.
+   */
+  static std::vector<std::uint64_t> frames();
+
+  static void set_thread_name(const std::string &name);
+  static std::string thread_name(const profiler_ring &ring);
+  /**
+   * Returns a pointer to a copy of `name` which lives as long as the
+   * program, equal names give the same pointer.
+   */
+  static const char *intern(const std::string &name);
+
+  static profiler_ring &thread_ring();
+  static std::vector<std::shared_ptr<profiler_ring>> rings();
+
+  /**
+   * Write the recorded zones and frame markers as chrome trace json, the file
+   * can be opened with chrome://tracing or https://ui.perfetto.dev.
+   */
+  static bool export_chrome_trace(const std::string &filepath);
+
+  static inline std::atomic<bool> enabled{true};
+};
+
+class profiler_scope {
+public:
+  profiler_scope(const char *name) : name(name) {
+    if (!profiler::enabled.load(std::memory_order_relaxed))
+      return;
+    ring = &profiler::thread_ring();
+    depth = ring->depth++;
+    start_ns = profiler::now_ns();
+  }
+  ~profiler_scope() {
+    if (ring == nullptr)
+      return;
+    ring->depth--;
+    ring->push(profiler_zone{name, start_ns, profiler::now_ns(), depth});
+  }
+
+  profiler_scope(const profiler_scope &) = delete;
+  profiler_scope &operator=(const profiler_scope &) = delete;
+
+private:
+  const char *name;
+  profiler_ring *ring = nullptr;
+  std::uint64_t start_ns = 0;
+  std::uint32_t depth = 0;
+};
+
+}; // namespace toolkit
+
+#define __PROFILE_CONCAT_IMPL__(a, b) a##b
+#define __PROFILE_CONCAT__(a, b) __PROFILE_CONCAT_IMPL__(a, b)
+
+#ifndef TOOLKIT_DISABLE_PROFILER
+#define PROFILE_SCOPE(name)                                                    \
+  toolkit::profiler_scope __PROFILE_CONCAT__(__profiler_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
@@ -0,0 +1,382 @@
+#include "toolkit/recorder.hpp"
+#include "toolkit/intern.hpp"
+#include <limits>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+// position, rotation and scale occupy these ranges of the quantized values
+static constexpr int group_begin[3] = {0, 3, 7}, group_end[3] = {3, 7, 10};
+
+static void write_varint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+static void write_signed(std::vector<std::uint8_t> &out, std::int64_t value) {
+  write_varint(out, (static_cast<std::uint64_t>(value) << 1) ^
+                        static_cast<std::uint64_t>(value >> 63));
+}
+
+struct frame_reader {
+  const std::uint8_t *ptr;
+
+  std::uint64_t varint() {
+    std::uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      auto byte = *ptr++;
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        return value;
+    }
+  }
+  std::int64_t signed_varint() {
+    auto value = varint();
+    return static_cast<std::int64_t>(value >> 1) ^
+           -static_cast<std::int64_t>(value & 1);
+  }
+};
+
+void frame_recorder::init0(entt::registry &registry) {
+  app = registry.ctx().get<iapp *>();
+}
+
+void frame_recorder::lateupdate(entt::registry &registry, float dt) {
+  if (scrubbing)
+    restore(registry, scrub_frame);
+  else if (recording)
+    capture(registry, dt);
+}
+
+// values past the int32 range (about 214 km at the default precision) are
+// clamped, `clamped` is set if that happened
+static std::int32_t quantize_value(float value, float precision,
+                                   bool &clamped) {
+  constexpr double limit = std::numeric_limits<std::int32_t>::max();
+  double scaled = std::round(static_cast<double>(value) / precision);
+  if (!(std::abs(scaled) <= limit)) {
+    clamped = true;
+    scaled = std::isnan(scaled) ? 0.0 : std::clamp(scaled, -limit, limit);
+  }
+  return static_cast<std::int32_t>(scaled);
+}
+
+frame_recorder::quantized_transform
+frame_recorder::quantize(const transform &trans, bool &clamped) const {
+  quantized_transform q;
+  auto pos = trans.local_position(), scale = trans.local_scale();
+  auto rot = trans.local_rotation().normalized();
+  // q and -q are the same rotation, keep w positive so the deltas stay small
+  if (rot.w() < 0.0f)
+    rot.coeffs() *= -1.0f;
+  float rot_scale = static_cast<float>((1 << (rotation_bits - 1)) - 1);
+  for (int i = 0; i < 3; i++) {
+    q.values[i] = quantize_value(pos[i], position_precision, clamped);
+    q.values[7 + i] = quantize_value(scale[i], position_precision, clamped);
+  }
+  for (int i = 0; i < 4; i++)
+    q.values[3 + i] =
+        static_cast<std::int32_t>(std::lround(rot.coeffs()[i] * rot_scale));
+  return q;
+}
+
+void frame_recorder::capture(entt::registry &registry, float dt) {
+  PROFILE_SCOPE("frame_recorder::capture");
+  rotation_bits = std::clamp(rotation_bits, 4, 16);
+  position_precision = std::max(position_precision, 1e-7f);
+  keyframe_interval = std::max(keyframe_interval, 1);
+  // the buffer can't mix quantizations
+  if (position_precision != recorded_position_precision ||
+      rotation_bits != recorded_rotation_bits)
+    clear();
+
+  bool keyframe = force_keyframe || segments.empty() ||
+                  segments.back().frames.size() >=
+                      static_cast<std::size_t>(keyframe_interval);
+  if (keyframe) {
+    segments.emplace_back();
+    // deltas never refer to the state before a keyframe, this also forgets
+    // the destroyed entities
+    last.transforms.clear();
+    last.components.clear();
+    force_keyframe = false;
+  }
+  auto &seg = segments.back();
+  if (frame_count > 0)
+    current_time += dt;
+  seg.frames.push_back({current_time, seg.data.size()});
+  auto size_before = seg.data.size();
+
+  // transforms, the entity ids are stored as deltas to the previous one
+  transform_scratch.clear();
+  std::uint64_t num_transforms = 0;
+  std::int64_t prev_entity = 0;
+  bool clamped = false;
+  registry.view<entt::entity, transform>().each(
+      [&](entt::entity entity, transform &trans) {
+        auto q = quantize(trans, clamped);
+        auto &base = last.transforms.try_emplace(entity).first->second;
+        std::uint8_t mask = keyframe ? 0b111 : 0;
+        for (int g = 0; g < 3; g++)
+          for (int i = group_begin[g]; i < group_end[g]; i++)
+            if (q.values[i] != base.values[i])
+              mask |= 1 << g;
+        if (mask == 0)
+          return;
+        auto id = static_cast<std::int64_t>(entt::to_integral(entity));
+        write_signed(transform_scratch, id - prev_entity);
+        prev_entity = id;
+        transform_scratch.push_back(mask);
+        for (int g = 0; g < 3; g++)
+          if (mask & (1 << g))
+            for (int i = group_begin[g]; i < group_end[g]; i++)
+              write_signed(transform_scratch,
+                           static_cast<std::int64_t>(q.values[i]) -
+                               base.values[i]);
+        base = q;
+        num_transforms++;
+      });
+  if (clamped && !range_warned) {
+    spdlog::warn("Frame recorder clamped transforms out of the quantized "
+                 "range, increase position_precision for large scenes");
+    range_warned = true;
+  }
+
+  // the other components are stored whole whenever their cbor changes
+  component_scratch.clear();
+  std::uint64_t num_components = 0;
+  prev_entity = 0;
+  for (auto &name : components) {
+    auto serializer = iapp::__comp_serializer_callbacks__.find(name);
+    auto listen = iapp::__comp_listen_callbacks__.find(name);
+    if (serializer == iapp::__comp_serializer_callbacks__.end() ||
+        listen == iapp::__comp_listen_callbacks__.end())
+      continue;
+    auto storage = registry.storage(listen->second.first);
+    if (storage == nullptr)
+      continue;
+    auto type = interned_string(name).id();
+    for (auto entity : *storage) {
+      nlohmann::json j;
+      serializer->second.first(registry, entity, j);
+      auto bytes = nlohmann::json::to_cbor(j[name]);
+      auto &base = last.components[{type, entity}];
+      if (!keyframe && base == bytes)
+        continue;
+      write_varint(component_scratch, type);
+      auto id = static_cast<std::int64_t>(entt::to_integral(entity));
+      write_signed(component_scratch, id - prev_entity);
+      prev_entity = id;
+      write_varint(component_scratch, bytes.size());
+      component_scratch.insert(component_scratch.end(), bytes.begin(),
+                               bytes.end());
+      base = std::move(bytes);
+      num_components++;
+    }
+  }
+
+  write_varint(seg.data, num_transforms);
+  seg.data.insert(seg.data.end(), transform_scratch.begin(),
+                  transform_scratch.end());
+  write_varint(seg.data, num_components);
+  seg.data.insert(seg.data.end(), component_scratch.begin(),
+                  component_scratch.end());
+  total_bytes += seg.data.size() - size_before + sizeof(frame);
+  frame_count++;
+  evict();
+}
+
+void frame_recorder::evict() {
+  // keep the newest segments covering `duration`, whole segments are dropped
+  // since the deltas depend on their keyframe
+  while (segments.size() > 1 &&
+         (total_bytes > memory_budget ||
+          current_time - segments[1].frames.front().time >= duration)) {
+    auto &front = segments.front();
+    total_bytes -= front.data.size() + front.frames.size() * sizeof(frame);
+    frame_count -= front.frames.size();
+    segments.pop_front();
+  }
+}
+
+void frame_recorder::decode_frame(const segment &seg, std::size_t local,
+                                  decoded_state &state) const {
+  state.transforms.clear();
+  state.components.clear();
+  for (std::size_t f = 0; f <= local; f++) {
+    frame_reader reader{seg.data.data() + seg.frames[f].offset};
+    auto num_transforms = reader.varint();
+    std::int64_t entity = 0;
+    for (std::uint64_t k = 0; k < num_transforms; k++) {
+      entity += reader.signed_varint();
+      auto mask = *reader.ptr++;
+      auto &q = state.transforms[static_cast<entt::entity>(entity)];
+      for (int g = 0; g < 3; g++)
+        if (mask & (1 << g))
+          for (int i = group_begin[g]; i < group_end[g]; i++)
+            q.values[i] += static_cast<std::int32_t>(reader.signed_varint());
+    }
+    auto num_components = reader.varint();
+    entity = 0;
+    for (std::uint64_t k = 0; k < num_components; k++) {
+      auto type = static_cast<std::uint32_t>(reader.varint());
+      entity += reader.signed_varint();
+      auto size = reader.varint();
+      state.components[{type, static_cast<entt::entity>(entity)}].assign(
+          reader.ptr, reader.ptr + size);
+      reader.ptr += size;
+    }
+  }
+}
+
+bool frame_recorder::restore(entt::registry &registry, std::size_t index) {
+  PROFILE_SCOPE("frame_recorder::restore");
+  std::size_t local = index;
+  auto seg = segments.begin();
+  while (seg != segments.end() && local >= seg->frames.size())
+    local -= (seg++)->frames.size();
+  if (seg == segments.end())
+    return false;
+  decoded_state state;
+  decode_frame(*seg, local, state);
+
+  for (auto &[entity, q] : state.transforms) {
+    if (!registry.valid(entity))
+      continue;
+    auto trans = registry.try_get<transform>(entity);
+    if (trans == nullptr)
+      continue;
+    auto &v = q.values;
+    trans->set_local_pos(math::vector3(v[0], v[1], v[2]) *
+                         recorded_position_precision);
+    // the rotation scale cancels out in the normalization
+    trans->set_local_rot(math::quat(v[6], v[3], v[4], v[5]).normalized());
+    trans->set_local_scale(math::vector3(v[7], v[8], v[9]) *
+                           recorded_position_precision);
+  }
+
+  entity_mapping_scope scope;
+  for (auto &[key, bytes] : state.components) {
+    auto &name = string_interner::lookup(key.first);
+    auto ops = iapp::__comp_history_callbacks__.find(name);
+    auto listen = iapp::__comp_listen_callbacks__.find(name);
+    if (ops == iapp::__comp_history_callbacks__.end() ||
+        listen == iapp::__comp_listen_callbacks__.end() ||
+        !registry.valid(key.second))
+      continue;
+    auto storage = registry.storage(listen->second.first);
+    if (storage != nullptr && storage->contains(key.second))
+      ops->second.first(registry, key.second, nlohmann::json::from_cbor(bytes));
+  }
+  return true;
+}
+
+void frame_recorder::truncate(std::size_t index) {
+  std::size_t kept = 0;
+  for (auto it = segments.begin(); it != segments.end(); it++) {
+    if (kept + it->frames.size() <= index + 1) {
+      kept += it->frames.size();
+      continue;
+    }
+    auto local = index + 1 - kept;
+    if (local == 0) {
+      segments.erase(it, segments.end());
+    } else {
+      it->data.resize(it->frames[local].offset);
+      it->frames.resize(local);
+      segments.erase(it + 1, segments.end());
+    }
+    break;
+  }
+  frame_count = 0;
+  total_bytes = 0;
+  for (auto &seg : segments) {
+    frame_count += seg.frames.size();
+    total_bytes += seg.data.size() + seg.frames.size() * sizeof(frame);
+  }
+  if (!segments.empty())
+    current_time = segments.back().frames.back().time;
+  force_keyframe = true;
+}
+
+void frame_recorder::clear() {
+  segments.clear();
+  frame_count = 0;
+  total_bytes = 0;
+  current_time = 0.0f;
+  force_keyframe = true;
+  recorded_position_precision = position_precision;
+  recorded_rotation_bits = rotation_bits;
+  last.transforms.clear();
+  last.components.clear();
+  scrubbing = false;
+  range_warned = false;
+}
+
+float frame_recorder::frame_time(std::size_t index) const {
+  if (segments.empty())
+    return 0.0f;
+  float start = segments.front().frames.front().time;
+  for (auto &seg : segments) {
+    if (index < seg.frames.size())
+      return seg.frames[index].time - start;
+    index -= seg.frames.size();
+  }
+  return current_time - start;
+}
+
+void frame_recorder::draw_menu_gui() {
+  ImGui::DragFloat("Duration (s)", &duration, 1.0f, 1.0f, 3600.0f);
+  int budget_mb = static_cast<int>(memory_budget >> 20);
+  if (ImGui::InputInt("Memory Budget (MB)", &budget_mb))
+    memory_budget = static_cast<std::uint64_t>(std::max(budget_mb, 1)) << 20;
+  ImGui::InputInt("Keyframe Interval", &keyframe_interval);
+  ImGui::InputFloat("Position Precision", &position_precision, 0.0f, 0.0f,
+                    "%.6f");
+  ImGui::SliderInt("Rotation Bits", &rotation_bits, 8, 16);
+  if (ImGui::BeginMenu("Components")) {
+    for (auto &[name, listen] : iapp::__comp_listen_callbacks__) {
+      if (name == "transform")
+        continue;
+      auto it = std::find(components.begin(), components.end(), name);
+      if (ImGui::MenuItem(name.c_str(), nullptr, it != components.end())) {
+        if (it == components.end())
+          components.push_back(name);
+        else
+          components.erase(it);
+        force_keyframe = true;
+      }
+    }
+    ImGui::EndMenu();
+  }
+  ImGui::Separator();
+
+  ImGui::MenuItem(str_format("%d frames, %.2f s, %.2f MB",
+                             static_cast<int>(frame_count),
+                             frame_time(frame_count), total_bytes / 1048576.0)
+                      .c_str(),
+                  nullptr, false, false);
+  if (frame_count > 0) {
+    int last_frame = static_cast<int>(frame_count) - 1;
+    if (!scrubbing)
+      scrub_frame = last_frame;
+    scrub_frame = std::min(scrub_frame, last_frame);
+    auto label = str_format("%%d (%.2f s)", frame_time(scrub_frame));
+    if (ImGui::SliderInt("Frame", &scrub_frame, 0, last_frame,
+                         label.c_str())) {
+      scrubbing = true;
+      restore(app->registry, scrub_frame);
+    }
+    if (scrubbing && ImGui::MenuItem("Resume From This Frame")) {
+      truncate(scrub_frame);
+      scrubbing = false;
+    }
+  }
+  ImGui::Checkbox("Recording", &recording);
+  if (ImGui::MenuItem("Clear"))
+    clear();
+}
+
+}; // namespace toolkit
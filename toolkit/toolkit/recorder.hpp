@@ -0,0 +1,117 @@
+#pragma once
+
+#include "toolkit/system.hpp"
+#include "toolkit/transform.hpp"
+#include <deque>
+
+namespace toolkit {
+
+/**
+ * Records the state of the scene every frame into a ring buffer so the last
+ * `duration` seconds can be scrubbed through and restored. The local
+ * transforms of all entities are quantized, positions and scales to multiples
+ * of `position_precision` and rotations to `rotation_bits` bits per quaternion
+ * component. Values beyond the 32 bit range of the quantized positions are
+ * clamped. Each frame only stores the transforms whose quantized values
+ * changed, as variable length deltas against the previous frame. Every
+ * `keyframe_interval` frames a keyframe stores all transforms, so the oldest
+ * keyframe and its deltas can be dropped once the buffer covers `duration` or
+ * takes more than `memory_budget` bytes.
+ *
+ * The component types listed in `components` are recorded as cbor whenever
+ * their reflected fields change, transforms don't need to be listed.
+ *
+ * Restoring a frame only touches the entities which are still alive. While
+ * scrubbing, the selected frame is applied again after every lateupdate so
+ * the other systems don't overwrite it. Resuming drops the frames after it.
+ */
+class frame_recorder : public isystem {
+public:
+  void init0(entt::registry &registry) override;
+  void lateupdate(entt::registry &registry, float dt) override;
+  void draw_menu_gui() override;
+  std::string get_name() override { return "Frame Recorder"; }
+
+  /**
+   * Append the current state of the registry as the newest frame.
+   */
+  void capture(entt::registry &registry, float dt);
+  /**
+   * Apply recorded frame `index` to the registry, 0 is the oldest frame in
+   * the buffer. Returns false if there's no such frame.
+   */
+  bool restore(entt::registry &registry, std::size_t index);
+  /**
+   * Drop all frames after `index`, the next captured frame is a keyframe.
+   */
+  void truncate(std::size_t index);
+  void clear();
+
+  std::size_t num_frames() const { return frame_count; }
+  // seconds recorded before frame `index`
+  float frame_time(std::size_t index) const;
+  std::size_t memory_usage() const { return total_bytes; }
+
+  // off by default, recording costs memory and time every frame
+  bool recording = false;
+  float duration = 60.0f;
+  std::uint64_t memory_budget = 256ull << 20;
+  int keyframe_interval = 60;
+  float position_precision = 1e-4f;
+  int rotation_bits = 12;
+  std::vector<std::string> components;
+
+private:
+  struct quantized_transform {
+    std::array<std::int32_t, 10> values{};
+  };
+  struct frame {
+    float time;
+    std::size_t offset;
+  };
+  // a keyframe and the deltas following it, encoded back to back
+  struct segment {
+    std::vector<frame> frames;
+    std::vector<std::uint8_t> data;
+  };
+  using component_key = std::pair<std::uint32_t, entt::entity>;
+  struct component_key_hash {
+    std::size_t operator()(const component_key &key) const {
+      return std::hash<std::uint64_t>{}(
+          (static_cast<std::uint64_t>(key.first) << 32) |
+          entt::to_integral(key.second));
+    }
+  };
+  // state of all recorded entities after decoding a frame
+  struct decoded_state {
+    std::unordered_map<entt::entity, quantized_transform> transforms;
+    std::unordered_map<component_key, std::vector<std::uint8_t>,
+                       component_key_hash>
+        components;
+  };
+
+  quantized_transform quantize(const transform &trans, bool &clamped) const;
+  void decode_frame(const segment &seg, std::size_t local,
+                    decoded_state &state) const;
+  void evict();
+
+  std::deque<segment> segments;
+  std::size_t frame_count = 0, total_bytes = 0;
+  float current_time = 0.0f;
+  bool force_keyframe = true;
+  // quantization used by the frames in the buffer
+  float recorded_position_precision = 0.0f;
+  int recorded_rotation_bits = 0;
+  bool range_warned = false;
+  decoded_state last;
+  std::vector<std::uint8_t> transform_scratch, component_scratch;
+
+  iapp *app = nullptr;
+  bool scrubbing = false;
+  int scrub_frame = 0;
+};
+DECLARE_SYSTEM(frame_recorder, recording, duration, memory_budget,
+               keyframe_interval, position_precision, rotation_bits,
+               components)
+
+}; // namespace toolkit
@@ -10,8 +10,13 @@
 #error "Need a c++20 compiler"
 #endif
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <json.hpp>
 #include <set>
+#include <string>
 #include <tuple>
 #include <typeindex>
 #include <typeinfo>
@@ -22,8 +27,14 @@ namespace toolkit {
 namespace _Reflect_Imp {
 
 template <typename T> struct field_info {
-  const char *name; // name for the field
-  T ptr;            // pointer to the field
+  const char *name;   // name for the field
+  T ptr;              // pointer to the field
+  std::size_t offset; // byte offset of the field in the class
+};
+
+template <typename T> struct member_type;
+template <typename C, typename M> struct member_type<M C::*> {
+  using type = M;
 };
 
 // traverse the tuple
@@ -385,9 +396,22 @@ public:
 
 #define MAKE_REFLECT_FIELD(class_name, field)                                  \
   toolkit::_Reflect_Imp::field_info<decltype(&class_name::field)> {            \
-    #field, &class_name::field                                                 \
+    #field, &class_name::field, offsetof(class_name, field)                    \
   }
 
+// offsetof is conditionally supported for classes without standard layout,
+// gcc and clang warn about it but compute the offset just as well, only bulk
+// classes (no vtable, no padding) rely on the offsets
+#if defined(__GNUC__) || defined(__clang__)
+#define REFLECT_OFFSETOF_BEGIN                                                 \
+  _Pragma("GCC diagnostic push")                                               \
+      _Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"")
+#define REFLECT_OFFSETOF_END _Pragma("GCC diagnostic pop")
+#else
+#define REFLECT_OFFSETOF_BEGIN
+#define REFLECT_OFFSETOF_END
+#endif
+
 /**
  * Traverse one tuple.
  *
@@ -422,6 +446,10 @@ template <typename T> bool is_reflectable() {
  * To successfully serialize and deserialize the class, all the member variables
  * within the macro should have complete serilization definition for
  * `nlohmann::json`.
+ *
+ * The macro also defines `reflect_fields`, a compile time list of the fields
+ * used by `binary_serializer`, so the class can be stored compactly with
+ * `to_binary` and `from_binary`.
  */
 #define REFLECT(class_name, ...)                                               \
   struct __registry_##class_name {                                             \
@@ -432,10 +460,15 @@ template <typename T> bool is_reflectable() {
   };                                                                           \
   static __registry_##class_name __registry_instance_##class_name =            \
       __registry_##class_name();                                               \
-  inline auto get_reflect_fields_##class_name() {                              \
+  REFLECT_OFFSETOF_BEGIN                                                       \
+  constexpr auto get_reflect_fields_##class_name() {                           \
     return std::make_tuple(__VA_OPT__(                                         \
         REFLECT_FOR_EACH(class_name, MAKE_REFLECT_FIELD, __VA_ARGS__)));       \
   }                                                                            \
+  REFLECT_OFFSETOF_END                                                         \
+  constexpr auto reflect_fields(const class_name *) {                          \
+    return get_reflect_fields_##class_name();                                  \
+  }                                                                            \
   inline void to_json(nlohmann::json &j, const class_name &obj) {              \
     toolkit::for_each(get_reflect_fields_##class_name(), [&](auto field) {     \
       using FieldType = std::decay_t<decltype(obj.*(field.ptr))>;              \
@@ -453,6 +486,364 @@ template <typename T> bool is_reflectable() {
 #define REFLECT_PRIVATE(class_name)                                            \
   friend void to_json(nlohmann::json &j, const class_name &obj);               \
   friend void from_json(const nlohmann::json &j, class_name &obj);             \
-  friend auto get_reflect_fields_##class_name();
+  friend constexpr auto get_reflect_fields_##class_name();
+
+class binary_writer {
+public:
+  void write_bytes(const void *data, std::size_t size) {
+    auto bytes = static_cast<const std::uint8_t *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+  template <typename T> void write(const T &value);
+
+  std::vector<std::uint8_t> buffer;
+};
+
+class binary_reader {
+public:
+  binary_reader(const std::uint8_t *data, std::size_t size)
+      : data(data), size(size) {}
+
+  // returns false and stops reading once the data runs out
+  bool read_bytes(void *out, std::size_t count) {
+    if (failed || count > remaining()) {
+      failed = true;
+      return false;
+    }
+    std::memcpy(out, data + offset, count);
+    offset += count;
+    return true;
+  }
+  template <typename T> bool read(T &value);
+
+  std::size_t remaining() const { return size - offset; }
+  bool ok() const { return !failed; }
+  void fail() { failed = true; }
+
+private:
+  const std::uint8_t *data;
+  std::size_t size, offset = 0;
+  bool failed = false;
+};
+
+namespace _Reflect_Imp {
+
+constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+constexpr std::uint64_t fnv_prime = 1099511628211ull;
+constexpr std::uint64_t hash_combine(std::uint64_t h, std::uint64_t value) {
+  for (int i = 0; i < 8; i++)
+    h = (h ^ ((value >> (i * 8)) & 0xff)) * fnv_prime;
+  return h;
+}
+constexpr std::uint64_t hash_combine(std::uint64_t h, const char *str) {
+  for (; *str; str++)
+    h = (h ^ static_cast<std::uint8_t>(*str)) * fnv_prime;
+  return hash_combine(h, 0xff);
+}
+
+template <typename T>
+concept reflected = requires(const T *obj) { reflect_fields(obj); };
+template <typename T> struct is_std_vector : std::false_type {};
+template <typename T, typename A>
+struct is_std_vector<std::vector<T, A>> : std::true_type {};
+template <typename T> struct is_std_array : std::false_type {};
+template <typename T, std::size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type {};
+template <typename T> struct is_std_pair : std::false_type {};
+template <typename A, typename B>
+struct is_std_pair<std::pair<A, B>> : std::true_type {};
+template <typename T>
+concept map_like = requires(T m) {
+  typename T::key_type;
+  typename T::mapped_type;
+  m.emplace(std::declval<typename T::key_type>(),
+            std::declval<typename T::mapped_type>());
+};
+template <typename T>
+concept set_like = !map_like<T> && requires(T s) {
+  typename T::key_type;
+  s.insert(std::declval<typename T::key_type>());
+};
+
+}; // namespace _Reflect_Imp
+
+template <typename T, typename = void> struct binary_serializer;
+
+namespace _Reflect_Imp {
+
+template <typename T> constexpr bool default_bulk() {
+  if constexpr (reflected<T>) {
+    constexpr auto fields = reflect_fields(static_cast<const T *>(nullptr));
+    return std::apply(
+        [](auto... field) {
+          // the fields must cover the whole object without padding
+          return (binary_serializer<
+                      typename member_type<decltype(field.ptr)>::type>::bulk &&
+                  ...) &&
+                 (sizeof(typename member_type<decltype(field.ptr)>::type) +
+                  ... + 0) == sizeof(T);
+        },
+        fields);
+  } else if constexpr (is_std_array<T>::value) {
+    return binary_serializer<typename T::value_type>::bulk;
+  } else {
+    return std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> &&
+           !is_std_pair<T>::value;
+  }
+}
+
+}; // namespace _Reflect_Imp
+
+/**
+ * Binary counterpart of `nlohmann::adl_serializer`, specialize it for types
+ * that need a custom layout. A specialization provides
+ *
+ *   static void write(binary_writer &, const T &);
+ *   static bool read(binary_reader &, T &);
+ *   static constexpr std::uint64_t schema();
+ *   static constexpr bool bulk;
+ *
+ * `bulk` means the value is stored as its own bytes, so arrays of it can be
+ * copied with a single memcpy.
+ *
+ * The default implementation handles reflected classes, strings, vectors,
+ * arrays, pairs, maps, sets and trivially copyable types, other types that
+ * can be converted to json are stored as cbor.
+ */
+template <typename T, typename> struct binary_serializer {
+  static constexpr bool bulk = _Reflect_Imp::default_bulk<T>();
+
+  static void write(binary_writer &writer, const T &value) {
+    using namespace _Reflect_Imp;
+    if constexpr (reflected<T>) {
+      if constexpr (bulk) {
+        writer.write_bytes(&value, sizeof(T));
+      } else {
+        std::apply(
+            [&](auto... field) { (writer.write(value.*(field.ptr)), ...); },
+            reflect_fields(&value));
+      }
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      writer.write(static_cast<std::uint64_t>(value.size()));
+      writer.write_bytes(value.data(), value.size());
+    } else if constexpr (is_std_vector<T>::value) {
+      using E = typename T::value_type;
+      writer.write(static_cast<std::uint64_t>(value.size()));
+      if constexpr (!std::is_same_v<E, bool> && binary_serializer<E>::bulk)
+        writer.write_bytes(value.data(), value.size() * sizeof(E));
+      else
+        for (const E &e : value)
+          writer.write(e);
+    } else if constexpr (is_std_array<T>::value) {
+      if constexpr (bulk)
+        writer.write_bytes(value.data(), sizeof(T));
+      else
+        for (auto &e : value)
+          writer.write(e);
+    } else if constexpr (is_std_pair<T>::value) {
+      writer.write(value.first);
+      writer.write(value.second);
+    } else if constexpr (map_like<T> || set_like<T>) {
+      writer.write(static_cast<std::uint64_t>(value.size()));
+      for (auto &e : value)
+        writer.write(e);
+    } else if constexpr (bulk) {
+      writer.write_bytes(&value, sizeof(T));
+    } else {
+      auto bytes = nlohmann::json::to_cbor(nlohmann::json(value));
+      writer.write(bytes);
+    }
+  }
+
+  static bool read(binary_reader &reader, T &value) {
+    using namespace _Reflect_Imp;
+    if constexpr (reflected<T>) {
+      if constexpr (bulk) {
+        reader.read_bytes(&value, sizeof(T));
+      } else {
+        std::apply(
+            [&](auto... field) { (reader.read(value.*(field.ptr)), ...); },
+            reflect_fields(&value));
+      }
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      std::uint64_t size = 0;
+      if (reader.read(size) && size <= reader.remaining()) {
+        value.resize(size);
+        reader.read_bytes(value.data(), size);
+      } else {
+        reader.fail();
+      }
+    } else if constexpr (is_std_vector<T>::value) {
+      using E = typename T::value_type;
+      std::uint64_t size = 0;
+      if (!reader.read(size))
+        return false;
+      value.clear();
+      if constexpr (!std::is_same_v<E, bool> && binary_serializer<E>::bulk) {
+        if (size > reader.remaining() / sizeof(E)) {
+          reader.fail();
+          return false;
+        }
+        value.resize(size);
+        reader.read_bytes(value.data(), size * sizeof(E));
+      } else {
+        // don't trust the size of corrupted data for the allocation
+        value.reserve(std::min<std::uint64_t>(size, reader.remaining()));
+        for (std::uint64_t i = 0; i < size && reader.ok(); i++) {
+          E e{};
+          reader.read(e);
+          value.push_back(std::move(e));
+        }
+      }
+    } else if constexpr (is_std_array<T>::value) {
+      if constexpr (bulk)
+        reader.read_bytes(value.data(), sizeof(T));
+      else
+        for (auto &e : value)
+          reader.read(e);
+    } else if constexpr (is_std_pair<T>::value) {
+      reader.read(value.first);
+      reader.read(value.second);
+    } else if constexpr (map_like<T>) {
+      std::uint64_t size = 0;
+      reader.read(size);
+      value.clear();
+      for (std::uint64_t i = 0; i < size && reader.ok(); i++) {
+        std::pair<typename T::key_type, typename T::mapped_type> e{};
+        if (reader.read(e))
+          value.emplace(std::move(e.first), std::move(e.second));
+      }
+    } else if constexpr (set_like<T>) {
+      std::uint64_t size = 0;
+      reader.read(size);
+      value.clear();
+      for (std::uint64_t i = 0; i < size && reader.ok(); i++) {
+        typename T::key_type e{};
+        if (reader.read(e))
+          value.insert(std::move(e));
+      }
+    } else if constexpr (bulk) {
+      reader.read_bytes(&value, sizeof(T));
+    } else {
+      std::vector<std::uint8_t> bytes;
+      if (reader.read(bytes)) {
+        auto j = nlohmann::json::from_cbor(bytes, true, false);
+        if (j.is_discarded())
+          reader.fail();
+        else
+          value = j.template get<T>();
+      }
+    }
+    return reader.ok();
+  }
+
+  static constexpr std::uint64_t schema() {
+    using namespace _Reflect_Imp;
+    std::uint64_t h = fnv_offset;
+    if constexpr (reflected<T>) {
+      constexpr auto fields = reflect_fields(static_cast<const T *>(nullptr));
+      h = hash_combine(h, "reflected");
+      std::apply(
+          [&](auto... field) {
+            ((h = hash_combine(
+                  hash_combine(h, field.name),
+                  binary_serializer<typename member_type<
+                      decltype(field.ptr)>::type>::schema())),
+             ...);
+          },
+          fields);
+      // bulk objects are copied as a whole, so the position of every field
+      // in memory is part of the layout as well
+      if constexpr (bulk) {
+        std::apply(
+            [&](auto... field) {
+              ((h = hash_combine(h, field.offset)), ...);
+            },
+            fields);
+        h = hash_combine(h, sizeof(T));
+      }
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      h = hash_combine(h, "string");
+    } else if constexpr (is_std_vector<T>::value) {
+      h = hash_combine(hash_combine(h, "vector"),
+                       binary_serializer<typename T::value_type>::schema());
+    } else if constexpr (is_std_array<T>::value) {
+      h = hash_combine(hash_combine(hash_combine(h, "array"), T().size()),
+                       binary_serializer<typename T::value_type>::schema());
+    } else if constexpr (is_std_pair<T>::value) {
+      h = hash_combine(
+          hash_combine(hash_combine(h, "pair"),
+                       binary_serializer<typename T::first_type>::schema()),
+          binary_serializer<typename T::second_type>::schema());
+    } else if constexpr (map_like<T>) {
+      h = hash_combine(
+          hash_combine(hash_combine(h, "map"),
+                       binary_serializer<typename T::key_type>::schema()),
+          binary_serializer<typename T::mapped_type>::schema());
+    } else if constexpr (set_like<T>) {
+      h = hash_combine(hash_combine(h, "set"),
+                       binary_serializer<typename T::key_type>::schema());
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      h = hash_combine(hash_combine(h, std::is_floating_point_v<T>   ? "float"
+                                       : std::is_signed_v<T> ? "int"
+                                                             : "uint"),
+                       sizeof(T));
+    } else if constexpr (std::is_enum_v<T>) {
+      h = hash_combine(
+          hash_combine(h, "enum"),
+          binary_serializer<std::underlying_type_t<T>>::schema());
+    } else if constexpr (bulk) {
+      h = hash_combine(hash_combine(h, "bytes"), sizeof(T));
+    } else {
+      h = hash_combine(h, "cbor");
+    }
+    return h;
+  }
+};
+
+template <typename T> void binary_writer::write(const T &value) {
+  binary_serializer<T>::write(*this, value);
+}
+template <typename T> bool binary_reader::read(T &value) {
+  return !failed && binary_serializer<T>::read(*this, value);
+}
+
+/**
+ * Hash of the binary layout of `T`, it changes when a reflected field is
+ * renamed, reordered, added, removed or changes its type, and for structs
+ * copied as raw bytes when a field moves in memory.
+ */
+template <typename T> constexpr std::uint64_t binary_schema() {
+  return binary_serializer<T>::schema();
+}
+
+/**
+ * Serialize `obj` into a compact binary blob prefixed with the schema hash of
+ * `T`. Fields are written in the byte order of the host, the blob is meant
+ * for caches and ipc rather than portable files.
+ */
+template <typename T> std::vector<std::uint8_t> to_binary(const T &obj) {
+  binary_writer writer;
+  writer.write(binary_schema<T>());
+  writer.write(obj);
+  return std::move(writer.buffer);
+}
+
+/**
+ * Deserialize a blob created by `to_binary`, returns false if the schema of
+ * `T` has changed since or the data is truncated.
+ */
+template <typename T>
+bool from_binary(const std::uint8_t *data, std::size_t size, T &obj) {
+  binary_reader reader(data, size);
+  std::uint64_t schema = 0;
+  if (!reader.read(schema) || schema != binary_schema<T>())
+    return false;
+  return reader.read(obj);
+}
+template <typename T>
+bool from_binary(const std::vector<std::uint8_t> &bytes, T &obj) {
+  return from_binary(bytes.data(), bytes.size(), obj);
+}
 
-}; // namespace toolkit
\ No newline at end of file
+}; // namespace toolkit
@@ -0,0 +1,130 @@
+#include "toolkit/scheduler.hpp"
+#include "toolkit/jobs.hpp"
+#include "toolkit/profiler.hpp"
+#include "toolkit/system.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+namespace toolkit {
+
+static bool intersects(const std::set<entt::id_type> &a,
+                       const std::set<entt::id_type> &b) {
+  for (auto id : a)
+    if (b.count(id))
+      return true;
+  return false;
+}
+
+bool system_access::conflicts(const system_access &other) const {
+  if (!declared || !other.declared)
+    return true;
+  return intersects(writes, other.writes) || intersects(writes, other.reads) ||
+         intersects(reads, other.writes);
+}
+
+void system_scheduler::build(std::vector<std::shared_ptr<isystem>> &systems) {
+  nodes.clear();
+  for (auto &sys : systems) {
+    node n;
+    n.sys = sys.get();
+    n.zone_name = profiler::intern(sys->get_name());
+    sys->declare_access(n.access);
+    // undeclared systems may do anything, keep them on the calling thread
+    if (!n.access.declared)
+      n.access.on_main_thread = true;
+    nodes.push_back(std::move(n));
+  }
+  for (std::size_t j = 0; j < nodes.size(); j++) {
+    for (std::size_t i = 0; i < j; i++) {
+      if (nodes[i].access.conflicts(nodes[j].access)) {
+        nodes[i].successors.push_back(j);
+        nodes[j].num_predecessors++;
+      }
+    }
+  }
+  graph_dirty = false;
+}
+
+void system_scheduler::run(system_phase phase,
+                           std::vector<std::shared_ptr<isystem>> &systems,
+                           entt::registry &registry, float dt) {
+  if (graph_dirty || nodes.size() != systems.size())
+    build(systems);
+  if (nodes.empty())
+    return;
+  for (auto &n : nodes)
+    for (auto &assure : n.access.assure_storages)
+      assure(registry);
+
+  auto execute = [&](std::size_t i) {
+    auto sys = nodes[i].sys;
+    if (!sys->active)
+      return;
+    PROFILE_SCOPE(nodes[i].zone_name);
+    switch (phase) {
+    case system_phase::preupdate:
+      sys->preupdate(registry, dt);
+      break;
+    case system_phase::update:
+      sys->update(registry, dt);
+      break;
+    case system_phase::lateupdate:
+      sys->lateupdate(registry, dt);
+      break;
+    }
+  };
+
+  std::vector<std::atomic<int>> remaining(nodes.size());
+  for (std::size_t i = 0; i < nodes.size(); i++)
+    remaining[i] = nodes[i].num_predecessors;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::size_t> main_thread_ready;
+  std::size_t finished = 0;
+
+  std::function<void(std::size_t)> dispatch;
+  auto complete = [&](std::size_t i) {
+    for (auto s : nodes[i].successors)
+      if (--remaining[s] == 0)
+        dispatch(s);
+    std::unique_lock<std::mutex> lock(mtx);
+    finished++;
+    // notify while holding the lock, the waiting thread owns these locals
+    cv.notify_all();
+  };
+  auto &jobs = job_system::instance();
+  dispatch = [&](std::size_t i) {
+    if (nodes[i].access.on_main_thread || jobs.size() == 0) {
+      std::unique_lock<std::mutex> lock(mtx);
+      main_thread_ready.push_back(i);
+      cv.notify_all();
+    } else {
+      jobs.run([&, i]() {
+        execute(i);
+        complete(i);
+      });
+    }
+  };
+
+  for (std::size_t i = 0; i < nodes.size(); i++)
+    if (nodes[i].num_predecessors == 0)
+      dispatch(i);
+  while (true) {
+    std::size_t i;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [&]() {
+        return !main_thread_ready.empty() || finished == nodes.size();
+      });
+      if (main_thread_ready.empty())
+        break;
+      i = main_thread_ready.front();
+      main_thread_ready.pop_front();
+    }
+    execute(i);
+    complete(i);
+  }
+}
+
+}; // namespace toolkit
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "entt/entity/registry.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace toolkit {
+
+class isystem;
+
+/**
+ * Components a system reads and writes during preupdate, update and
+ * lateupdate. Systems touching disjoint components (or only reading shared
+ * ones) are executed concurrently by `system_scheduler`. A system that never
+ * declares its access is treated as exclusive, it won't overlap with any
+ * other system.
+ */
+class system_access {
+public:
+  template <typename... Components> system_access &read() {
+    declared = true;
+    (add<Components>(reads), ...);
+    return *this;
+  }
+  template <typename... Components> system_access &write() {
+    declared = true;
+    (add<Components>(writes), ...);
+    return *this;
+  }
+  /**
+   * The system touches no component in its update functions.
+   */
+  system_access &none() {
+    declared = true;
+    return *this;
+  }
+  /**
+   * The system must run on the thread calling `iapp::update`, use this for
+   * systems issuing opengl or imgui calls.
+   */
+  system_access &main_thread() {
+    on_main_thread = true;
+    return *this;
+  }
+
+  bool conflicts(const system_access &other) const;
+
+  bool declared = false;
+  bool on_main_thread = false;
+  std::set<entt::id_type> reads, writes;
+  // creates the storages up front, entt can't create them concurrently
+  std::vector<std::function<void(entt::registry &)>> assure_storages;
+
+private:
+  template <typename T> void add(std::set<entt::id_type> &target) {
+    target.insert(entt::type_hash<T>::value());
+    assure_storages.push_back(
+        [](entt::registry &registry) { registry.storage<T>(); });
+  }
+};
+
+enum class system_phase { preupdate, update, lateupdate };
+
+inline const char *system_phase_name(system_phase phase) {
+  switch (phase) {
+  case system_phase::preupdate:
+    return "preupdate";
+  case system_phase::update:
+    return "update";
+  case system_phase::lateupdate:
+    return "lateupdate";
+  }
+  return "unknown";
+}
+
+/**
+ * Executes the update phases of all systems. The systems are arranged into a
+ * dependency graph following the registration order: a system depends on
+ * every previously registered system it conflicts with. Systems without
+ * pending dependencies run on the workers of `job_system::instance()`.
+ */
+class system_scheduler {
+public:
+  void invalidate() { graph_dirty = true; }
+  void run(system_phase phase, std::vector<std::shared_ptr<isystem>> &systems,
+           entt::registry &registry, float dt);
+
+private:
+  struct node {
+    isystem *sys;
+    // interned name of the system, used as profiler zone
+    const char *zone_name;
+    system_access access;
+    std::vector<std::size_t> successors;
+    int num_predecessors = 0;
+  };
+  void build(std::vector<std::shared_ptr<isystem>> &systems);
+
+  bool graph_dirty = true;
+  std::vector<node> nodes;
+};
+
+}; // namespace toolkit
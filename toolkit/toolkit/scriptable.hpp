@@ -1,5 +1,7 @@
 #pragma once
 
+#include "toolkit/commands.hpp"
+#include "toolkit/jobs.hpp"
 #include "toolkit/system.hpp"
 
 namespace toolkit {
@@ -21,6 +23,16 @@ namespace toolkit {
  * variable by `dynamic_cast<opengl::editor*>(app)`, some global variables like
  * dimension of the window, the scene, input signals, active camera etc. are
  * stored in `opengl::g_instance`.
+ *
+ * A script declaring `static constexpr bool thread_safe = true;` has its
+ * `update` and `lateupdate` run in parallel on the worker threads. Such hooks
+ * may only modify their own script and the components of entities no other
+ * script of the type touches, and may not read components other scripts
+ * write, e.g. the transform of a target or of the parent (`set_world_pos`
+ * reads it). Structural changes (creating and destroying entities, adding,
+ * removing or patching components, reparenting) must be recorded into
+ * `commands()`, they're replayed on the main thread once all scripts of the
+ * type finished.
  */
 class scriptable : public icomponent {
 public:
@@ -35,12 +47,39 @@ public:
   virtual void update(iapp *app, float dt) {}
   virtual void lateupdate(iapp *app, float dt) {}
 
+  // deferred structural changes of the current thread
+  command_buffer &commands();
+
   bool enabled = true;
 
   entt::registry *registry = nullptr;
   entt::entity entity = entt::null;
 };
 
+class script_system;
+
+/**
+ * Typed entry points of one script type, a hook is null if the type doesn't
+ * override it so the script system never visits its pool for that hook.
+ */
+struct script_type {
+  void (*draw_to_scene)(script_system &, iapp *) = nullptr;
+  void (*preupdate)(script_system &, iapp *, float) = nullptr;
+  void (*update)(script_system &, iapp *, float) = nullptr;
+  void (*lateupdate)(script_system &, iapp *, float) = nullptr;
+  scriptable *(*try_get)(entt::registry &, entt::entity) = nullptr;
+};
+
+// a hook is overridden if `&T::hook` isn't the member of scriptable itself
+#define SCRIPT_OVERRIDES(class_name, hook)                                     \
+  (!std::is_same_v<decltype(&class_name::hook),                                \
+                   decltype(&toolkit::scriptable::hook)>)
+
+template <typename ScriptType>
+concept __thread_safe_script__ = requires {
+  requires ScriptType::thread_safe;
+};
+
 /**
  * !!!REMINDER!!!
  *
@@ -51,16 +90,18 @@ public:
  */
 class script_system : public isystem {
 public:
-  static inline std::map<
-      std::string,
-      std::function<void(entt::registry &,
-                         std::function<void(entt::entity, scriptable *)>)>>
-      script_views;
+  static inline std::map<std::string, script_type> script_types;
   static inline std::map<std::string, std::function<void(entt::registry &)>>
       __construct_destroy_registry__;
 
   std::vector<scriptable *> scripts_wait_to_start;
 
+  // minimum number of thread safe scripts updated by one task
+  int parallel_grain = 64;
+  // commands recorded on the main thread and by each parallel task
+  command_buffer commands;
+  std::vector<command_buffer> task_commands;
+
   void init0(entt::registry &registry) override {
     scripts_wait_to_start.clear();
     for (auto &f : __construct_destroy_registry__)
@@ -69,64 +110,151 @@ public:
 
   void init1(entt::registry &registry) override {}
 
+  // scripts are updated through the iapp overloads below
+  void declare_access(system_access &access) override { access.none(); }
+
   void draw_gui(entt::registry &registry, entt::entity entity) override {
     auto ptr = registry.ctx().get<iapp *>();
-    for (auto &sv : script_views) {
-      sv.second(registry, [&](entt::entity it_entity, scriptable *script) {
-        if (it_entity == entity) {
-          if (ImGui::CollapsingHeader(script->get_name().c_str())) {
-            ImGui::Checkbox("Active", &script->enabled);
-            ImGui::Separator();
-            if (!script->enabled)
-              ImGui::BeginDisabled();
-            script->draw_gui(ptr);
-            if (!script->enabled)
-              ImGui::EndDisabled();
-          }
-        }
-      });
+    for (auto &[name, type] : script_types) {
+      auto script = type.try_get(registry, entity);
+      if (script == nullptr ||
+          !ImGui::CollapsingHeader(script->get_name().c_str()))
+        continue;
+      ImGui::Checkbox("Active", &script->enabled);
+      ImGui::Separator();
+      if (!script->enabled)
+        ImGui::BeginDisabled();
+      script->draw_gui(ptr);
+      if (!script->enabled)
+        ImGui::EndDisabled();
     }
   }
   void draw_to_scene(iapp *app) {
-    for (auto &sv : script_views) {
-      sv.second(app->registry, [&](entt::entity it_entity, scriptable *script) {
-        if (script->enabled)
-          script->draw_to_scene(app);
-      });
+    PROFILE_SCOPE("script_system::draw_to_scene");
+    for (auto &[name, type] : script_types) {
+      if (type.draw_to_scene == nullptr)
+        continue;
+      // map keys have stable addresses, safe to use as zone names
+      PROFILE_SCOPE(name.c_str());
+      type.draw_to_scene(*this, app);
     }
   }
 
   void preupdate(iapp *app, float dt) {
+    PROFILE_SCOPE("script_system::preupdate");
     if (scripts_wait_to_start.size() > 0) {
       for (auto script : scripts_wait_to_start)
         script->start();
       scripts_wait_to_start.clear();
     }
-    for (auto &sv : script_views) {
-      sv.second(app->registry, [&](entt::entity it_entity, scriptable *script) {
-        if (script->enabled)
-          script->preupdate(app, dt);
-      });
+    commands.replay(app->registry);
+    for (auto &[name, type] : script_types) {
+      if (type.preupdate == nullptr)
+        continue;
+      PROFILE_SCOPE(name.c_str());
+      type.preupdate(*this, app, dt);
     }
   }
   void update(iapp *app, float dt) {
-    for (auto &sv : script_views) {
-      sv.second(app->registry, [&](entt::entity it_entity, scriptable *script) {
-        if (script->enabled)
-          script->update(app, dt);
-      });
+    PROFILE_SCOPE("script_system::update");
+    for (auto &[name, type] : script_types) {
+      if (type.update == nullptr)
+        continue;
+      PROFILE_SCOPE(name.c_str());
+      type.update(*this, app, dt);
     }
   }
   void lateupdate(iapp *app, float dt) {
-    for (auto &sv : script_views) {
-      sv.second(app->registry, [&](entt::entity it_entity, scriptable *script) {
-        if (script->enabled)
-          script->lateupdate(app, dt);
-      });
+    PROFILE_SCOPE("script_system::lateupdate");
+    for (auto &[name, type] : script_types) {
+      if (type.lateupdate == nullptr)
+        continue;
+      PROFILE_SCOPE(name.c_str());
+      type.lateupdate(*this, app, dt);
     }
   }
 };
-DECLARE_SYSTEM(script_system)
+DECLARE_SYSTEM(script_system, parallel_grain)
+
+inline command_buffer &scriptable::commands() {
+  if (auto buffer = command_buffer::current())
+    return *buffer;
+  return registry->ctx().get<iapp *>()->get_sys<script_system>()->commands;
+}
+
+/**
+ * Visit the enabled scripts of type `T`, a pool only contains objects of
+ * exactly `T` so `func` can call `T`'s hooks without virtual dispatch. Thread
+ * safe scripts are split into tasks for the workers if `parallel` is set.
+ * The recorded commands are replayed once all scripts are visited, in the
+ * order of the tasks so the result doesn't depend on the scheduling.
+ */
+template <typename T, bool parallel = false, typename Func>
+void __for_each_script__(script_system &sys, iapp *app, Func &&func) {
+  auto &registry = app->registry;
+  if constexpr (parallel && __thread_safe_script__<T>) {
+    auto &storage = registry.storage<T>();
+    auto &jobs = job_system::instance();
+    std::size_t count = storage.size(),
+                grain = std::max(sys.parallel_grain, 1);
+    std::size_t num_tasks = std::min<std::size_t>(
+        (count + grain - 1) / grain, (jobs.size() + 1) * 4);
+    if (num_tasks > 1) {
+      if (sys.task_commands.size() < num_tasks)
+        sys.task_commands.resize(num_tasks);
+      auto scripts = storage.begin();
+      jobs.parallel_for(
+          0, num_tasks, 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t task = first; task < last; task++) {
+              command_scope scope(sys.task_commands[task]);
+              for (std::size_t i = task * count / num_tasks,
+                               end = (task + 1) * count / num_tasks;
+                   i < end; i++) {
+                T &script = scripts[i];
+                if (script.enabled)
+                  func(script);
+              }
+            }
+          });
+      for (std::size_t task = 0; task < num_tasks; task++)
+        sys.task_commands[task].replay(registry);
+      return;
+    }
+  }
+  {
+    command_scope scope(sys.commands);
+    registry.view<T>().each([&](T &script) {
+      if (script.enabled)
+        func(script);
+    });
+  }
+  sys.commands.replay(registry);
+}
+
+template <typename T>
+void __script_draw_to_scene__(script_system &sys, iapp *app) {
+  __for_each_script__<T>(sys, app,
+                         [&](T &script) { script.T::draw_to_scene(app); });
+}
+template <typename T>
+void __script_preupdate__(script_system &sys, iapp *app, float dt) {
+  __for_each_script__<T>(sys, app,
+                         [&](T &script) { script.T::preupdate(app, dt); });
+}
+template <typename T>
+void __script_update__(script_system &sys, iapp *app, float dt) {
+  __for_each_script__<T, true>(sys, app,
+                               [&](T &script) { script.T::update(app, dt); });
+}
+template <typename T>
+void __script_lateupdate__(script_system &sys, iapp *app, float dt) {
+  __for_each_script__<T, true>(
+      sys, app, [&](T &script) { script.T::lateupdate(app, dt); });
+}
+template <typename T>
+scriptable *__script_try_get__(entt::registry &registry, entt::entity entity) {
+  return registry.try_get<T>(entity);
+}
 
 #define DECLARE_SCRIPT(class_name, category, ...)                              \
   DECLARE_COMPONENT(class_name, category, enabled __VA_OPT__(, ) __VA_ARGS__)  \
@@ -154,19 +282,21 @@ DECLARE_SYSTEM(script_system)
             registry.on_destroy<class_name>()                                  \
                 .connect<&__on_destroy_##class_name>();                        \
           }));                                                                 \
-      toolkit::script_system::script_views.insert(std::make_pair(              \
-          #class_name,                                                         \
-          [](entt::registry &registry,                                         \
-             std::function<void(entt::entity, toolkit::scriptable *)>          \
-                 &&func) {                                                     \
-            registry.view<entt::entity, class_name>().each(                    \
-                [&](entt::entity it_entity, class_name &script) {              \
-                  func(it_entity, &script);                                    \
-                });                                                            \
-          }));                                                                 \
+      toolkit::script_type type;                                               \
+      if constexpr (SCRIPT_OVERRIDES(class_name, draw_to_scene))               \
+        type.draw_to_scene = toolkit::__script_draw_to_scene__<class_name>;    \
+      if constexpr (SCRIPT_OVERRIDES(class_name, preupdate))                   \
+        type.preupdate = toolkit::__script_preupdate__<class_name>;            \
+      if constexpr (SCRIPT_OVERRIDES(class_name, update))                      \
+        type.update = toolkit::__script_update__<class_name>;                  \
+      if constexpr (SCRIPT_OVERRIDES(class_name, lateupdate))                  \
+        type.lateupdate = toolkit::__script_lateupdate__<class_name>;          \
+      type.try_get = toolkit::__script_try_get__<class_name>;                  \
+      toolkit::script_system::script_types.insert(                             \
+          std::make_pair(#class_name, type));                                  \
     }                                                                          \
   };                                                                           \
   static __register_##class_name __register_instance_##class_name =            \
       __register_##class_name();
 
-}; // namespace toolkit
\ No newline at end of file
+}; // namespace toolkit
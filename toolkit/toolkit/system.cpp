@@ -1,138 +1,304 @@
 #include "toolkit/system.hpp"
+#include "toolkit/binary_scene.hpp"
+#include "toolkit/json_scene.hpp"
 #include "toolkit/transform.hpp"
+#include <spdlog/spdlog.h>
 
 namespace toolkit {
 
+// one column per component type, each storage is iterated once
+static nlohmann::json
+serialize_components(entt::registry &registry,
+                     const std::vector<entt::entity> *subset) {
+  nlohmann::json components = nlohmann::json::object();
+  for (auto &[name, ops] : iapp::__comp_column_callbacks__) {
+    std::vector<entt::entity> entities;
+    nlohmann::json data = nlohmann::json::array();
+    ops.first(registry, subset, entities, data);
+    if (entities.empty())
+      continue;
+    components[name]["entities"] = entities;
+    components[name]["data"] = std::move(data);
+  }
+  return components;
+}
+
+// all entities in creation order except the transient ones
+static std::vector<entt::entity>
+collect_scene_entities(entt::registry &registry,
+                       const std::unordered_set<entt::entity> &transient) {
+  std::vector<entt::entity> entities;
+  for (auto [entity] : registry.storage<entt::entity>().reach())
+    if (transient.empty() || transient.count(entity) == 0)
+      entities.push_back(entity);
+  return entities;
+}
+
 nlohmann::json iapp::serialize() {
-  nlohmann::json reg, sys, all;
-  registry.view<entt::entity>().each([&](entt::entity entity) {
-    nlohmann::json j;
-    for (auto &p0 : __comp_serializer_callbacks__) {
-      auto name = p0.first;
-      auto &serialize = p0.second.first;
-      serialize(registry, entity, j);
-    }
-    reg[std::to_string(entt::to_integral(entity))] = j;
-  });
+  nlohmann::json sys, all;
+  auto entities = collect_scene_entities(registry, transient_entities);
   for (auto &p0 : __sys_serializer_callbacks__) {
     auto name = p0.first;
     auto &serialize = p0.second.first;
     serialize(this, sys);
   }
-  all["registry"] = reg;
+  all["entities"] = entities;
+  all["components"] = serialize_components(
+      registry, transient_entities.empty() ? nullptr : &entities);
   all["systems"] = sys;
   late_serialize(all);
   return all;
 }
 
 void iapp::deserialize(nlohmann::json &j) {
+  json_scene_staging staging;
+  stage_json_scene(j, staging);
+  load_scene(staging.meta, staging.entities,
+             [&]() { return decode_json_scene_columns(staging); });
+}
+
+nlohmann::json iapp::make_prefab(entt::entity root) {
+  nlohmann::json data;
+  auto hierarchy_entities = collect_hierarchy(registry, root);
+
+  data["entities"] = hierarchy_entities;
+  data["components"] = serialize_components(registry, &hierarchy_entities);
+
+  return data;
+}
+
+void iapp::load_prefab(nlohmann::json &j) {
+  json_scene_staging staging;
+  stage_json_scene(j, staging, "data");
+  __entity_mapping__.clear();
+  std::vector<entt::entity> new_entities(staging.entities.size());
+  registry.create(new_entities.begin(), new_entities.end());
+  for (std::size_t i = 0; i < staging.entities.size(); i++)
+    __entity_mapping__[staging.entities[i]] = new_entities[i];
+  for (auto &[name, column] : staging.columns) {
+    for (auto &e : column.entities) {
+      auto it = __entity_mapping__.find(e);
+      if (it == __entity_mapping__.end()) {
+        spdlog::error("Prefab column {0} refers to unknown entity {1}", name,
+                      entt::to_integral(e));
+        registry.destroy(new_entities.begin(), new_entities.end());
+        return;
+      }
+      e = it->second;
+    }
+  }
+
+  for (auto &commit : decode_json_scene_columns(staging))
+    commit(registry);
+  // init1 for all components
+  for (auto new_ent : new_entities)
+    for (auto &fp : __comp_init1_funcs__)
+      fp.second(registry, new_ent);
+}
+
+bool iapp::serialize_binary(const std::string &filepath) {
+  PROFILE_SCOPE("iapp::serialize_binary");
+  scene_writer writer;
+  auto entities = collect_scene_entities(registry, transient_entities);
+  writer.set_entities(entities);
+  write_component_sections(writer, registry,
+                           transient_entities.empty() ? nullptr : &entities);
+
+  nlohmann::json meta, sys;
+  for (auto &p0 : __sys_serializer_callbacks__) {
+    auto &serialize = p0.second.first;
+    serialize(this, sys);
+  }
+  meta["systems"] = sys;
+  late_serialize(meta);
+  writer.add_section(scene_meta_section, {}, nlohmann::json::to_cbor(meta));
+  return writer.write(filepath, scene_magic);
+}
+
+bool iapp::deserialize_binary(const std::string &filepath) {
+  PROFILE_SCOPE("iapp::deserialize_binary");
+  scene_reader reader;
+  if (!reader.open(filepath))
+    return false;
+  if (!reader.is_scene()) {
+    spdlog::error("File {0} is not a binary scene", filepath);
+    return false;
+  }
+  nlohmann::json meta;
+  if (auto section = reader.find_section(scene_meta_section))
+    meta = reader.section_data(*section);
+  load_scene(meta, reader.entities(),
+             [&]() { return decode_component_sections(reader, nullptr); });
+  return true;
+}
+
+bool iapp::deserialize_json_file(const std::string &filepath) {
+  PROFILE_SCOPE("iapp::deserialize_json_file");
+  json_scene_staging staging;
+  if (!parse_json_scene(filepath, staging))
+    return false;
+  load_scene(staging.meta, staging.entities,
+             [&]() { return decode_json_scene_columns(staging); });
+  return true;
+}
+
+void iapp::load_scene(
+    nlohmann::json &meta, const std::vector<entt::entity> &entities,
+    const std::function<std::vector<std::function<void(entt::registry &)>>()>
+        &decode) {
   registry.clear();
-  systems.clear();
-  auto reg = j["registry"];
-  auto sys = j["systems"];
-  // system data initialization, init0 gets called inside deserialize function
+  clear_systems();
+  transient_entities.clear();
+  __entity_mapping__.clear();
+  auto &sys = meta["systems"];
   for (auto &p0 : __sys_serializer_callbacks__) {
-    auto name = p0.first;
     auto &deserialize = p0.second.second;
     deserialize(this, sys);
   }
 
-  // create all entities
-  for (auto &[k, v] : reg.items()) {
-    std::uint32_t id = static_cast<std::uint32_t>(std::stoul(k));
-    entt::entity _entity = entt::entity{id};
-    auto entity = registry.create(_entity);
+  // the components are stored with the saved ids, the hint has to be honored
+  for (auto entity : entities) {
+    auto created = registry.create(entity);
+    if (created != entity)
+      spdlog::error("Entity {0} is stored twice in the scene, its components "
+                    "are merged, the copy got id {1}",
+                    entt::to_integral(entity), entt::to_integral(created));
   }
-  // initialize all components
-  registry.view<entt::entity>().each([&](entt::entity entity) {
-    auto key = std::to_string(entt::to_integral(entity));
-    for (auto &p0 : __comp_serializer_callbacks__) {
-      auto name = p0.first;
-      auto &deserialize = p0.second.second;
-      deserialize(registry, entity, reg[key]);
-    }
-  });
+  // decoding happens on worker threads, components are added to the registry
+  // on this thread only
+  for (auto &commit : decode())
+    commit(registry);
 
-  // component init1
   registry.view<entt::entity>().each([&](entt::entity entity) {
-    for (auto &p : __comp_init1_funcs__) {
-      auto name = p.first;
-      auto &init1 = p.second;
-      init1(registry, entity);
-    }
+    for (auto &p : __comp_init1_funcs__)
+      p.second(registry, entity);
   });
-
-  // system init1
   for (auto &ptr : systems)
     ptr->init1(registry);
-  // application post-deserialization
-  late_deserialize(j);
+  late_deserialize(meta);
 }
 
-nlohmann::json iapp::make_prefab(entt::entity root) {
-  nlohmann::json data;
-  std::vector<entt::entity> hierarchy_entities;
-  std::queue<entt::entity> q;
-  q.push(root);
-  while (!q.empty()) {
-    auto ent = q.front();
-    hierarchy_entities.push_back(ent);
-    q.pop();
-    auto &trans = registry.get<transform>(ent);
-    for (auto c : trans.m_children)
-      q.push(c);
-  }
+bool iapp::make_prefab_binary(entt::entity root, const std::string &filepath) {
+  auto hierarchy_entities = collect_hierarchy(registry, root);
+  scene_writer writer;
+  writer.set_entities(hierarchy_entities);
+  write_component_sections(writer, registry, &hierarchy_entities);
+  return writer.write(filepath, prefab_magic);
+}
 
-  data["entities"] = hierarchy_entities;
-  for (auto ent : hierarchy_entities) {
-    nlohmann::json j;
-    for (auto &p0 : __comp_serializer_callbacks__) {
-      auto name = p0.first;
-      auto &serialize = p0.second.first;
-      serialize(registry, ent, j);
-    }
-    data["data"][std::to_string(entt::to_integral(ent))] = j;
+entt::entity iapp::load_prefab_binary(const std::string &filepath) {
+  PROFILE_SCOPE("iapp::load_prefab_binary");
+  scene_reader reader;
+  if (!reader.open(filepath))
+    return entt::null;
+  if (!reader.is_prefab()) {
+    spdlog::error("File {0} is not a binary prefab", filepath);
+    return entt::null;
   }
+  auto old_entities = reader.entities();
+  if (old_entities.empty())
+    return entt::null;
+  __entity_mapping__.clear();
+  std::vector<entt::entity> new_entities(old_entities.size());
+  registry.create(new_entities.begin(), new_entities.end());
+  for (std::size_t i = 0; i < old_entities.size(); i++)
+    __entity_mapping__[old_entities[i]] = new_entities[i];
 
-  return data;
-}
+  for (auto &commit : decode_component_sections(reader, &__entity_mapping__))
+    commit(registry);
 
-void iapp::load_prefab(nlohmann::json &j) {
-  __entity_mapping__.clear();
-  std::vector<entt::entity> old_entities =
-      j["entities"].get<std::vector<entt::entity>>();
-  for (auto old_ent : old_entities) {
-    auto new_ent = registry.create();
-    __entity_mapping__[old_ent] = new_ent;
-  }
-  for (auto [k, v] : j["data"].items()) {
-    entt::entity old_ent =
-        entt::entity{static_cast<std::uint32_t>(std::stoul(k))};
-    entt::entity new_ent = __entity_mapping__[old_ent];
-    for (auto &p0 : __comp_serializer_callbacks__) {
-      auto name = p0.first;
-      auto deserialize = p0.second.second;
-      deserialize(registry, new_ent, j["data"][k]);
-    }
-  }
-  // init1 for all components
-  for (auto &p : __entity_mapping__) {
-    auto new_ent = p.second;
+  for (auto new_ent : new_entities)
     for (auto &fp : __comp_init1_funcs__)
       fp.second(registry, new_ent);
+  // entities are stored in breadth first order, the first one is the root
+  return new_entities[0];
+}
+
+entity_remap::entity_remap(const std::vector<entt::entity> &sources)
+    : sources(&sources) {
+  std::size_t max_index = 0;
+  for (auto entity : sources)
+    max_index =
+        std::max(max_index, static_cast<std::size_t>(entt::to_entity(entity)));
+  slots = std::make_shared<std::vector<std::int32_t>>(max_index + 1, -1);
+  for (std::size_t i = 0; i < sources.size(); i++)
+    (*slots)[entt::to_entity(sources[i])] = static_cast<std::int32_t>(i);
+}
+
+std::vector<entt::entity> iapp::clone_hierarchy(entt::entity root, int count) {
+  std::vector<entt::entity> roots;
+  if (count <= 0 || !registry.valid(root))
+    return roots;
+  auto sources = collect_hierarchy(registry, root);
+  std::vector<entt::entity> targets(sources.size() * count);
+  registry.create(targets.begin(), targets.end());
+  entity_remap remap(sources);
+  for (auto &p : __comp_clone_callbacks__)
+    p.second.first(registry, sources, targets, count, remap);
+  // sources[0] is the root, the copies are not attached to its parent, their
+  // local transform is set from the world transform of the source so they
+  // don't move
+  for (int c = 0; c < count; c++) {
+    auto copy_root = targets[c * sources.size()];
+    if (auto trans = registry.try_get<transform>(copy_root)) {
+      trans->m_parent = entt::null;
+      trans->set_world_pos(trans->position());
+      trans->set_world_rot(trans->rotation());
+      trans->set_world_scale(trans->scale());
+    }
+    roots.push_back(copy_root);
   }
+  for (auto &p : __comp_clone_callbacks__)
+    p.second.second(registry, targets);
+  return roots;
+}
+
+component_versions::component_versions() {
+  for (auto &p : iapp::__comp_listen_callbacks__)
+    versions[p.second.first] = 0;
+}
+
+void connect_component_listener(entt::registry &registry,
+                                component_listener &listener) {
+  registry.on_construct<entt::entity>()
+      .connect<&component_listener::on_entity_created>(listener);
+  registry.on_destroy<entt::entity>()
+      .connect<&component_listener::on_entity_destroyed>(listener);
+  for (auto &p : iapp::__comp_listen_callbacks__)
+    p.second.second(registry, listener, true);
+}
+
+void disconnect_component_listener(entt::registry &registry,
+                                   component_listener &listener) {
+  registry.on_construct<entt::entity>()
+      .disconnect<&component_listener::on_entity_created>(listener);
+  registry.on_destroy<entt::entity>()
+      .disconnect<&component_listener::on_entity_destroyed>(listener);
+  for (auto &p : iapp::__comp_listen_callbacks__)
+    p.second.second(registry, listener, false);
+}
+
+void mark_components_changed(entt::registry &registry, entt::entity entity) {
+  for (auto &patch : iapp::__comp_patch_funcs__)
+    patch(registry, entity);
 }
 
 void iapp::update(float dt) {
-  for (auto sys : systems)
-    if (sys->active)
-      sys->preupdate(registry, dt);
-  for (auto sys : systems)
-    if (sys->active)
-      sys->update(registry, dt);
-  for (auto sys : systems)
-    if (sys->active)
-      sys->lateupdate(registry, dt);
+  PROFILE_SCOPE("iapp::update");
+  update_phase(system_phase::preupdate, dt);
+  update_phase(system_phase::update, dt);
+  update_phase(system_phase::lateupdate, dt);
+}
+
+void iapp::update_phase(system_phase phase, float dt) {
+  PROFILE_SCOPE(system_phase_name(phase));
+  scheduler.run(phase, systems, registry, dt);
+}
+
+void iapp::clear_systems() {
+  systems.clear();
+  system_slots.clear();
+  scheduler.invalidate();
 }
 
 }; // namespace toolkit
\ No newline at end of file
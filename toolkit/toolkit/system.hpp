@@ -1,8 +1,12 @@
 #pragma once
 
 #include "entt/entity/registry.hpp"
+#include "toolkit/profiler.hpp"
 #include "toolkit/reflect.hpp"
+#include "toolkit/scheduler.hpp"
 #include "toolkit/utils.hpp"
+#include <atomic>
+#include <unordered_set>
 #include <imgui.h>
 #include <iostream>
 #include <json.hpp>
@@ -32,6 +36,13 @@ public:
   virtual void update(entt::registry &registry, float dt) {}
   virtual void lateupdate(entt::registry &registry, float dt) {}
 
+  /**
+   * Declare the components accessed in preupdate, update and lateupdate so
+   * the scheduler can run this system alongside others. Systems that don't
+   * override this function are executed exclusively on the main thread.
+   */
+  virtual void declare_access(system_access &access) {}
+
   virtual void draw_menu_gui() {}
   virtual void draw_gui(entt::registry &registry, entt::entity entity) {}
   virtual std::string get_name() { return typeid(*this).name(); }
@@ -39,17 +50,319 @@ public:
   bool active = true;
 };
 
+/**
+ * Receives the creation and destruction of entities as well as the
+ * construction, update and destruction of every component type declared with
+ * DECLARE_COMPONENT, see `connect_component_listener`. Components are reported
+ * as updated when they are patched through the registry.
+ */
+class component_listener {
+public:
+  virtual void on_entity_created(entt::registry &registry,
+                                 entt::entity entity) {}
+  virtual void on_entity_destroyed(entt::registry &registry,
+                                   entt::entity entity) {}
+  virtual void on_component_changed(entt::id_type type,
+                                    entt::registry &registry,
+                                    entt::entity entity) {}
+  virtual void on_component_removed(entt::id_type type,
+                                    entt::registry &registry,
+                                    entt::entity entity) {}
+};
+
+template <typename T>
+void __listener_component_changed__(component_listener &listener,
+                                    entt::registry &registry,
+                                    entt::entity entity) {
+  listener.on_component_changed(entt::type_hash<T>::value(), registry, entity);
+}
+template <typename T>
+void __listener_component_removed__(component_listener &listener,
+                                    entt::registry &registry,
+                                    entt::entity entity) {
+  listener.on_component_removed(entt::type_hash<T>::value(), registry, entity);
+}
+template <typename T>
+void __listen_component__(entt::registry &registry,
+                          component_listener &listener, bool connect) {
+  if (connect) {
+    registry.on_construct<T>()
+        .template connect<&__listener_component_changed__<T>>(listener);
+    registry.on_update<T>()
+        .template connect<&__listener_component_changed__<T>>(listener);
+    registry.on_destroy<T>()
+        .template connect<&__listener_component_removed__<T>>(listener);
+  } else {
+    registry.on_construct<T>()
+        .template disconnect<&__listener_component_changed__<T>>(listener);
+    registry.on_update<T>()
+        .template disconnect<&__listener_component_changed__<T>>(listener);
+    registry.on_destroy<T>()
+        .template disconnect<&__listener_component_removed__<T>>(listener);
+  }
+}
+template <typename T>
+void __patch_component__(entt::registry &registry, entt::entity entity) {
+  if (registry.all_of<T>(entity))
+    registry.patch<T>(entity);
+}
+// assign the reflected fields present in `fields`, the others are untouched
+template <typename T>
+void __assign_component_fields__(entt::registry &registry, entt::entity entity,
+                                 const nlohmann::json &fields) {
+  registry.patch<T>(entity, [&](T &comp) { from_json(fields, comp); });
+}
+template <typename T>
+void __remove_component__(entt::registry &registry, entt::entity entity) {
+  registry.remove<T>(entity);
+}
+
+/**
+ * Monotonically increasing change version of every component type declared
+ * with DECLARE_COMPONENT, the version of a type goes up whenever one of its
+ * components gets constructed, patched or destroyed. Systems cache the version
+ * they last consumed and skip their work if it didn't move. Each iapp owns one
+ * instance, use `component_version<T>(registry)` to query it.
+ *
+ * Other change channels (e.g. `transform_hierarchy`) can be bumped explicitly
+ * with `bump`, they start at version 0 as well. Their first bump inserts them
+ * into the map, so it has to happen on the main thread, declared component
+ * types can be bumped from any thread.
+ */
+class component_versions : public component_listener {
+public:
+  component_versions();
+
+  std::uint64_t get(entt::id_type type) const {
+    auto it = versions.find(type);
+    return it == versions.end() ? 0
+                                : it->second.load(std::memory_order_relaxed);
+  }
+  template <typename T> std::uint64_t get() const {
+    return get(entt::type_hash<T>::value());
+  }
+  void bump(entt::id_type type) {
+    versions[type].fetch_add(1, std::memory_order_relaxed);
+  }
+  template <typename T> void bump() { bump(entt::type_hash<T>::value()); }
+
+  void on_component_changed(entt::id_type type, entt::registry &registry,
+                            entt::entity entity) override {
+    bump(type);
+  }
+  void on_component_removed(entt::id_type type, entt::registry &registry,
+                            entt::entity entity) override {
+    bump(type);
+  }
+
+private:
+  // all declared component types are inserted on construction, so systems
+  // writing on worker threads never rehash the map as long as they only bump
+  // declared types, the counters themselves are atomic
+  std::unordered_map<entt::id_type, std::atomic<std::uint64_t>> versions;
+};
+
+/**
+ * Collects the entities whose components of type `T...` got constructed,
+ * patched or destroyed since they were last consumed, backed by an entt
+ * reactive storage. Only the entity is recorded, by the time it gets consumed
+ * it might have lost the component or been destroyed, check with
+ * `registry.valid` and `try_get`.
+ *
+ * The observer has to be destroyed or disconnected before the registry it is
+ * connected to.
+ */
+template <typename... T> class change_observer {
+public:
+  change_observer() = default;
+  change_observer(const change_observer &) = delete;
+  ~change_observer() { disconnect(); }
+
+  void connect(entt::registry &registry) {
+    disconnect();
+    storage.bind(registry);
+    (storage.template on_construct<T>()
+         .template on_update<T>()
+         .template on_destroy<T>(),
+     ...);
+  }
+  void disconnect() {
+    storage.reset();
+    storage.clear();
+  }
+
+  bool empty() const { return storage.empty(); }
+  std::size_t size() const { return storage.size(); }
+
+  /**
+   * Call `func(entity)` on every changed entity in the order of their first
+   * change, then forget about them.
+   */
+  template <typename Func> void consume(Func &&func) {
+    for (std::size_t i = 0; i < storage.size(); i++)
+      func(storage.data()[i]);
+    storage.clear();
+  }
+
+private:
+  entt::storage_for_t<entt::reactive> storage;
+};
+
+/**
+ * Maps the entities of a copied hierarchy to their copies, entities outside
+ * of the hierarchy are returned unchanged. The lookup goes through a flat
+ * table indexed by the entity index, the table is shared by all copies of the
+ * same hierarchy.
+ *
+ * Components holding entity references should provide an overload of
+ * `remap_entities(T &comp, const entity_remap &remap)` findable through ADL,
+ * it gets called on every copied component.
+ */
+class entity_remap {
+public:
+  entity_remap() {}
+  entity_remap(const std::vector<entt::entity> &sources);
+
+  /**
+   * The returned remap maps `sources[i]` to `targets[i]`.
+   */
+  entity_remap with_targets(const entt::entity *targets) const {
+    entity_remap ret = *this;
+    ret.targets = targets;
+    return ret;
+  }
+
+  entt::entity operator()(entt::entity entity) const {
+    if (entity == entt::null || targets == nullptr)
+      return entity;
+    auto index = static_cast<std::size_t>(entt::to_entity(entity));
+    if (index >= slots->size())
+      return entity;
+    auto slot = (*slots)[index];
+    if (slot < 0 || (*sources)[slot] != entity)
+      return entity;
+    return targets[slot];
+  }
+  void operator()(std::vector<entt::entity> &entities) const {
+    for (auto &entity : entities)
+      entity = (*this)(entity);
+  }
+
+private:
+  std::shared_ptr<std::vector<std::int32_t>> slots;
+  const std::vector<entt::entity> *sources = nullptr;
+  const entt::entity *targets = nullptr;
+};
+
+template <typename T>
+concept __has_remap_entities__ =
+    requires(T &comp, const entity_remap &remap) {
+      remap_entities(comp, remap);
+    };
+template <typename T>
+concept __has_init_clone__ = requires(T &comp) { comp.init_clone(); };
+
+/**
+ * Copy the components of type T owned by `sources` to `count` copies, copy c
+ * of `sources[i]` is `targets[c * sources.size() + i]`.
+ */
+template <typename T>
+void __clone_components__(entt::registry &registry,
+                          const std::vector<entt::entity> &sources,
+                          const std::vector<entt::entity> &targets, int count,
+                          const entity_remap &remap) {
+  auto &storage = registry.storage<T>();
+  std::vector<std::size_t> owned;
+  for (std::size_t i = 0; i < sources.size(); i++)
+    if (storage.contains(sources[i]))
+      owned.push_back(i);
+  if (owned.empty())
+    return;
+  std::vector<entt::entity> entities;
+  std::vector<T> comps;
+  entities.reserve(owned.size() * count);
+  comps.reserve(owned.size() * count);
+  for (int c = 0; c < count; c++) {
+    auto copy_remap = remap.with_targets(targets.data() + c * sources.size());
+    for (auto i : owned) {
+      entities.push_back(targets[c * sources.size() + i]);
+      comps.push_back(storage.get(sources[i]));
+      if constexpr (__has_remap_entities__<T>)
+        remap_entities(comps.back(), copy_remap);
+    }
+  }
+  registry.insert<T>(entities.begin(), entities.end(),
+                     std::make_move_iterator(comps.begin()));
+}
+/**
+ * Initialize copied components of type T, components can provide an
+ * `init_clone` function to replace the `init1` call for copies.
+ */
+template <typename T>
+void __init_cloned_components__(entt::registry &registry,
+                                const std::vector<entt::entity> &targets) {
+  auto &storage = registry.storage<T>();
+  for (auto entity : targets) {
+    if (!storage.contains(entity))
+      continue;
+    if constexpr (__has_init_clone__<T>)
+      storage.get(entity).init_clone();
+    else
+      storage.get(entity).init1();
+  }
+}
+
+void connect_component_listener(entt::registry &registry,
+                                component_listener &listener);
+void disconnect_component_listener(entt::registry &registry,
+                                   component_listener &listener);
+/**
+ * Report all components of an entity as updated, use this after modifying
+ * components without going through the registry (e.g. from the gui).
+ */
+void mark_components_changed(entt::registry &registry, entt::entity entity);
+
+/**
+ * Systems issuing opengl calls declare `static constexpr bool
+ * requires_context = true;`, applications without a window skip them when
+ * loading a scene.
+ */
+template <typename SystemType>
+concept __requires_context__ = requires {
+  requires SystemType::requires_context;
+};
+
+inline std::size_t __next_system_type_index__() {
+  static std::atomic<std::size_t> counter{0};
+  return counter++;
+}
+template <typename SystemType> std::size_t __system_type_index__() {
+  static const std::size_t index = __next_system_type_index__();
+  return index;
+}
+
 class iapp {
 public:
-  iapp() { registry.ctx().emplace<iapp *>(this); }
+  iapp() {
+    registry.ctx().emplace<iapp *>(this);
+    connect_component_listener(registry, versions);
+  }
   ~iapp() {}
 
   template <typename SystemType> SystemType *get_sys() {
     static_assert(std::is_base_of_v<isystem, SystemType>,
                   "SystemType should derive from isystem");
-    for (auto &sys : systems)
-      if (dynamic_cast<SystemType *>(sys.get()) != nullptr)
+    auto index = __system_type_index__<SystemType>();
+    if (index < system_slots.size() && system_slots[index] != nullptr)
+      return static_cast<SystemType *>(system_slots[index]);
+    for (auto &sys : systems) {
+      if (dynamic_cast<SystemType *>(sys.get()) != nullptr) {
+        if (index >= system_slots.size())
+          system_slots.resize(index + 1, nullptr);
+        system_slots[index] = sys.get();
         return static_cast<SystemType *>(sys.get());
+      }
+    }
     printf("Required system doesn't exists in app, returns nullptr instead.\n");
     return nullptr;
   }
@@ -64,6 +377,7 @@ public:
       }
     }
     systems.emplace_back(std::make_shared<SystemType>());
+    scheduler.invalidate();
     systems[systems.size() - 1]->init0(registry);
     return static_cast<SystemType *>(systems[systems.size() - 1].get());
   }
@@ -74,16 +388,77 @@ public:
   }
 
   void update(float dt);
+  /**
+   * Run one update phase of all active systems through the scheduler.
+   */
+  void update_phase(system_phase phase, float dt);
 
+  /**
+   * Gets called before a system stored in a scene is created, the system is
+   * skipped if this returns false.
+   */
+  virtual bool accept_system(const std::string &name, bool requires_context) {
+    return true;
+  }
+
+  /**
+   * Scenes are stored column by column, one column per component type:
+   * `{"entities": [id], "components": {component: {"entities": [id], "data":
+   * [value]}}, "systems": {...}}` plus the late_serialize data. deserialize
+   * also accepts the legacy `{"registry": {id: {component: value}}}` layout
+   * and consumes `j`.
+   */
   virtual nlohmann::json serialize();
   virtual void late_serialize(nlohmann::json &j) {}
   virtual void deserialize(nlohmann::json &j);
   virtual void late_deserialize(nlohmann::json &j) {}
 
+  /**
+   * Prefabs use the same columnar layout as scenes without the systems,
+   * load_prefab accepts the legacy `{"data": {id: {component: value}}}`
+   * layout as well.
+   */
   nlohmann::json make_prefab(entt::entity root);
   void load_prefab(nlohmann::json &j);
 
+  /**
+   * Make `count` copies of the hierarchy under `root` by copying component
+   * storage directly, entity references inside the hierarchy are redirected
+   * to the copies. Returns the roots of the copies, they have no parent and
+   * keep the world transform of `root`.
+   */
+  std::vector<entt::entity> clone_hierarchy(entt::entity root, int count = 1);
+
+  /**
+   * Save and load the scene with the binary container format defined in
+   * binary_scene.hpp, each component type is stored in its own section and
+   * the sections are decoded in parallel when loading. Returns false if the
+   * file can't be written or read.
+   */
+  bool serialize_binary(const std::string &filepath);
+  bool deserialize_binary(const std::string &filepath);
+  /**
+   * Load a json scene written by `serialize` without building the whole
+   * document in memory, component types are decoded in parallel.
+   */
+  bool deserialize_json_file(const std::string &filepath);
+  /**
+   * Binary counterpart of make_prefab and load_prefab, load_prefab_binary
+   * returns the root entity of the instantiated hierarchy, or entt::null if
+   * the prefab can't be loaded.
+   */
+  bool make_prefab_binary(entt::entity root, const std::string &filepath);
+  entt::entity load_prefab_binary(const std::string &filepath);
+
+  // declared before the registry so it outlives the signals connected to it
+  component_versions versions;
   entt::registry registry;
+  /**
+   * Entities owned by streaming systems (e.g. the loaded cells of
+   * `opengl::world_partition`), they are stored in their own files so
+   * serialize, serialize_binary and the autosave skip them.
+   */
+  std::unordered_set<entt::entity> transient_entities;
 
   static inline std::map<
       std::string, std::pair<std::function<void(entt::registry &, entt::entity,
@@ -105,15 +480,103 @@ public:
       __add_comp_map__;
 
   static inline std::map<entt::entity, entt::entity> __entity_mapping__;
+  // replaces __entity_mapping__ on the current thread if it's not nullptr, so
+  // scenes can be decoded on background threads with their own mapping
+  static inline thread_local const std::map<entt::entity, entt::entity>
+      *__thread_entity_mapping__ = nullptr;
+
+  // Writes all components of one type into a json array, only the entities
+  // inside the subset are considered if it's not nullptr. The storage of the
+  // type is walked once in insertion order, so reloading a scene keeps the
+  // order, types without any component cost nothing.
+  using column_writer = std::function<void(
+      entt::registry &, const std::vector<entt::entity> *,
+      std::vector<entt::entity> &, nlohmann::json &)>;
+  // Decodes a json array into components without touching the registry, so it
+  // can run on worker threads. The returned function adds the components to
+  // the registry.
+  using column_decoder = std::function<std::function<void(entt::registry &)>(
+      std::vector<entt::entity>, const nlohmann::json &)>;
+  static inline std::map<std::string, std::pair<column_writer, column_decoder>>
+      __comp_column_callbacks__;
 
   static inline std::vector<
       std::function<void(iapp *, entt::registry &, entt::entity)>>
       __try_draw_gui_funcs__;
 
+  static inline std::map<
+      std::string,
+      std::pair<entt::id_type, std::function<void(entt::registry &,
+                                                  component_listener &, bool)>>>
+      __comp_listen_callbacks__;
+  static inline std::vector<std::function<void(entt::registry &, entt::entity)>>
+      __comp_patch_funcs__;
+
+  static inline std::map<
+      std::string,
+      std::pair<std::function<void(entt::registry &,
+                                   const std::vector<entt::entity> &,
+                                   const std::vector<entt::entity> &, int,
+                                   const entity_remap &)>,
+                std::function<void(entt::registry &,
+                                   const std::vector<entt::entity> &)>>>
+      __comp_clone_callbacks__;
+  // used by `edit_history` to restore existing components field by field and
+  // to remove added ones
+  static inline std::map<
+      std::string,
+      std::pair<std::function<void(entt::registry &, entt::entity,
+                                   const nlohmann::json &)>,
+                std::function<void(entt::registry &, entt::entity)>>>
+      __comp_history_callbacks__;
+
 protected:
+  void clear_systems();
+  /**
+   * Replace the current scene, `decode` gets called once the systems and
+   * entities are created and returns the functions adding the components.
+   */
+  void load_scene(
+      nlohmann::json &meta, const std::vector<entt::entity> &entities,
+      const std::function<std::vector<std::function<void(entt::registry &)>>()>
+          &decode);
+
   std::vector<std::shared_ptr<isystem>> systems;
+  system_scheduler scheduler;
+
+private:
+  // cached get_sys results indexed by __system_type_index__
+  std::vector<isystem *> system_slots;
+};
+
+/**
+ * Replaces `iapp::__entity_mapping__` on the current thread while it's alive,
+ * with the default empty mapping the stored entity ids are kept as they are.
+ */
+class entity_mapping_scope {
+public:
+  explicit entity_mapping_scope(
+      const std::map<entt::entity, entt::entity> *mapping = &no_mapping)
+      : previous(iapp::__thread_entity_mapping__) {
+    iapp::__thread_entity_mapping__ = mapping;
+  }
+  entity_mapping_scope(const entity_mapping_scope &) = delete;
+  ~entity_mapping_scope() { iapp::__thread_entity_mapping__ = previous; }
+
+private:
+  static inline const std::map<entt::entity, entt::entity> no_mapping;
+  const std::map<entt::entity, entt::entity> *previous;
 };
 
+/**
+ * Change version of `T` in the application owning the registry, see
+ * `component_versions`.
+ */
+template <typename T>
+std::uint64_t component_version(entt::registry &registry) {
+  return registry.ctx().get<iapp *>()->versions.get<T>();
+}
+
 class icomponent {
 public:
   virtual void init1() {}
@@ -136,6 +599,44 @@ public:
       from_json(j[#class_name], comp);                                         \
     }                                                                          \
   }                                                                            \
+  inline void __comp_column_writer__##class_name(                              \
+      entt::registry &registry, const std::vector<entt::entity> *subset,       \
+      std::vector<entt::entity> &entities, nlohmann::json &data) {             \
+    auto &storage = registry.storage<class_name>();                            \
+    if (storage.empty())                                                       \
+      return;                                                                  \
+    if (subset != nullptr && subset->size() < storage.size()) {                \
+      for (auto entity : *subset) {                                            \
+        if (storage.contains(entity)) {                                        \
+          entities.push_back(entity);                                          \
+          data.push_back(storage.get(entity));                                 \
+        }                                                                      \
+      }                                                                        \
+    } else {                                                                   \
+      std::unordered_set<entt::entity> members;                                \
+      if (subset != nullptr)                                                   \
+        members.insert(subset->begin(), subset->end());                        \
+      entities.reserve(storage.size());                                        \
+      for (auto [entity, comp] : storage.reach()) {                            \
+        if (subset != nullptr && members.count(entity) == 0)                   \
+          continue;                                                            \
+        entities.push_back(entity);                                            \
+        data.push_back(comp);                                                  \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  inline std::function<void(entt::registry &)>                                 \
+      __comp_column_decoder__##class_name(std::vector<entt::entity> entities,  \
+                                          const nlohmann::json &data) {        \
+    auto comps = std::make_shared<std::vector<class_name>>(data.size());       \
+    for (std::size_t i = 0; i < data.size(); i++)                             \
+      from_json(data[i], (*comps)[i]);                                         \
+    /* on_construct hooks see the decoded values and must keep them */        \
+    return [entities = std::move(entities), comps](entt::registry &registry) { \
+      registry.insert<class_name>(entities.begin(), entities.end(),            \
+                                  std::make_move_iterator(comps->begin()));    \
+    };                                                                         \
+  }                                                                            \
   inline void __add_comp_##class_name(entt::registry &registry,                \
                                       entt::entity entity) {                   \
     if (auto ptr = registry.try_get<class_name>(entity))                       \
@@ -160,6 +661,9 @@ public:
       toolkit::iapp::__comp_serializer_callbacks__.insert(std::make_pair(      \
           #class_name, std::make_pair(__comp_serializer__##class_name,         \
                                       __comp_deserializer__##class_name)));    \
+      toolkit::iapp::__comp_column_callbacks__.insert(std::make_pair(          \
+          #class_name, std::make_pair(__comp_column_writer__##class_name,      \
+                                      __comp_column_decoder__##class_name)));  \
       if (toolkit::iapp::__add_comp_map__.find(std::string(#category)) ==      \
           toolkit::iapp::__add_comp_map__.end()) {                             \
         toolkit::iapp::__add_comp_map__[std::string(#category)] =              \
@@ -172,6 +676,20 @@ public:
           std::make_pair(#class_name, __comp_init1_##class_name));             \
       toolkit::iapp::__try_draw_gui_funcs__.push_back(                         \
           __try_draw_gui_##class_name);                                        \
+      toolkit::iapp::__comp_listen_callbacks__.insert(std::make_pair(          \
+          #class_name,                                                         \
+          std::make_pair(entt::type_hash<class_name>::value(),                 \
+                         toolkit::__listen_component__<class_name>)));         \
+      toolkit::iapp::__comp_patch_funcs__.push_back(                           \
+          toolkit::__patch_component__<class_name>);                           \
+      toolkit::iapp::__comp_clone_callbacks__.insert(std::make_pair(           \
+          #class_name,                                                         \
+          std::make_pair(toolkit::__clone_components__<class_name>,            \
+                         toolkit::__init_cloned_components__<class_name>)));   \
+      toolkit::iapp::__comp_history_callbacks__.insert(std::make_pair(         \
+          #class_name,                                                         \
+          std::make_pair(toolkit::__assign_component_fields__<class_name>,     \
+                         toolkit::__remove_component__<class_name>)));         \
     }                                                                          \
   };                                                                           \
   static __register_funcs_##class_name                                         \
@@ -186,7 +704,9 @@ public:
     }                                                                          \
   }                                                                            \
   inline void __sys_deserializer__##class_name(iapp *app, nlohmann::json &j) { \
-    if (j.contains(#class_name)) {                                             \
+    if (j.contains(#class_name) &&                                             \
+        app->accept_system(#class_name,                                        \
+                           toolkit::__requires_context__<class_name>)) {       \
       auto sys = app->add_sys<class_name>();                                   \
       from_json(j[#class_name], *sys);                                         \
     }                                                                          \
@@ -215,10 +735,36 @@ template <> struct adl_serializer<entt::entity> {
     entt::entity original = entt::entity{raw_id};
 
     e = original;
-    if (toolkit::iapp::__entity_mapping__.find(original) !=
-        toolkit::iapp::__entity_mapping__.end()) {
-      e = toolkit::iapp::__entity_mapping__[original];
-    }
+    auto &mapping = toolkit::iapp::__thread_entity_mapping__ != nullptr
+                        ? *toolkit::iapp::__thread_entity_mapping__
+                        : toolkit::iapp::__entity_mapping__;
+    auto it = mapping.find(original);
+    if (it != mapping.end())
+      e = it->second;
   }
 };
-} // namespace nlohmann
\ No newline at end of file
+} // namespace nlohmann
+
+// entity references are remapped like the json serializer does
+template <> struct toolkit::binary_serializer<entt::entity> {
+  static constexpr bool bulk = false;
+  static void write(binary_writer &writer, const entt::entity &e) {
+    writer.write(static_cast<std::uint32_t>(entt::to_integral(e)));
+  }
+  static bool read(binary_reader &reader, entt::entity &e) {
+    std::uint32_t raw_id = 0;
+    if (!reader.read(raw_id))
+      return false;
+    e = entt::entity{raw_id};
+    auto &mapping = toolkit::iapp::__thread_entity_mapping__ != nullptr
+                        ? *toolkit::iapp::__thread_entity_mapping__
+                        : toolkit::iapp::__entity_mapping__;
+    auto it = mapping.find(e);
+    if (it != mapping.end())
+      e = it->second;
+    return true;
+  }
+  static constexpr std::uint64_t schema() {
+    return toolkit::binary_schema<std::uint32_t>();
+  }
+};
\ No newline at end of file
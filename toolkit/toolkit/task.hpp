@@ -0,0 +1,209 @@
+#pragma once
+
+#include "toolkit/jobs.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <spdlog/spdlog.h>
+
+namespace toolkit {
+
+template <typename T = void> class task;
+
+namespace _Task_Imp {
+
+struct promise_base {
+  // the coroutine awaiting this one, resumed once it finished
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      auto continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+  final_awaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T> struct promise : promise_base {
+  std::optional<T> value;
+
+  task<T> get_return_object();
+  template <typename U> void return_value(U &&v) {
+    value.emplace(std::forward<U>(v));
+  }
+  T result() {
+    if (exception)
+      std::rethrow_exception(exception);
+    return std::move(*value);
+  }
+};
+template <> struct promise<void> : promise_base {
+  task<void> get_return_object();
+  void return_void() {}
+  void result() {
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+};
+
+// a coroutine nobody awaits, it frees itself once finished
+struct detached {
+  struct promise_type {
+    detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {
+      try {
+        throw;
+      } catch (std::exception &e) {
+        spdlog::error("Uncaught exception in task: {0}", e.what());
+      } catch (...) {
+        spdlog::error("Uncaught exception in task");
+      }
+    }
+  };
+};
+
+}; // namespace _Task_Imp
+
+/**
+ * A coroutine returning `T`, it starts when it's awaited and resumes the
+ * awaiting coroutine on the thread it finished on. Switch threads inside a
+ * task with `co_await resume_on_workers()` for the heavy steps and
+ * `co_await resume_on_main_thread()` before touching the registry or opengl:
+ *
+ *   task<void> editor::import_model(std::string filepath) {
+ *     auto model = co_await assets::read_model_assimp(filepath);
+ *     co_await resume_on_main_thread();
+ *     assets::build_model_assimp(registry, *model);
+ *   }
+ *
+ * Start a task from regular code with `spawn`, or block on it with
+ * `sync_wait`. References passed to a task must outlive it.
+ */
+template <typename T> class [[nodiscard]] task {
+public:
+  using promise_type = _Task_Imp::promise<T>;
+
+  task() {}
+  explicit task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  task(task &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+  task &operator=(task &&other) noexcept {
+    if (this != &other) {
+      if (handle)
+        handle.destroy();
+      handle = std::exchange(other.handle, {});
+    }
+    return *this;
+  }
+  task(const task &) = delete;
+  ~task() {
+    if (handle)
+      handle.destroy();
+  }
+
+  bool done() const { return handle && handle.done(); }
+  // the result of a finished task, rethrows its exception
+  T get() { return handle.promise().result(); }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+    handle.promise().continuation = awaiting;
+    return handle;
+  }
+  T await_resume() { return get(); }
+
+  // await the task without taking its result
+  auto completion() {
+    struct awaiter {
+      std::coroutine_handle<promise_type> handle;
+      bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      void await_resume() {}
+    };
+    return awaiter{handle};
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+namespace _Task_Imp {
+template <typename T> task<T> promise<T>::get_return_object() {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+inline task<void> promise<void>::get_return_object() {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+}; // namespace _Task_Imp
+
+// continue the coroutine on a worker of `job_system::instance()`
+inline auto resume_on_workers() {
+  struct awaiter {
+    bool await_ready() const { return job_system::instance().size() == 0; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      job_system::instance().run([handle]() { handle.resume(); });
+    }
+    void await_resume() {}
+  };
+  return awaiter{};
+}
+
+/**
+ * Continue the coroutine on the main thread, it's resumed by the next
+ * `job_system::process_main_thread` at the top of a frame if it's not there
+ * already.
+ */
+inline auto resume_on_main_thread() {
+  struct awaiter {
+    bool await_ready() const { return job_system::instance().is_main_thread(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      job_system::instance().run_on_main_thread(
+          [handle]() { handle.resume(); });
+    }
+    void await_resume() {}
+  };
+  return awaiter{};
+}
+
+/**
+ * Run `t` until its first suspension and let it finish on its own, the
+ * exceptions it throws are logged.
+ */
+inline void spawn(task<void> t) {
+  [](task<void> t) -> _Task_Imp::detached { co_await t; }(std::move(t));
+}
+
+/**
+ * Block until `t` finished and return its result, the calling thread runs
+ * queued jobs meanwhile. On the main thread, it also runs the main thread
+ * jobs so `t` can resume there, only call it where the registry may change.
+ */
+template <typename T> T sync_wait(task<T> t) {
+  std::atomic<bool> finished{false};
+  [](task<T> &t, std::atomic<bool> &finished) -> _Task_Imp::detached {
+    co_await t.completion();
+    finished = true;
+  }(t, finished);
+  auto &jobs = job_system::instance();
+  jobs.wait_until([&]() {
+    if (jobs.is_main_thread())
+      jobs.process_main_thread();
+    return finished.load();
+  });
+  return t.get();
+}
+
+}; // namespace toolkit
@@ -3,13 +3,25 @@
 
 namespace toolkit {
 
+static void mark_hierarchy_changed(entt::registry &registry) {
+  if (auto app = registry.ctx().find<iapp *>())
+    (*app)->versions.bump<transform_hierarchy>();
+}
+
+static std::uint64_t name_version(entt::registry &registry) {
+  auto app = registry.ctx().find<iapp *>();
+  return app ? (*app)->versions.get<transform_name>() : 0;
+}
+
 void on_transform_created(entt::registry &registry, entt::entity entity) {
   auto &tf = registry.get<transform>(entity);
   tf.registry = &registry;
   tf.self = entity;
+  mark_hierarchy_changed(registry);
 }
 
 void on_transform_destroyed(entt::registry &registry, entt::entity entity) {
+  mark_hierarchy_changed(registry);
   auto parent = registry.get<transform>(entity).m_parent;
   if (parent != entt::null && registry.valid(parent)) {
     auto &parentTf = registry.get<transform>(parent);
@@ -19,6 +31,22 @@ void on_transform_destroyed(entt::registry &registry, entt::entity entity) {
   }
 }
 
+std::vector<entt::entity> collect_hierarchy(entt::registry &registry,
+                                            entt::entity root) {
+  std::vector<entt::entity> hierarchy_entities;
+  std::queue<entt::entity> q;
+  q.push(root);
+  while (!q.empty()) {
+    auto ent = q.front();
+    hierarchy_entities.push_back(ent);
+    q.pop();
+    auto &trans = registry.get<transform>(ent);
+    for (auto c : trans.m_children)
+      q.push(c);
+  }
+  return hierarchy_entities;
+}
+
 void destroy_hierarchy(entt::registry &registry, entt::entity root) {
   std::vector<entt::entity> hierarchy;
   std::function<void(entt::entity)> collect_hierarchy_entities =
@@ -156,6 +184,7 @@ void transform::add_child(entt::entity child, bool keep_transform) {
   }
   cTrans.m_parent = self;
   m_children.push_back(child);
+  mark_hierarchy_changed(*registry);
   if (keep_transform) {
     cTrans.set_world_pos(cTrans.m_pos);
     cTrans.set_world_rot(cTrans.m_rot);
@@ -174,6 +203,7 @@ void transform::set_parent(entt::entity parent, bool keep_transform) {
   m_parent = parent;
   auto &np_trans = registry->get<transform>(parent);
   np_trans.m_children.push_back(self);
+  mark_hierarchy_changed(*registry);
   if (keep_transform) {
     set_world_pos(m_pos);
     set_world_rot(m_rot);
@@ -193,6 +223,7 @@ void transform::clear_relations() {
   for (auto c : m_children)
     registry->get<transform>(c).m_parent = entt::null;
   m_children.clear();
+  mark_hierarchy_changed(*registry);
 }
 
 bool transform::remove_parent() {
@@ -203,6 +234,7 @@ bool transform::remove_parent() {
     if (it != pTrans.m_children.end())
       pTrans.m_children.erase(it);
     m_parent = entt::null;
+    mark_hierarchy_changed(*registry);
     return true;
   } else
     return false;
@@ -270,6 +302,15 @@ math::matrix4 transform::parent_matrix() const {
   }
 }
 
+void transform::set_name(interned_string new_name) {
+  name = new_name;
+  // the channel was inserted by transform_system::init0, bumping it is safe
+  // from the workers
+  if (registry != nullptr)
+    if (auto app = registry->ctx().find<iapp *>())
+      (*app)->versions.bump<transform_name>();
+}
+
 void transform::force_update_hierarchy() {
   std::stack<entt::entity> s;
   s.push(self);
@@ -309,27 +350,29 @@ void transform_system::draw_gui(entt::registry &registry, entt::entity entity) {
 }
 
 void transform_system::update_transform(entt::registry &registry) {
+  PROFILE_SCOPE("transform_system::update_transform");
+  if (sort_storage)
+    sort_hierarchy(registry);
   root_entities.clear();
   // find the root entities
-  auto view = registry.view<transform>();
-  int qFront = 0, qBack = 0, size = view.size() + 1;
-  entity_refresh_queue.resize(size);
-  view.each([&](entt::entity ent, transform &trans) {
-    if (trans.m_parent == entt::null) {
-      root_entities.insert(ent);
-      entity_refresh_queue[qBack++] = std::make_pair(trans.dirty, ent);
-    }
+  registry.view<transform>().each([&](entt::entity ent, transform &trans) {
+    if (trans.m_parent == entt::null)
+      root_entities.push_back(ent);
   });
-  // traverse the hierarchy, update transform if dirty
-  while (qFront != qBack) {
-    auto [dirty, ent] = entity_refresh_queue[qFront];
-    qFront = (qFront + 1) % size;
+  std::sort(root_entities.begin(), root_entities.end());
+  // traverse the hierarchy depth first like the sorted storage, update
+  // transform if it or one of its ancestors is dirty
+  entity_refresh_stack.clear();
+  for (auto it = root_entities.rbegin(); it != root_entities.rend(); it++)
+    entity_refresh_stack.emplace_back(false, *it);
+  while (!entity_refresh_stack.empty()) {
+    auto [parent_dirty, ent] = entity_refresh_stack.back();
+    entity_refresh_stack.pop_back();
     auto &trans = registry.get<transform>(ent);
-    for (auto child : trans.m_children) {
-      entity_refresh_queue[qBack] =
-          std::make_pair(dirty || registry.get<transform>(child).dirty, child);
-      qBack = (qBack + 1) % size;
-    }
+    bool dirty = parent_dirty || trans.dirty;
+    for (auto it = trans.m_children.rbegin(); it != trans.m_children.rend();
+         it++)
+      entity_refresh_stack.emplace_back(dirty, *it);
     // update global positions with local positions
     if (dirty) {
       trans.m_matrix =
@@ -339,9 +382,101 @@ void transform_system::update_transform(entt::registry &registry) {
       math::decompose_transform(trans.m_matrix, trans.m_pos, trans.m_rot,
                                 trans.m_scale);
       trans.update_local_axes();
+      // report local changes to the on_update<transform> listeners
+      if (trans.dirty)
+        registry.patch<transform>(ent);
       trans.dirty = false;
     }
   }
 }
 
+void transform_system::sort_hierarchy(entt::registry &registry) {
+  auto app = registry.ctx().find<iapp *>();
+  auto version = app ? (*app)->versions.get<transform_hierarchy>() : 0;
+  if (hierarchy_sorted && version == sorted_hierarchy_version)
+    return;
+  if (hierarchy_sorted && ++calls_since_change < sort_interval)
+    return;
+  PROFILE_SCOPE("transform_system::sort_hierarchy");
+  hierarchy_sorted = true;
+  sorted_hierarchy_version = version;
+  calls_since_change = 0;
+
+  auto &storage = registry.storage<transform>();
+  std::vector<entt::entity> stack;
+  std::size_t max_index = 0;
+  for (auto [entity, trans] : storage.each()) {
+    max_index = std::max<std::size_t>(max_index, entt::to_entity(entity));
+    if (trans.m_parent == entt::null)
+      stack.push_back(entity);
+  }
+  // pop the roots in ascending order
+  std::sort(stack.begin(), stack.end(), std::greater<entt::entity>());
+  // transforms not reachable from a root go last
+  hierarchy_rank.assign(max_index + 1, UINT32_MAX);
+  std::uint32_t rank = 0;
+  while (!stack.empty()) {
+    auto entity = stack.back();
+    stack.pop_back();
+    hierarchy_rank[entt::to_entity(entity)] = rank++;
+    auto &children = storage.get(entity).m_children;
+    stack.insert(stack.end(), children.rbegin(), children.rend());
+  }
+  auto compare = [this](entt::entity lhs, entt::entity rhs) {
+    return hierarchy_rank[entt::to_entity(lhs)] <
+           hierarchy_rank[entt::to_entity(rhs)];
+  };
+  // a few edits since the last sort leave most of the storage in order,
+  // insertion sort only moves the misplaced transforms then
+  std::size_t misplaced = 0;
+  entt::entity previous = entt::null;
+  for (auto entity : static_cast<entt::sparse_set &>(storage)) {
+    if (previous != entt::null && compare(entity, previous))
+      misplaced++;
+    previous = entity;
+  }
+  if (misplaced > 64)
+    registry.sort<transform>(compare);
+  else if (misplaced > 0)
+    registry.sort<transform>(compare, entt::insertion_sort{});
+  for (auto &[name, sort] : __hierarchy_sorted_storages__)
+    sort(registry);
+}
+
+entt::entity transform_system::find_entity(entt::registry &registry,
+                                           interned_string name) {
+  auto lookup = [&](bool &stale) -> entt::entity {
+    auto it = name_index.find(name);
+    if (it == name_index.end())
+      return entt::null;
+    for (auto entity : it->second) {
+      auto trans = registry.valid(entity) ? registry.try_get<transform>(entity)
+                                          : nullptr;
+      if (trans != nullptr && trans->name == name)
+        return entity;
+    }
+    // every indexed entity got renamed or destroyed since
+    stale = true;
+    return entt::null;
+  };
+  auto version = component_version<transform>(registry);
+  auto names = name_version(registry);
+  bool stale = !name_index_built || version != name_index_version ||
+               names != name_index_name_version;
+  if (!stale) {
+    auto entity = lookup(stale);
+    if (!stale)
+      return entity;
+  }
+  name_index.clear();
+  registry.view<entt::entity, transform>().each(
+      [&](entt::entity entity, transform &trans) {
+        name_index[trans.name].push_back(entity);
+      });
+  name_index_version = version;
+  name_index_name_version = names;
+  name_index_built = true;
+  return lookup(stale);
+}
+
 }; // namespace toolkit
\ No newline at end of file
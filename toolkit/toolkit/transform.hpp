@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <queue>
 #include <stack>
+#include <toolkit/intern.hpp>
 #include <toolkit/math.hpp>
 #include <toolkit/utils.hpp>
 #include <vector>
@@ -17,6 +18,25 @@ void on_transform_created(entt::registry &registry, entt::entity entity);
 void on_transform_destroyed(entt::registry &registry, entt::entity entity);
 
 void destroy_hierarchy(entt::registry &registry, entt::entity root);
+/**
+ * All entities of the hierarchy in breadth first order, the root comes first.
+ */
+std::vector<entt::entity> collect_hierarchy(entt::registry &registry,
+                                            entt::entity root);
+
+/**
+ * Change channel of the parent child relations between transforms, its
+ * version in `component_versions` goes up whenever a transform gets created,
+ * destroyed or reparented. Moving a transform only changes the version of
+ * `transform`.
+ */
+struct transform_hierarchy {};
+
+/**
+ * Change channel of the transform names, goes up whenever `transform::set_name`
+ * renames a transform.
+ */
+struct transform_name {};
 
 class transform : public icomponent {
 public:
@@ -24,7 +44,9 @@ public:
   entt::registry *registry = nullptr;
   entt::entity m_parent{entt::null}, self{entt::null};
   std::vector<entt::entity> m_children;
-  std::string name = "";
+  // rename existing transforms with set_name, transform_system::find_entity
+  // won't see the new name otherwise
+  interned_string name;
   bool dirty = true;
 
   math::vector3 position() const { return m_pos; }
@@ -76,6 +98,8 @@ public:
 
   void force_update_hierarchy();
 
+  void set_name(interned_string new_name);
+
 private:
   // ---------- cache data for faster reference ----------
   math::vector3 m_pos = math::vector3::Zero();
@@ -95,6 +119,10 @@ private:
 
   REFLECT_PRIVATE(transform)
 };
+inline void remap_entities(transform &trans, const entity_remap &remap) {
+  trans.m_parent = remap(trans.m_parent);
+  remap(trans.m_children);
+}
 DECLARE_COMPONENT(transform, basic, m_local_pos, m_local_scale, m_local_rot,
                   m_local_euler, name, m_parent, m_children)
 
@@ -103,18 +131,87 @@ public:
   void init0(entt::registry &registry) override {
     registry.on_construct<transform>().connect<&on_transform_created>();
     registry.on_destroy<transform>().connect<&on_transform_destroyed>();
+    // insert the name channel on the main thread, see set_name
+    if (auto app = registry.ctx().find<iapp *>())
+      (*app)->versions.bump<transform_name>();
   }
   void init1(entt::registry &registry) override {}
 
+  // the hierarchy is updated by update_transform outside the update phases
+  void declare_access(system_access &access) override { access.none(); }
+
   void draw_gui(entt::registry &registry, entt::entity entity) override;
 
+  /**
+   * Sort the transforms of the scene, then update the dirty ones and their
+   * descendants in depth first order.
+   */
   void update_transform(entt::registry &registry);
 
-  std::set<entt::entity> root_entities;
+  /**
+   * Sort the transform storage in depth first order of the hierarchy, roots
+   * sorted by entity, and the storages registered with SORT_WITH_HIERARCHY in
+   * the same order. Walking a hierarchy then mostly reads memory linearly.
+   * Nothing happens unless the `transform_hierarchy` version moved since the
+   * last sort, call it outside the update phases, it moves the components.
+   *
+   * Every sort walks the whole hierarchy, so after the first sort a changed
+   * hierarchy is only sorted again on the `sort_interval`th call. Scenes
+   * spawning entities every frame don't pay the full pass every frame, the
+   * transforms created in between are still updated, just out of order.
+   */
+  void sort_hierarchy(entt::registry &registry);
+  // whether update_transform sorts the storage first
+  bool sort_storage = true;
+  int sort_interval = 30;
+
+  /**
+   * Returns an entity whose transform is called `name`, or entt::null if there
+   * is none. Names aren't unique, any of the matching entities may be
+   * returned. The name index is rebuilt lazily after transforms got
+   * constructed, patched, destroyed or renamed with `transform::set_name`.
+   */
+  entt::entity find_entity(entt::registry &registry, interned_string name);
+
+  // sorted entities without parent, refreshed by update_transform
+  std::vector<entt::entity> root_entities;
+
+  static inline std::map<std::string, std::function<void(entt::registry &)>>
+      __hierarchy_sorted_storages__;
 
 private:
-  std::vector<std::pair<bool, entt::entity>> entity_refresh_queue;
+  // entities to refresh and whether their parent got refreshed
+  std::vector<std::pair<bool, entt::entity>> entity_refresh_stack;
+
+  // depth first position of each entity index in the last sort
+  std::vector<std::uint32_t> hierarchy_rank;
+  std::uint64_t sorted_hierarchy_version = 0;
+  bool hierarchy_sorted = false;
+  // calls since the hierarchy changed after the last sort
+  int calls_since_change = 0;
+
+  std::unordered_map<interned_string, std::vector<entt::entity>> name_index;
+  std::uint64_t name_index_version = 0, name_index_name_version = 0;
+  bool name_index_built = false;
 };
 DECLARE_SYSTEM(transform_system)
 
+/**
+ * Sort the storage of `class_name` along with the transforms, see
+ * `transform_system::sort_hierarchy`. Components added to existing entities
+ * are ordered by the next change of the hierarchy.
+ */
+#define SORT_WITH_HIERARCHY(class_name)                                        \
+  struct __register_hierarchy_sort_##class_name {                              \
+    __register_hierarchy_sort_##class_name() {                                 \
+      toolkit::transform_system::__hierarchy_sorted_storages__[#class_name] =  \
+          [](entt::registry &registry) {                                       \
+            registry.sort<class_name, toolkit::transform>();                   \
+          };                                                                   \
+    }                                                                          \
+  };                                                                           \
+  static __register_hierarchy_sort_##class_name                                \
+      __register_hierarchy_sort_instance_##class_name =                        \
+          __register_hierarchy_sort_##class_name();
+
 }; // namespace toolkit
\ No newline at end of file
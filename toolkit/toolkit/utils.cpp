@@ -103,6 +103,19 @@ bool listdir(std::string dirpath, std::function<void(std::string)> f) {
     return false;
 }
 
+task<std::vector<std::uint8_t>> read_file_async(std::string filepath) {
+  co_await resume_on_workers();
+  std::ifstream input(filepath, std::ios::binary | std::ios::ate);
+  if (!input.is_open()) {
+    spdlog::error("Failed to open file {0}", filepath);
+    co_return std::vector<std::uint8_t>();
+  }
+  std::vector<std::uint8_t> data(static_cast<std::size_t>(input.tellg()));
+  input.seekg(0);
+  input.read(reinterpret_cast<char *>(data.data()), data.size());
+  co_return data;
+}
+
 bool mkdir(std::string path) { return fs::create_directories(path); }
 
 bool open_folder_dialog(std::string title, std::string &selectedFolder) {
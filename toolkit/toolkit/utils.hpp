@@ -1,6 +1,10 @@
 #pragma once
 
+#include "toolkit/frame_arena.hpp"
+#include "toolkit/jobs.hpp"
 #include "toolkit/math.hpp"
+#include "toolkit/memory.hpp"
+#include "toolkit/task.hpp"
 #include <chrono>
 #include <filesystem>
 #include <zlib.h>
@@ -43,6 +47,12 @@ bool open_file_dialog(std::string title,
 
 bool listdir(std::string dirpath, std::function<void(std::string)> f);
 
+/**
+ * Read the whole file on a worker, the task finishes there. The result is
+ * empty if the file can't be read.
+ */
+task<std::vector<std::uint8_t>> read_file_async(std::string filepath);
+
 bool mkdir(std::string path);
 
 template <typename... Paths> std::string join_path(Paths &&...paths) {